@@ -0,0 +1,149 @@
+/*
+ * BLAKE3 hash function, picks the back end from the features of the CPU at run time.
+ *
+ * Released into the public domain with CC0 1.0, like the reference implementation.
+ */
+#include "blake3_impl.h"
+
+#if defined(IS_X86)
+#if !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+
+enum cpu_feature {
+  SSE41 = 1 << 0,
+  AVX = 1 << 1,
+  AVX2 = 1 << 2,
+  UNDEFINED = 1 << 30
+};
+
+// Detected once, threads racing on the first call store the same value.
+static volatile int g_cpu_features = UNDEFINED;
+
+static uint64_t xgetbv(void) {
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  uint32_t eax = 0, edx = 0;
+  __asm__ __volatile__("xgetbv\n" : "=a"(eax), "=d"(edx) : "c"(0));
+  return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+static void cpuid(uint32_t out[4], uint32_t id) {
+#if defined(_MSC_VER)
+  __cpuid((int *)out, (int)id);
+#else
+  __cpuid(id, out[0], out[1], out[2], out[3]);
+#endif
+}
+
+static void cpuidex(uint32_t out[4], uint32_t id, uint32_t sid) {
+#if defined(_MSC_VER)
+  __cpuidex((int *)out, (int)id, (int)sid);
+#else
+  __cpuid_count(id, sid, out[0], out[1], out[2], out[3]);
+#endif
+}
+
+static int get_cpu_features(void) {
+  int features = g_cpu_features;
+  if (features != UNDEFINED) {
+    return features;
+  }
+  features = 0;
+  uint32_t regs[4] = {0};
+  cpuid(regs, 0);
+  const uint32_t max_id = regs[0];
+  cpuid(regs, 1);
+  const uint32_t ecx = regs[2];
+  if (ecx & (1UL << 19)) {
+    features |= SSE41;
+  }
+  // AVX needs the OS to save the YMM registers, OSXSAVE and XCR0 bits 1 and 2.
+  if ((ecx & (1UL << 27)) && (ecx & (1UL << 28)) && (xgetbv() & 6) == 6) {
+    features |= AVX;
+    if (max_id >= 7) {
+      cpuidex(regs, 7, 0);
+      if (regs[1] & (1UL << 5)) {
+        features |= AVX2;
+      }
+    }
+  }
+  // The back ends can be left out at build time.
+#if defined(BLAKE3_NO_SSE41)
+  features &= ~SSE41;
+#endif
+#if defined(BLAKE3_NO_AVX2)
+  features &= ~AVX2;
+#endif
+  g_cpu_features = features;
+  return features;
+}
+#endif
+
+void blake3_compress_in_place(uint32_t cv[8],
+                              const uint8_t block[BLAKE3_BLOCK_LEN],
+                              uint8_t block_len, uint64_t counter,
+                              uint8_t flags) {
+#if defined(IS_X86)
+  const int features = get_cpu_features();
+  if (features & SSE41) {
+    blake3_compress_in_place_sse41(cv, block, block_len, counter, flags);
+    return;
+  }
+#endif
+  blake3_compress_in_place_portable(cv, block, block_len, counter, flags);
+}
+
+void blake3_compress_xof(const uint32_t cv[8],
+                         const uint8_t block[BLAKE3_BLOCK_LEN],
+                         uint8_t block_len, uint64_t counter, uint8_t flags,
+                         uint8_t out[64]) {
+#if defined(IS_X86)
+  const int features = get_cpu_features();
+  if (features & SSE41) {
+    blake3_compress_xof_sse41(cv, block, block_len, counter, flags, out);
+    return;
+  }
+#endif
+  blake3_compress_xof_portable(cv, block, block_len, counter, flags, out);
+}
+
+void blake3_hash_many(const uint8_t *const *inputs, size_t num_inputs,
+                      size_t blocks, const uint32_t key[8], uint64_t counter,
+                      bool increment_counter, uint8_t flags,
+                      uint8_t flags_start, uint8_t flags_end, uint8_t *out) {
+#if defined(IS_X86)
+  const int features = get_cpu_features();
+  // The AVX2 back end hashes the inputs left over from its groups of eight with SSE4.1.
+  if ((features & AVX2) && (features & SSE41)) {
+    blake3_hash_many_avx2(inputs, num_inputs, blocks, key, counter,
+                          increment_counter, flags, flags_start, flags_end,
+                          out);
+    return;
+  }
+  if (features & SSE41) {
+    blake3_hash_many_sse41(inputs, num_inputs, blocks, key, counter,
+                           increment_counter, flags, flags_start, flags_end,
+                           out);
+    return;
+  }
+#endif
+  blake3_hash_many_portable(inputs, num_inputs, blocks, key, counter,
+                            increment_counter, flags, flags_start, flags_end,
+                            out);
+}
+
+size_t blake3_simd_degree(void) {
+#if defined(IS_X86)
+  const int features = get_cpu_features();
+  if ((features & AVX2) && (features & SSE41)) {
+    return 8;
+  }
+  if (features & SSE41) {
+    return 4;
+  }
+#endif
+  return 1;
+}
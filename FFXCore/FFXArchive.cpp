@@ -0,0 +1,314 @@
+#include "FFXArchive.h"
+#include "FFXSevenZip.h"
+
+#include <QObject>
+#include <QDir>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+
+#include <chrono>
+
+#include <bit7z/bitarchivereader.hpp>
+using namespace bit7z;
+
+namespace FFX {
+	static const int MaxCachedIndexes = 256;
+	static const qint64 MaxCacheAge = 24 * 3600;
+
+	static QString CacheRoot() {
+		QDir temp(QStandardPaths::writableLocation(QStandardPaths::TempLocation));
+		return temp.absoluteFilePath("ffx-archive");
+	}
+
+	//! Entries are cleaned relative to the archive root, those that are absolute or climb above it are empty and dropped.
+	static QString EntryPath(const QString& path) {
+		QString p = path;
+		p.replace('\\', '/');
+		while (p.startsWith('/'))
+			p.remove(0, 1);
+		if (QDir::isAbsolutePath(p))
+			return QString();
+		p = QDir::cleanPath(p);
+		if (p == "." || p == ".." || p.startsWith("../"))
+			return QString();
+		return p;
+	}
+
+	static QString ParentEntry(const QString& entry) {
+		int pos = entry.lastIndexOf('/');
+		return pos < 0 ? QString() : entry.left(pos);
+	}
+
+	/************************************************************************************************************************
+	 * Class： ArchiveIndex
+	 *
+	 *
+	/************************************************************************************************************************/
+	bool ArchiveIndex::IsArchive(const QFileInfo& file) {
+		static const QStringList suffixes = { "zip", "7z", "rar", "tar", "gz", "tgz", "bz2", "tbz2", "xz", "txz", "iso", "cab", "wim", "ffx" };
+		return file.isFile() && suffixes.contains(file.suffix(), Qt::CaseInsensitive);
+	}
+
+	bool ArchiveIndex::IsVirtualPath(const QString& path) {
+		QString archive, entry;
+		return SplitPath(path, archive, entry);
+	}
+
+	bool ArchiveIndex::SplitPath(const QString& path, QString& archive, QString& entry) {
+		for (int pos = path.indexOf('!'); pos >= 0; pos = path.indexOf('!', pos + 1)) {
+			QFileInfo file(path.left(pos));
+			if (file.isFile()) {
+				archive = file.absoluteFilePath();
+				entry = EntryPath(path.mid(pos + 1));
+				return true;
+			}
+		}
+		return false;
+	}
+
+	QString ArchiveIndex::JoinPath(const QString& archive, const QString& entry) {
+		return QString("%1!%2").arg(QFileInfo(archive).absoluteFilePath()).arg(entry);
+	}
+
+	QString ArchiveIndex::ParentPath(const QString& path) {
+		QString archive, entry;
+		if (!SplitPath(path, archive, entry))
+			return QFileInfo(path).absolutePath();
+		if (entry.isEmpty())
+			return QFileInfo(archive).absolutePath();
+		return JoinPath(archive, ParentEntry(entry));
+	}
+
+	std::shared_ptr<const ArchiveIndex> ArchiveIndex::Open(const QString& archive, QString* error) {
+		static QMutex mutex;
+		static QHash<QString, QPair<QDateTime, ArchiveIndexPtr>> cache;
+		static QList<QString> order;
+
+		QFileInfo fileInfo(archive);
+		if (!fileInfo.isFile()) {
+			if (error != nullptr) {
+				*error = QObject::tr("%1 is not a file.").arg(archive);
+			}
+			return ArchiveIndexPtr();
+		}
+
+		QString key = fileInfo.absoluteFilePath();
+		{
+			QMutexLocker locker(&mutex);
+			auto it = cache.find(key);
+			if (it != cache.end() && it.value().first == fileInfo.lastModified())
+				return it.value().second;
+		}
+
+		//! Reading the headers may take a while, other archives are not blocked meanwhile.
+		std::shared_ptr<ArchiveIndex> index = std::make_shared<ArchiveIndex>();
+		if (!index->Load(key, error))
+			return ArchiveIndexPtr();
+
+		QMutexLocker locker(&mutex);
+		//! The indexes loaded first are dropped first, searching a large tree must not flush the whole cache.
+		if (!cache.contains(key)) {
+			order << key;
+		}
+		while (order.size() > MaxCachedIndexes) {
+			cache.remove(order.takeFirst());
+		}
+		cache[key] = qMakePair(fileInfo.lastModified(), ArchiveIndexPtr(index));
+		return index;
+	}
+
+	bool ArchiveIndex::Load(const QString& archive, QString* error) {
+		QFileInfo fileInfo(archive);
+		mArchive = fileInfo.absoluteFilePath();
+		mLastModified = fileInfo.lastModified();
+		mEntries.clear();
+		mEntryIds.clear();
+		mChildren.clear();
+		AddDir(QString());
+
+		try {
+			BitArchiveReader reader{ SevenZipLibrary::Instance(), mArchive.toStdString(), BitFormat::Auto };
+			for (const BitArchiveItemInfo& item : reader.items()) {
+				ArchiveEntry entry;
+				entry.path = EntryPath(QString::fromStdString(item.path()));
+				if (entry.path.isEmpty())
+					continue;
+				entry.index = item.index();
+				entry.dir = item.isDir();
+				entry.size = item.size();
+				entry.packSize = item.packSize();
+				try {
+					auto msecs = std::chrono::duration_cast<std::chrono::milliseconds>(item.lastWriteTime().time_since_epoch());
+					entry.lastModified = QDateTime::fromMSecsSinceEpoch(msecs.count());
+				} catch (const bit7z::BitException&) {
+					entry.lastModified = mLastModified;
+				}
+
+				int parent = AddDir(ParentEntry(entry.path));
+				auto it = mEntryIds.find(entry.path);
+				if (it != mEntryIds.end()) {
+					//! A directory item listed after its children replaces the implicit one.
+					mEntries[it.value()] = entry;
+					continue;
+				}
+				mEntryIds[entry.path] = mEntries.size();
+				mChildren[mEntries[parent].path] << mEntries.size();
+				mEntries << entry;
+			}
+		} catch (const bit7z::BitException& ex) {
+			if (error != nullptr) {
+				*error = QString::fromLocal8Bit(ex.what());
+			}
+			return false;
+		}
+		return true;
+	}
+
+	int ArchiveIndex::AddDir(const QString& dir) {
+		auto it = mEntryIds.find(dir);
+		if (it != mEntryIds.end())
+			return it.value();
+
+		ArchiveEntry entry;
+		entry.path = dir;
+		entry.dir = true;
+		entry.lastModified = mLastModified;
+		int parent = dir.isEmpty() ? -1 : AddDir(ParentEntry(dir));
+		int id = mEntries.size();
+		mEntryIds[dir] = id;
+		mEntries << entry;
+		if (parent >= 0) {
+			mChildren[mEntries[parent].path] << id;
+		}
+		return id;
+	}
+
+	bool ArchiveIndex::Contains(const QString& entry) const {
+		return mEntryIds.contains(EntryPath(entry));
+	}
+
+	bool ArchiveIndex::IsDir(const QString& entry) const {
+		const ArchiveEntry* e = Entry(entry);
+		return e != nullptr && e->dir;
+	}
+
+	const ArchiveEntry* ArchiveIndex::Entry(const QString& entry) const {
+		auto it = mEntryIds.find(EntryPath(entry));
+		return it == mEntryIds.end() ? nullptr : &mEntries[it.value()];
+	}
+
+	QVector<ArchiveEntry> ArchiveIndex::Children(const QString& dir) const {
+		QVector<ArchiveEntry> result;
+		for (int id : mChildren.value(EntryPath(dir)))
+			result << mEntries[id];
+		return result;
+	}
+
+	std::vector<uint32_t> ArchiveIndex::Indices(const QString& entry) const {
+		std::vector<uint32_t> result;
+		QVector<int> pending;
+		auto it = mEntryIds.find(EntryPath(entry));
+		if (it != mEntryIds.end())
+			pending << it.value();
+		while (!pending.isEmpty()) {
+			const ArchiveEntry& e = mEntries[pending.takeLast()];
+			if (e.index >= 0)
+				result.push_back((uint32_t)e.index);
+			if (e.dir)
+				pending << mChildren.value(e.path);
+		}
+		return result;
+	}
+
+	bool ArchiveIndex::Extract(const QStringList& entries, const QString& outputDir, QString* error) const {
+		std::vector<uint32_t> indices;
+		for (const QString& entry : entries) {
+			std::vector<uint32_t> i = Indices(entry);
+			indices.insert(indices.end(), i.begin(), i.end());
+		}
+		QDir().mkpath(outputDir);
+		if (indices.empty())
+			return true;
+
+		try {
+			//! Only the requested items are decompressed, solid blocks are read up to the last of them.
+			BitArchiveReader reader{ SevenZipLibrary::Instance(), mArchive.toStdString(), BitFormat::Auto };
+			reader.extractTo(outputDir.toStdString(), indices);
+		} catch (const bit7z::BitException& ex) {
+			if (error != nullptr)
+				*error = QString::fromLocal8Bit(ex.what());
+			return false;
+		}
+		return true;
+	}
+
+	QString ArchiveIndex::CacheDir() const {
+		QCryptographicHash hash(QCryptographicHash::Sha1);
+		hash.addData(mArchive.toUtf8());
+		hash.addData(QByteArray::number(mLastModified.toMSecsSinceEpoch()));
+		return QDir(CacheRoot()).absoluteFilePath(QString(hash.result().toHex().left(16)));
+	}
+
+	void ArchiveIndex::PruneCache() {
+		//! A cache directory is used when its stamp beside it is rewritten, writing into a subdirectory does not touch the directory itself.
+		QDateTime expired = QDateTime::currentDateTime().addSecs(-MaxCacheAge);
+		QDir root(CacheRoot());
+		for (const QFileInfo& dir : root.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden)) {
+			QFileInfo stamp(dir.absoluteFilePath() + ".used");
+			QDateTime used = stamp.exists() ? stamp.lastModified() : dir.lastModified();
+			if (used >= expired)
+				continue;
+			QDir(dir.absoluteFilePath()).removeRecursively();
+			QFile::remove(stamp.absoluteFilePath());
+		}
+	}
+
+	QString ArchiveIndex::Materialize(const QString& entry, QString* error) const {
+		QString path = EntryPath(entry);
+		QDir cacheDir(CacheDir());
+		QString localPath = cacheDir.absoluteFilePath(path);
+		if (!Contains(path)) {
+			if (error != nullptr)
+				*error = QObject::tr("%1 is not in %2.").arg(path).arg(mArchive);
+			return QString();
+		}
+
+		//! Files that are already there with the right size are not extracted again.
+		std::vector<uint32_t> missing;
+		QVector<int> pending;
+		pending << mEntryIds[path];
+		while (!pending.isEmpty()) {
+			const ArchiveEntry& e = mEntries[pending.takeLast()];
+			if (e.dir) {
+				pending << mChildren.value(e.path);
+				continue;
+			}
+			QFileInfo local(cacheDir.absoluteFilePath(e.path));
+			if (e.index >= 0 && (!local.isFile() || (quint64)local.size() != e.size))
+				missing.push_back((uint32_t)e.index);
+		}
+		if (!missing.empty()) {
+			try {
+				BitArchiveReader reader{ SevenZipLibrary::Instance(), mArchive.toStdString(), BitFormat::Auto };
+				reader.extractTo(cacheDir.absolutePath().toStdString(), missing);
+			} catch (const bit7z::BitException& ex) {
+				if (error != nullptr)
+					*error = QString::fromLocal8Bit(ex.what());
+				return QString();
+			}
+		}
+		if (IsDir(path)) {
+			//! Empty directories have no item to extract.
+			cacheDir.mkpath(path.isEmpty() ? QString(".") : path);
+		}
+		QFile stamp(cacheDir.absolutePath() + ".used");
+		if (stamp.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+			stamp.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+			stamp.close();
+		}
+		return localPath;
+	}
+}
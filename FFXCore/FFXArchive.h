@@ -0,0 +1,77 @@
+#pragma once
+#include "FFXCore.h"
+
+#include <QString>
+#include <QStringList>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QVector>
+#include <QHash>
+
+#include <memory>
+#include <vector>
+
+namespace FFX {
+	struct ArchiveEntry {
+		//! Relative to the archive root, '/' separated.
+		QString path;
+		//! Item index in the archive, 7-Zip seeks to the item data by it, -1 for the directories that only exist as parents of other items.
+		qint64 index = -1;
+		quint64 size = 0;
+		quint64 packSize = 0;
+		QDateTime lastModified;
+		bool dir = false;
+
+		QString Name() const { return path.mid(path.lastIndexOf('/') + 1); }
+	};
+
+	/// <summary>
+	/// Entry index of an archive, read once from the archive headers with BitArchiveReader so the
+	/// archive can be browsed like a directory without extracting it. Entries are addressed by virtual
+	/// paths of the form "archive-path!entry-path", "archive-path!" being the root of the archive.
+	/// </summary>
+	class FFXCORE_EXPORT ArchiveIndex {
+	public:
+		static bool IsArchive(const QFileInfo& file);
+		static bool IsVirtualPath(const QString& path);
+		//! Splits a virtual path at the first '!' preceded by an existing file.
+		static bool SplitPath(const QString& path, QString& archive, QString& entry);
+		static QString JoinPath(const QString& archive, const QString& entry);
+		//! Parent of a virtual path, the root of an archive goes up to the directory of the archive.
+		static QString ParentPath(const QString& path);
+		//! Removes the cache directories of the archives not used for a day, the copies handed out recently may still be open.
+		static void PruneCache();
+		//! Loaded indexes are shared until the archive changes, returns nullptr if the archive cannot be read.
+		static std::shared_ptr<const ArchiveIndex> Open(const QString& archive, QString* error = nullptr);
+
+	public:
+		bool Load(const QString& archive, QString* error = nullptr);
+		QString Archive() const { return mArchive; }
+		const QVector<ArchiveEntry>& Entries() const { return mEntries; }
+		bool Contains(const QString& entry) const;
+		bool IsDir(const QString& entry) const;
+		const ArchiveEntry* Entry(const QString& entry) const;
+		QVector<ArchiveEntry> Children(const QString& dir) const;
+		//! Item indices of the entry and everything below it.
+		std::vector<uint32_t> Indices(const QString& entry) const;
+
+	public:
+		//! Extracts the entries into outputDir, keeping their paths relative to the archive root.
+		bool Extract(const QStringList& entries, const QString& outputDir, QString* error = nullptr) const;
+		//! Private directory of the archive where entries are extracted for copying out and previewing.
+		QString CacheDir() const;
+		//! Local copy of the entry in CacheDir, only the items that are not already there are extracted.
+		QString Materialize(const QString& entry, QString* error = nullptr) const;
+
+	private:
+		int AddDir(const QString& dir);
+
+	private:
+		QString mArchive;
+		QDateTime mLastModified;
+		QVector<ArchiveEntry> mEntries;
+		QHash<QString, int> mEntryIds;
+		QHash<QString, QVector<int>> mChildren;
+	};
+	typedef std::shared_ptr<const ArchiveIndex> ArchiveIndexPtr;
+}
@@ -0,0 +1,190 @@
+#include "FFXChecksum.h"
+
+#include <QFile>
+#include <QCryptographicHash>
+
+#include <xxhash/xxhash.h>
+#include <blake3/blake3.h>
+
+namespace FFX {
+	static const qint64 MapChunkSize = 16 << 20;
+	static const qint64 ReadChunkSize = 1 << 20;
+
+	//! The state of the vendored hashes, XXH3 states are allocated by the library because they need 64 byte alignment.
+	struct Checksum::State {
+		XXH64_state_t* xxh64 = nullptr;
+		XXH3_state_t* xxh3 = nullptr;
+		blake3_hasher blake3;
+
+		~State() {
+			XXH64_freeState(xxh64);
+			XXH3_freeState(xxh3);
+		}
+	};
+
+	static QCryptographicHash::Algorithm CryptoAlgorithm(Checksum::Algorithm algorithm) {
+		switch (algorithm) {
+		case Checksum::MD5:
+			return QCryptographicHash::Md5;
+		case Checksum::SHA1:
+			return QCryptographicHash::Sha1;
+		case Checksum::SHA512:
+			return QCryptographicHash::Sha512;
+		default:
+			return QCryptographicHash::Sha256;
+		}
+	}
+
+	/************************************************************************************************************************
+	 * Class： Checksum
+	 *
+	 *
+	/************************************************************************************************************************/
+	QStringList Checksum::AlgorithmNames() {
+		return QStringList() << "XXH64" << "MD5" << "SHA1" << "SHA256" << "SHA512" << "XXH3" << "BLAKE3";
+	}
+
+	QString Checksum::AlgorithmName(Algorithm algorithm) {
+		return AlgorithmNames().value(algorithm, "SHA256");
+	}
+
+	Checksum::Algorithm Checksum::AlgorithmByName(const QString& name, Algorithm def) {
+		QString n = name.toUpper().remove('-');
+		if (n == "XXH64" || n == "XXH")
+			return XXH64;
+		if (n == "XXH3")
+			return XXH3;
+		if (n == "BLAKE3" || n == "B3")
+			return BLAKE3;
+		if (n == "MD5")
+			return MD5;
+		if (n == "SHA1")
+			return SHA1;
+		if (n == "SHA256")
+			return SHA256;
+		if (n == "SHA512")
+			return SHA512;
+		return def;
+	}
+
+	QByteArray Checksum::HashFile(const QString& fileName, Algorithm algorithm, const std::function<bool(qint64)>& callback) {
+		QFile file(fileName);
+		if (!file.open(QIODevice::ReadOnly))
+			return QByteArray();
+
+		Checksum checksum(algorithm);
+		QByteArray buffer;
+		qint64 size = file.size();
+		qint64 offset = 0;
+		while (offset < size) {
+			qint64 chunk = qMin(MapChunkSize, size - offset);
+			uchar* data = file.map(offset, chunk);
+			if (data != nullptr) {
+				checksum.AddData((const char*)data, chunk);
+				file.unmap(data);
+			} else {
+				//! Files on some network shares cannot be mapped, they are read in large blocks instead.
+				if (buffer.isEmpty())
+					buffer.resize(ReadChunkSize);
+				if (!file.seek(offset))
+					return QByteArray();
+				chunk = file.read(buffer.data(), qMin(ReadChunkSize, size - offset));
+				if (chunk <= 0)
+					return QByteArray();
+				checksum.AddData(buffer.constData(), chunk);
+			}
+			offset += chunk;
+			if (callback && !callback(offset))
+				return QByteArray();
+		}
+		return checksum.Result();
+	}
+
+	Checksum::Checksum(Algorithm algorithm)
+		: mAlgorithm(algorithm) {
+		switch (mAlgorithm) {
+		case XXH64:
+			mState = new State;
+			mState->xxh64 = XXH64_createState();
+			break;
+		case XXH3:
+			mState = new State;
+			mState->xxh3 = XXH3_createState();
+			break;
+		case BLAKE3:
+			mState = new State;
+			break;
+		default:
+			mHash = new QCryptographicHash(CryptoAlgorithm(mAlgorithm));
+			break;
+		}
+		Reset();
+	}
+
+	Checksum::~Checksum() {
+		delete mHash;
+		delete mState;
+	}
+
+	void Checksum::Reset() {
+		switch (mAlgorithm) {
+		case XXH64:
+			XXH64_reset(mState->xxh64, 0);
+			break;
+		case XXH3:
+			XXH3_64bits_reset(mState->xxh3);
+			break;
+		case BLAKE3:
+			blake3_hasher_init(&mState->blake3);
+			break;
+		default:
+			mHash->reset();
+			break;
+		}
+	}
+
+	void Checksum::AddData(const char* data, qint64 size) {
+		switch (mAlgorithm) {
+		case XXH64:
+			XXH64_update(mState->xxh64, data, (size_t)size);
+			break;
+		case XXH3:
+			XXH3_64bits_update(mState->xxh3, data, (size_t)size);
+			break;
+		case BLAKE3:
+			blake3_hasher_update(&mState->blake3, data, (size_t)size);
+			break;
+		default:
+			//! QCryptographicHash takes int sizes.
+			while (size > 0) {
+				int n = (int)qMin<qint64>(size, 1 << 30);
+				mHash->addData(data, n);
+				data += n;
+				size -= n;
+			}
+			break;
+		}
+	}
+
+	QByteArray Checksum::Result() const {
+		switch (mAlgorithm) {
+		case XXH64: {
+			QByteArray result(sizeof(XXH64_canonical_t), 0);
+			XXH64_canonicalFromHash((XXH64_canonical_t*)result.data(), XXH64_digest(mState->xxh64));
+			return result;
+		}
+		case XXH3: {
+			QByteArray result(sizeof(XXH64_canonical_t), 0);
+			XXH64_canonicalFromHash((XXH64_canonical_t*)result.data(), XXH3_64bits_digest(mState->xxh3));
+			return result;
+		}
+		case BLAKE3: {
+			QByteArray result(BLAKE3_OUT_LEN, 0);
+			blake3_hasher_finalize(&mState->blake3, (uint8_t*)result.data(), BLAKE3_OUT_LEN);
+			return result;
+		}
+		default:
+			return mHash->result();
+		}
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "FFXCore.h"
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+
+#include <functional>
+
+class QCryptographicHash;
+
+namespace FFX {
+	/// <summary>
+	/// Incremental hash of file contents. XXH3 and XXH64 are fast non-cryptographic hashes for comparing copies and
+	/// finding duplicates, BLAKE3 is a fast cryptographic hash, both come from the sources vendored in 3rd. MD5 and the
+	/// SHA family are computed by QCryptographicHash so manifests can be checked by other tools.
+	/// </summary>
+	class FFXCORE_EXPORT Checksum {
+	public:
+		enum Algorithm {
+			XXH64 = 0,
+			MD5,
+			SHA1,
+			SHA256,
+			SHA512,
+			XXH3,
+			BLAKE3
+		};
+
+	public:
+		static QStringList AlgorithmNames();
+		static QString AlgorithmName(Algorithm algorithm);
+		//! Also accepts the suffixes of manifest files such as sha256 or md5, returns def if the name is unknown.
+		static Algorithm AlgorithmByName(const QString& name, Algorithm def = SHA256);
+		//! Hashes the whole file, mapping it into memory a chunk at a time. The callback receives the bytes hashed so far
+		//! and stops hashing when it returns false. Returns an empty array if the file cannot be read or hashing was stopped.
+		static QByteArray HashFile(const QString& file, Algorithm algorithm, const std::function<bool(qint64)>& callback = nullptr);
+
+	public:
+		Checksum(Algorithm algorithm = SHA256);
+		~Checksum();
+		Checksum(const Checksum&) = delete;
+		Checksum& operator=(const Checksum&) = delete;
+
+	public:
+		void AddData(const char* data, qint64 size);
+		void AddData(const QByteArray& data) { AddData(data.constData(), data.size()); }
+		//! The digest, XXH3 and XXH64 in their canonical big endian form, 32 bytes for BLAKE3.
+		QByteArray Result() const;
+		void Reset();
+		Algorithm Type() const { return mAlgorithm; }
+
+	private:
+		struct State;
+
+	private:
+		Algorithm mAlgorithm;
+		QCryptographicHash* mHash = nullptr;
+		State* mState = nullptr;
+	};
+}
@@ -0,0 +1,262 @@
+#include "FFXContentIndex.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QMutexLocker>
+
+namespace FFX {
+	static const quint32 IndexMagic = 0x46584349; // FXCI
+	static const quint32 IndexVersion = 1;
+	static const int MaxTermLength = 64;
+
+	/************************************************************************************************************************
+	 * Class： ContentIndex
+	 *
+	 *
+	/************************************************************************************************************************/
+	QString ContentIndex::IndexFileName() {
+		return QStringLiteral(".ffx-content.idx");
+	}
+
+	QStringList ContentIndex::Tokenize(const QString& text) {
+		QSet<QString> terms;
+		QString word;
+		QString han;
+		auto flushWord = [&]() {
+			if (!word.isEmpty() && word.size() <= MaxTermLength)
+				terms << word;
+			word.clear();
+		};
+		auto flushHan = [&]() {
+			if (han.size() == 1)
+				terms << han;
+			for (int i = 0; i + 1 < han.size(); i++)
+				terms << han.mid(i, 2);
+			han.clear();
+		};
+
+		for (const QChar& c : text) {
+			if (c.script() == QChar::Script_Han) {
+				flushWord();
+				han += c;
+			} else if (c.isLetterOrNumber()) {
+				flushHan();
+				word += c.toLower();
+			} else {
+				flushWord();
+				flushHan();
+			}
+		}
+		flushWord();
+		flushHan();
+		return terms.values();
+	}
+
+	std::shared_ptr<const ContentIndex> ContentIndex::Open(const QString& indexFile) {
+		static QMutex mutex;
+		static QHash<QString, QPair<QDateTime, ContentIndexPtr>> cache;
+
+		QFileInfo fileInfo(indexFile);
+		if (!fileInfo.exists())
+			return ContentIndexPtr();
+
+		QMutexLocker locker(&mutex);
+		QString key = fileInfo.absoluteFilePath();
+		auto it = cache.find(key);
+		if (it != cache.end() && it.value().first == fileInfo.lastModified())
+			return it.value().second;
+
+		std::shared_ptr<ContentIndex> index = std::make_shared<ContentIndex>();
+		if (!index->Load(key))
+			return ContentIndexPtr();
+		cache[key] = qMakePair(fileInfo.lastModified(), ContentIndexPtr(index));
+		return index;
+	}
+
+	ContentIndex::ContentIndex(const QString& root)
+		: mRoot(root) {}
+
+	bool ContentIndex::Load(const QString& indexFile) {
+		QFile file(indexFile);
+		if (!file.open(QIODevice::ReadOnly))
+			return false;
+
+		QDataStream in(&file);
+		in.setVersion(QDataStream::Qt_5_15);
+		quint32 magic, version, docCount, termCount;
+		in >> magic >> version;
+		if (magic != IndexMagic || version != IndexVersion)
+			return false;
+
+		mRoot = QFileInfo(indexFile).absolutePath();
+		mDocs.clear();
+		mDocIds.clear();
+		mPostings.clear();
+
+		in >> docCount;
+		for (quint32 i = 0; i < docCount && in.status() == QDataStream::Ok; i++) {
+			Document doc;
+			in >> doc.path >> doc.mtime;
+			mDocIds[doc.path] = mDocs.size();
+			mDocs << doc;
+		}
+		in >> termCount;
+		for (quint32 i = 0; i < termCount && in.status() == QDataStream::Ok; i++) {
+			QString term;
+			QVector<qint32> ids;
+			in >> term >> ids;
+			QVector<int>& postings = mPostings[term];
+			for (qint32 id : ids)
+				postings << id;
+		}
+		return in.status() == QDataStream::Ok;
+	}
+
+	bool ContentIndex::Save(const QString& indexFile) const {
+		//! Drop the removed documents and renumber the others.
+		QVector<int> idMap(mDocs.size(), -1);
+		QVector<Document> docs;
+		for (int i = 0; i < mDocs.size(); i++) {
+			if (mDocs[i].path.isEmpty())
+				continue;
+			idMap[i] = docs.size();
+			docs << mDocs[i];
+		}
+
+		QSaveFile file(indexFile);
+		if (!file.open(QIODevice::WriteOnly))
+			return false;
+
+		QDataStream out(&file);
+		out.setVersion(QDataStream::Qt_5_15);
+		out << IndexMagic << IndexVersion;
+		out << (quint32)docs.size();
+		for (const Document& doc : docs)
+			out << doc.path << doc.mtime;
+
+		QHash<QString, QVector<qint32>> postings;
+		for (auto it = mPostings.begin(); it != mPostings.end(); it++) {
+			QVector<qint32> ids;
+			for (int id : it.value()) {
+				if (idMap[id] >= 0)
+					ids << idMap[id];
+			}
+			if (!ids.isEmpty())
+				postings[it.key()] = ids;
+		}
+		out << (quint32)postings.size();
+		for (auto it = postings.begin(); it != postings.end(); it++)
+			out << it.key() << it.value();
+		return file.commit();
+	}
+
+	QString ContentIndex::RelativePath(const QString& file) const {
+		return QDir(mRoot).relativeFilePath(QFileInfo(file).absoluteFilePath());
+	}
+
+	bool ContentIndex::IsUpToDate(const QString& file, qint64 mtime) const {
+		auto it = mDocIds.find(RelativePath(file));
+		return it != mDocIds.end() && mDocs[it.value()].mtime == mtime;
+	}
+
+	void ContentIndex::Update(const QString& file, qint64 mtime, const QStringList& terms) {
+		Remove(file);
+		Document doc;
+		doc.path = RelativePath(file);
+		doc.mtime = mtime;
+		int id = mDocs.size();
+		mDocs << doc;
+		mDocIds[doc.path] = id;
+		for (const QString& term : terms)
+			mPostings[term] << id;
+	}
+
+	void ContentIndex::Remove(const QString& file) {
+		auto it = mDocIds.find(RelativePath(file));
+		if (it == mDocIds.end())
+			return;
+		int id = it.value();
+		mDocIds.erase(it);
+		//! Postings of the removed document are dropped when the index is saved.
+		mDocs[id].path.clear();
+	}
+
+	QStringList ContentIndex::Documents() const {
+		QStringList result;
+		QDir root(mRoot);
+		for (const Document& doc : mDocs) {
+			if (!doc.path.isEmpty())
+				result << root.absoluteFilePath(doc.path);
+		}
+		return result;
+	}
+
+	QSet<QString> ContentIndex::Match(const QString& query) const {
+		QSet<QString> result;
+		QStringList terms = Tokenize(query);
+		if (terms.isEmpty())
+			return result;
+
+		QSet<int> ids;
+		for (int i = 0; i < terms.size(); i++) {
+			auto it = mPostings.find(terms[i]);
+			if (it == mPostings.end())
+				return result;
+			QSet<int> termIds(it.value().begin(), it.value().end());
+			if (i == 0)
+				ids = termIds;
+			else
+				ids.intersect(termIds);
+			if (ids.isEmpty())
+				return result;
+		}
+
+		QDir root(mRoot);
+		for (int id : ids) {
+			if (!mDocs[id].path.isEmpty())
+				result << QDir::cleanPath(root.absoluteFilePath(mDocs[id].path));
+		}
+		return result;
+	}
+
+	/************************************************************************************************************************
+	 * Class： ContentFileFilter
+	 *
+	 *
+	/************************************************************************************************************************/
+	ContentIndexPtr ContentFileFilter::FindIndex(const QString& dir) const {
+		auto it = mDirIndexes.find(dir);
+		if (it != mDirIndexes.end())
+			return it.value();
+
+		ContentIndexPtr index;
+		QDir d(dir);
+		if (d.exists(ContentIndex::IndexFileName())) {
+			index = ContentIndex::Open(d.absoluteFilePath(ContentIndex::IndexFileName()));
+		} else if (d.cdUp()) {
+			index = FindIndex(d.absolutePath());
+		}
+		mDirIndexes[dir] = index;
+		return index;
+	}
+
+	bool ContentFileFilter::Accept(const QFileInfo& file) const {
+		if (!file.isFile())
+			return false;
+
+		QMutexLocker locker(&mMutex);
+		ContentIndexPtr index = FindIndex(file.absolutePath());
+		if (index == nullptr)
+			return false;
+
+		auto it = mMatches.find(index.get());
+		if (it == mMatches.end()) {
+			it = mMatches.insert(index.get(), index->Match(mQuery));
+		}
+		return it.value().contains(QDir::cleanPath(file.absoluteFilePath()));
+	}
+}
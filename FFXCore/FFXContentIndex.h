@@ -0,0 +1,77 @@
+#pragma once
+#include "FFXCore.h"
+#include "FFXFileFilter.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+
+namespace FFX {
+	/// <summary>
+	/// Inverted index of the text content of the files in a directory tree, stored in the root
+	/// directory of the tree. Documents are kept by path relative to the root and by mtime, so an
+	/// index can be updated incrementally.
+	/// </summary>
+	class FFXCORE_EXPORT ContentIndex {
+	public:
+		static QString IndexFileName();
+		//! Lower case words, runs of Han characters are split into bigrams as they have no separators.
+		static QStringList Tokenize(const QString& text);
+		//! Loaded indexes are shared until the index file changes.
+		static std::shared_ptr<const ContentIndex> Open(const QString& indexFile);
+
+	public:
+		ContentIndex(const QString& root = QString());
+
+	public:
+		bool Load(const QString& indexFile);
+		bool Save(const QString& indexFile) const;
+		QString Root() const { return mRoot; }
+		bool IsUpToDate(const QString& file, qint64 mtime) const;
+		void Update(const QString& file, qint64 mtime, const QStringList& terms);
+		void Remove(const QString& file);
+		//! Absolute paths of all indexed documents.
+		QStringList Documents() const;
+		//! Absolute paths of the documents containing all terms of the query.
+		QSet<QString> Match(const QString& query) const;
+
+	private:
+		QString RelativePath(const QString& file) const;
+
+	private:
+		struct Document {
+			QString path;
+			qint64 mtime = 0;
+		};
+		QString mRoot;
+		QVector<Document> mDocs;
+		QHash<QString, int> mDocIds;
+		QHash<QString, QVector<int>> mPostings;
+	};
+	typedef std::shared_ptr<const ContentIndex> ContentIndexPtr;
+
+	/// <summary>
+	/// Accepts the files whose content contains all terms of the query, looked up in the nearest
+	/// content index found in the directory of the file or its parents. Used for "content:" terms.
+	/// </summary>
+	class FFXCORE_EXPORT ContentFileFilter : public FileFilter {
+	public:
+		ContentFileFilter(const QString& query)
+			: mQuery(query) {}
+
+	public:
+		virtual bool Accept(const QFileInfo& file) const override;
+
+	private:
+		ContentIndexPtr FindIndex(const QString& dir) const;
+
+	private:
+		QString mQuery;
+		mutable QMutex mMutex;
+		mutable QHash<QString, ContentIndexPtr> mDirIndexes;
+		mutable QHash<const ContentIndex*, QSet<QString>> mMatches;
+	};
+}
@@ -0,0 +1,259 @@
+#include "FFXDiskUsage.h"
+#include "FFXFileSystem.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QThreadPool>
+#include <QAtomicInteger>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+
+namespace FFX {
+	static const quint32 DiskUsageMagic = 0x46465844;
+	static const qint32 DiskUsageVersion = 1;
+	static const int ScanReportInterval = 1000;
+
+	//! Scans the directories of a tree on a thread pool, each directory is one task that queues its subdirectories.
+	class DiskUsageScanner {
+	public:
+		DiskUsageScanner(QVector<DiskUsageNode>& nodes, const DiskUsageTree& previous, quint64 device, int maxParallel,
+			const std::function<void(qint64)>& scanned, const std::function<bool()>& cancelled)
+			: mNodes(nodes)
+			, mPrevious(previous)
+			, mDevice(device)
+			, mScannedCallback(scanned)
+			, mCancelled(cancelled) {
+			mPool.setMaxThreadCount(maxParallel > 0 ? maxParallel : QThread::idealThreadCount());
+		}
+
+	public:
+		void Run(const QString& root, int previousRoot) {
+			mPool.start([this, root, previousRoot]() { ScanDir(0, previousRoot, root); });
+			mPool.waitForDone();
+		}
+
+		qint64 ListedCount() const { return mListed.loadRelaxed(); }
+
+	private:
+		void ScanDir(int node, int previous, const QString& path) {
+			if (mCancelled())
+				return;
+			quint64 device = 0, inode = 0;
+			//! Other file systems mounted below the root are left out, they are analyzed from their own root.
+			if (!FileSystem::FileId(path, device, inode) || device != mDevice)
+				return;
+			qint64 lastModified = QFileInfo(path).lastModified().toMSecsSinceEpoch();
+
+			QStringList names;
+			QVector<int> previousChildren;
+			qint64 ownSize = 0;
+			qint64 ownFiles = 0;
+			const DiskUsageNode* old = previous >= 0 ? &mPrevious.Node(previous) : nullptr;
+			if (old != nullptr && old->inode == inode && old->lastModified == lastModified) {
+				//! No entry was added, removed or renamed, the subdirectories are still checked on their own.
+				ownSize = old->ownSize;
+				ownFiles = old->ownFiles;
+				for (int i = old->firstChild; i < old->firstChild + old->childCount; i++) {
+					names << mPrevious.Node(i).name;
+					previousChildren << i;
+				}
+			} else {
+				mListed++;
+				QHash<QString, int> oldChildren;
+				if (old != nullptr) {
+					for (int i = old->firstChild; i < old->firstChild + old->childCount; i++)
+						oldChildren[mPrevious.Node(i).name] = i;
+				}
+				QFileInfoList entries = QDir(path).entryInfoList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+				for (const QFileInfo& entry : entries) {
+					if (entry.isDir() && !entry.isSymLink()) {
+						names << entry.fileName();
+						previousChildren << oldChildren.value(entry.fileName(), -1);
+						continue;
+					}
+					ownFiles++;
+					//! Links are not followed, their targets are counted where they are.
+					if (!entry.isSymLink())
+						ownSize += entry.size();
+				}
+			}
+
+			int firstChild = 0;
+			{
+				QMutexLocker locker(&mMutex);
+				firstChild = mNodes.size();
+				DiskUsageNode& n = mNodes[node];
+				n.inode = inode;
+				n.lastModified = lastModified;
+				n.ownSize = ownSize;
+				n.ownFiles = ownFiles;
+				n.firstChild = firstChild;
+				n.childCount = names.size();
+				for (const QString& name : names) {
+					DiskUsageNode child;
+					child.name = name;
+					child.parent = node;
+					mNodes << child;
+				}
+			}
+			qint64 scanned = ++mScanned;
+			if (scanned % ScanReportInterval == 0)
+				mScannedCallback(scanned);
+
+			QString prefix = path.endsWith('/') ? path : path + '/';
+			for (int i = 0; i < names.size(); i++) {
+				int child = firstChild + i;
+				int previousChild = previousChildren[i];
+				QString childPath = prefix + names[i];
+				mPool.start([this, child, previousChild, childPath]() { ScanDir(child, previousChild, childPath); });
+			}
+		}
+
+	private:
+		QVector<DiskUsageNode>& mNodes;
+		const DiskUsageTree& mPrevious;
+		quint64 mDevice;
+		std::function<void(qint64)> mScannedCallback;
+		std::function<bool()> mCancelled;
+		QThreadPool mPool;
+		QMutex mMutex;
+		QAtomicInteger<qint64> mScanned{ 0 };
+		QAtomicInteger<qint64> mListed{ 0 };
+	};
+
+	/************************************************************************************************************************
+	 * Class： DiskUsageTree
+	 *
+	 *
+	/************************************************************************************************************************/
+	QString DiskUsageTree::CachePath(const QString& root) {
+		QCryptographicHash hash(QCryptographicHash::Sha1);
+		hash.addData(QFileInfo(root).absoluteFilePath().toUtf8());
+		QDir dir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation));
+		return dir.absoluteFilePath(QString("diskusage/%1.cache").arg(QString(hash.result().toHex().left(16))));
+	}
+
+	bool DiskUsageTree::Scan(const QString& root, int maxParallel, const DiskUsageTree& previous,
+		const std::function<void(qint64 scanned)>& scanned,
+		const std::function<bool()>& cancelled) {
+		mRoot = QFileInfo(root).absoluteFilePath();
+		mNodes.clear();
+		mListedCount = 0;
+		quint64 device = 0, inode = 0;
+		if (!FileSystem::FileId(mRoot, device, inode))
+			return false;
+
+		DiskUsageNode node;
+		node.name = mRoot;
+		mNodes << node;
+		int previousRoot = !previous.IsEmpty() && previous.Root() == mRoot ? 0 : -1;
+		DiskUsageScanner scanner(mNodes, previous, device, maxParallel, scanned, cancelled);
+		scanner.Run(mRoot, previousRoot);
+		mListedCount = scanner.ListedCount();
+		if (cancelled())
+			return false;
+		Aggregate();
+		return true;
+	}
+
+	void DiskUsageTree::Aggregate() {
+		for (DiskUsageNode& node : mNodes) {
+			node.size = node.ownSize;
+			node.files = node.ownFiles;
+			node.dirs = 0;
+		}
+		//! Children are always stored after their parent, a reverse pass adds every subtree before its parent is read.
+		for (int i = mNodes.size() - 1; i > 0; i--) {
+			const DiskUsageNode& node = mNodes[i];
+			DiskUsageNode& parent = mNodes[node.parent];
+			parent.size += node.size;
+			parent.files += node.files;
+			parent.dirs += node.dirs + 1;
+		}
+	}
+
+	bool DiskUsageTree::Load(const QString& cacheFile) {
+		mRoot.clear();
+		mNodes.clear();
+		mListedCount = 0;
+		QFile file(cacheFile);
+		if (!file.open(QIODevice::ReadOnly))
+			return false;
+		QDataStream in(&file);
+		in.setVersion(QDataStream::Qt_5_15);
+		quint32 magic = 0;
+		qint32 version = 0;
+		qint32 count = 0;
+		in >> magic >> version;
+		if (magic != DiskUsageMagic || version != DiskUsageVersion)
+			return false;
+		in >> mRoot >> count;
+		if (in.status() != QDataStream::Ok || count < 0)
+			return false;
+		mNodes.resize(count);
+		for (DiskUsageNode& node : mNodes) {
+			in >> node.name >> node.parent >> node.firstChild >> node.childCount >> node.inode >> node.lastModified >> node.ownSize >> node.ownFiles;
+		}
+		if (in.status() != QDataStream::Ok) {
+			mNodes.clear();
+			return false;
+		}
+		Aggregate();
+		return true;
+	}
+
+	bool DiskUsageTree::Save(const QString& cacheFile) const {
+		QDir().mkpath(QFileInfo(cacheFile).absolutePath());
+		QSaveFile file(cacheFile);
+		if (!file.open(QIODevice::WriteOnly))
+			return false;
+		QDataStream out(&file);
+		out.setVersion(QDataStream::Qt_5_15);
+		out << DiskUsageMagic << DiskUsageVersion << mRoot << (qint32)mNodes.size();
+		for (const DiskUsageNode& node : mNodes) {
+			out << node.name << node.parent << node.firstChild << node.childCount << node.inode << node.lastModified << node.ownSize << node.ownFiles;
+		}
+		return file.commit();
+	}
+
+	QString DiskUsageTree::Path(int index) const {
+		QStringList names;
+		for (int i = index; i > 0; i = mNodes[i].parent)
+			names.prepend(mNodes[i].name);
+		if (names.isEmpty())
+			return mRoot;
+		return (mRoot.endsWith('/') ? mRoot : mRoot + '/') + names.join('/');
+	}
+
+	int DiskUsageTree::Find(const QString& path) const {
+		if (mNodes.isEmpty())
+			return -1;
+		QString relative = QDir(mRoot).relativeFilePath(QFileInfo(path).absoluteFilePath());
+		if (relative == ".")
+			return 0;
+		if (relative.startsWith("../"))
+			return -1;
+		int index = 0;
+		for (const QString& name : relative.split('/', Qt::SkipEmptyParts)) {
+			const DiskUsageNode& node = mNodes[index];
+			int found = -1;
+			for (int i = node.firstChild; i < node.firstChild + node.childCount; i++) {
+				if (mNodes[i].name == name) {
+					found = i;
+					break;
+				}
+			}
+			if (found < 0)
+				return -1;
+			index = found;
+		}
+		return index;
+	}
+}
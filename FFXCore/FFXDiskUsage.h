@@ -0,0 +1,67 @@
+#pragma once
+#include "FFXCore.h"
+
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+namespace FFX {
+	//! A directory of the tree, the files are only counted into their directory.
+	struct DiskUsageNode {
+		QString name;
+		int parent = -1;
+		//! The subdirectories are stored one after another from firstChild.
+		int firstChild = 0;
+		int childCount = 0;
+		//! Key of the cached entries of the directory, it is listed again only when either one changes.
+		quint64 inode = 0;
+		qint64 lastModified = 0;
+		//! Files directly in the directory.
+		qint64 ownSize = 0;
+		qint64 ownFiles = 0;
+		//! Cumulative over the whole subtree, computed after the scan and the load.
+		qint64 size = 0;
+		qint64 files = 0;
+		qint64 dirs = 0;
+	};
+
+	/// <summary>
+	/// Per directory sizes and file counts of a directory tree, stays on the device of the root. The directories are
+	/// scanned in parallel and the tree is cached, a scan reuses the entries of the cached directories whose inode
+	/// and modification time did not change. A file changed in place does not touch its directory, its new size is
+	/// only seen when the directory is listed again.
+	/// </summary>
+	class FFXCORE_EXPORT DiskUsageTree {
+	public:
+		//! Cache file of the tree of root.
+		static QString CachePath(const QString& root);
+
+	public:
+		//! scanned is called with the number of directories done so far from the worker threads.
+		bool Scan(const QString& root, int maxParallel, const DiskUsageTree& previous,
+			const std::function<void(qint64 scanned)>& scanned,
+			const std::function<bool()>& cancelled);
+		bool Load(const QString& cacheFile);
+		bool Save(const QString& cacheFile) const;
+
+	public:
+		bool IsEmpty() const { return mNodes.isEmpty(); }
+		QString Root() const { return mRoot; }
+		const QVector<DiskUsageNode>& Nodes() const { return mNodes; }
+		const DiskUsageNode& Node(int index) const { return mNodes[index]; }
+		QString Path(int index) const;
+		//! Node of the directory, -1 if it is not in the tree.
+		int Find(const QString& path) const;
+		//! Directories listed in the last scan, the others were taken from the cache.
+		qint64 ListedCount() const { return mListedCount; }
+
+	private:
+		void Aggregate();
+
+	private:
+		QString mRoot;
+		QVector<DiskUsageNode> mNodes;
+		qint64 mListedCount = 0;
+	};
+}
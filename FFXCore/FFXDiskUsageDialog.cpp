@@ -0,0 +1,328 @@
+#include "FFXDiskUsageDialog.h"
+#include "FFXFileHandler.h"
+#include "FFXTaskPanel.h"
+#include "FFXMainWindow.h"
+#include "FFXString.h"
+
+#include <QLabel>
+#include <QGridLayout>
+#include <QSpacerItem>
+#include <QSplitter>
+#include <QToolButton>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QPainter>
+#include <QMouseEvent>
+#include <QFile>
+
+#include <algorithm>
+
+namespace FFX {
+	enum DiskUsageColumn {
+		NameColumn,
+		SizeColumn,
+		FilesColumn,
+		PercentColumn
+	};
+
+	//! Items sort by the numbers kept in their data, not by the size hints shown.
+	class DiskUsageItem : public QTreeWidgetItem {
+	public:
+		using QTreeWidgetItem::QTreeWidgetItem;
+
+		virtual bool operator<(const QTreeWidgetItem& other) const override {
+			int column = treeWidget() == nullptr ? NameColumn : treeWidget()->sortColumn();
+			if (column == NameColumn)
+				return text(column).compare(other.text(column), Qt::CaseInsensitive) < 0;
+			return data(column, Qt::UserRole).toLongLong() < other.data(column, Qt::UserRole).toLongLong();
+		}
+	};
+
+	/************************************************************************************************************************
+	 * Class： DiskUsageTreemap
+	 *
+	 *
+	/************************************************************************************************************************/
+	DiskUsageTreemap::DiskUsageTreemap(QWidget* parent)
+		: QWidget(parent) {
+		setMinimumSize(QSize(320, 240));
+	}
+
+	void DiskUsageTreemap::SetTree(const DiskUsageTree* tree) {
+		mTree = tree;
+		mNode = -1;
+		Layout();
+		update();
+	}
+
+	void DiskUsageTreemap::SetNode(int node) {
+		mNode = node;
+		Layout();
+		update();
+	}
+
+	void DiskUsageTreemap::Layout() {
+		mCells.clear();
+		if (mTree == nullptr || mNode < 0 || mNode >= mTree->Nodes().size())
+			return;
+
+		const DiskUsageNode& node = mTree->Node(mNode);
+		QVector<Cell> cells;
+		for (int i = node.firstChild; i < node.firstChild + node.childCount; i++) {
+			if (mTree->Node(i).size > 0)
+				cells << Cell{ i, mTree->Node(i).size, QRectF() };
+		}
+		if (node.ownSize > 0)
+			cells << Cell{ -1, node.ownSize, QRectF() };
+		std::sort(cells.begin(), cells.end(), [](const Cell& a, const Cell& b) { return a.size > b.size; });
+		qint64 total = 0;
+		for (const Cell& cell : cells)
+			total += cell.size;
+		QRectF rect = QRectF(this->rect()).adjusted(1, 1, -1, -1);
+		if (total == 0 || rect.isEmpty())
+			return;
+
+		//! Squarified layout: a row along the short side grows while its worst aspect ratio improves.
+		double scale = rect.width() * rect.height() / total;
+		int start = 0;
+		while (start < cells.size()) {
+			double side = qMin(rect.width(), rect.height());
+			double rowArea = 0;
+			double worst = 0;
+			int end = start;
+			while (end < cells.size()) {
+				double area = rowArea + cells[end].size * scale;
+				double ratio = qMax(side * side * cells[start].size * scale / (area * area), area * area / (side * side * cells[end].size * scale));
+				if (end > start && ratio > worst)
+					break;
+				worst = ratio;
+				rowArea = area;
+				end++;
+			}
+			double thickness = rowArea / side;
+			bool wide = rect.width() >= rect.height();
+			double offset = 0;
+			for (int i = start; i < end; i++) {
+				double length = cells[i].size * scale / thickness;
+				cells[i].rect = wide ? QRectF(rect.left(), rect.top() + offset, thickness, length) : QRectF(rect.left() + offset, rect.top(), length, thickness);
+				offset += length;
+				mCells << cells[i];
+			}
+			if (wide)
+				rect.setLeft(rect.left() + thickness);
+			else
+				rect.setTop(rect.top() + thickness);
+			start = end;
+		}
+	}
+
+	int DiskUsageTreemap::NodeAt(const QPoint& pos) const {
+		for (const Cell& cell : mCells) {
+			if (cell.rect.contains(pos))
+				return cell.node;
+		}
+		return -1;
+	}
+
+	void DiskUsageTreemap::paintEvent(QPaintEvent* event) {
+		Q_UNUSED(event)
+		QPainter painter(this);
+		painter.fillRect(rect(), palette().base());
+		for (int i = 0; i < mCells.size(); i++) {
+			const Cell& cell = mCells[i];
+			QColor color = cell.node < 0 ? QColor(Qt::lightGray) : QColor::fromHsv((i * 47) % 360, 90, 230);
+			painter.fillRect(cell.rect, color);
+			painter.setPen(palette().color(QPalette::Mid));
+			painter.drawRect(cell.rect);
+			if (cell.rect.width() < 48 || cell.rect.height() < 32)
+				continue;
+			QString name = cell.node < 0 ? QObject::tr("Files") : mTree->Node(cell.node).name;
+			painter.setPen(Qt::black);
+			painter.drawText(cell.rect.adjusted(4, 4, -4, -4), Qt::AlignLeft | Qt::AlignTop | Qt::TextWordWrap,
+				QString("%1\n%2").arg(name).arg(String::BytesHint(cell.size)));
+		}
+	}
+
+	void DiskUsageTreemap::resizeEvent(QResizeEvent* event) {
+		QWidget::resizeEvent(event);
+		Layout();
+	}
+
+	void DiskUsageTreemap::mouseDoubleClickEvent(QMouseEvent* event) {
+		int node = NodeAt(event->pos());
+		if (node >= 0)
+			emit NodeActivated(node);
+	}
+
+	/************************************************************************************************************************
+	 * Class： DiskUsageDialog
+	 *
+	 *
+	/************************************************************************************************************************/
+	DiskUsageDialog::DiskUsageDialog(const QFileInfo& dir, QWidget* parent)
+		: QDialog(parent)
+		, mDir(dir) {
+		SetupUi();
+		//! The tree of the last analysis is shown while the directories changed since are listed again.
+		if (mTree.Load(DiskUsageTree::CachePath(mDir.absoluteFilePath())))
+			ShowTree();
+		Analyze();
+	}
+
+	DiskUsageDialog::~DiskUsageDialog()
+	{}
+
+	void DiskUsageDialog::SetupUi() {
+		setWindowTitle(QObject::tr("Disk Usage"));
+		resize(QSize(1280, 800));
+		setWindowFlags(Qt::WindowCloseButtonHint);
+
+		mInfoLabel = new QLabel(QObject::tr("Analyzing..."));
+		mDirTree = new QTreeWidget;
+		mDirTree->setColumnCount(4);
+		mDirTree->setHeaderLabels(QStringList() << QObject::tr("Directory") << QObject::tr("Size") << QObject::tr("Files") << QObject::tr("Percent"));
+		mDirTree->header()->setSectionResizeMode(NameColumn, QHeaderView::Stretch);
+		mDirTree->header()->setSectionResizeMode(SizeColumn, QHeaderView::ResizeToContents);
+		mDirTree->header()->setSectionResizeMode(FilesColumn, QHeaderView::ResizeToContents);
+		mDirTree->header()->setSectionResizeMode(PercentColumn, QHeaderView::ResizeToContents);
+		mDirTree->header()->setStretchLastSection(false);
+		mDirTree->setSortingEnabled(true);
+		mDirTree->sortByColumn(SizeColumn, Qt::DescendingOrder);
+		mTreemap = new DiskUsageTreemap;
+		mTreemap->SetTree(&mTree);
+		mSplitter = new QSplitter;
+		mSplitter->addWidget(mDirTree);
+		mSplitter->addWidget(mTreemap);
+		mSplitter->setStretchFactor(0, 2);
+		mSplitter->setStretchFactor(1, 3);
+
+		mAnalyzeButton = new QToolButton;
+		mAnalyzeButton->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
+		mAnalyzeButton->setText(QObject::tr("Analyze Again"));
+		mAnalyzeButton->setIcon(QIcon(":/ffx/res/image/refresh.svg"));
+		mCloseButton = new QToolButton;
+		mCloseButton->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
+		mCloseButton->setText(QObject::tr("Close"));
+		mCloseButton->setIcon(QIcon(":/ffx/res/image/cancel.svg"));
+
+		mMainLayout = new QGridLayout;
+		mMainLayout->addWidget(mInfoLabel, 0, 0, 1, 3);
+		mMainLayout->addWidget(mSplitter, 1, 0, 1, 3);
+		mMainLayout->addItem(new QSpacerItem(20, 20, QSizePolicy::Expanding, QSizePolicy::Minimum), 2, 0, 1, 1);
+		mMainLayout->addWidget(mAnalyzeButton, 2, 1, 1, 1);
+		mMainLayout->addWidget(mCloseButton, 2, 2, 1, 1);
+		mMainLayout->setRowStretch(1, 1);
+		setLayout(mMainLayout);
+
+		connect(MainWindow::Instance()->TaskPanelPtr(), &TaskPanel::TaskFileHandled, this, &DiskUsageDialog::OnFileHandled);
+		connect(MainWindow::Instance()->TaskPanelPtr(), &TaskPanel::TaskComplete, this, &DiskUsageDialog::OnTaskComplete);
+		connect(mDirTree, &QTreeWidget::itemExpanded, this, &DiskUsageDialog::PopulateChildren);
+		connect(mDirTree, &QTreeWidget::currentItemChanged, this, [this](QTreeWidgetItem* current) {
+			if (current == nullptr)
+				return;
+			int node = current->data(NameColumn, Qt::UserRole).toInt();
+			//! The files of a directory show the treemap of the directory.
+			if (node < 0 && current->parent() != nullptr)
+				node = current->parent()->data(NameColumn, Qt::UserRole).toInt();
+			mTreemap->SetNode(node);
+			});
+		connect(mTreemap, &DiskUsageTreemap::NodeActivated, this, &DiskUsageDialog::SelectNode);
+		connect(mAnalyzeButton, &QToolButton::clicked, this, &DiskUsageDialog::Analyze);
+		connect(mCloseButton, &QToolButton::clicked, this, &DiskUsageDialog::reject);
+	}
+
+	void DiskUsageDialog::Analyze() {
+		if (mTaskId >= 0)
+			return;
+		mAnalyzeButton->setEnabled(false);
+		mInfoLabel->setText(QObject::tr("Analyzing %1...").arg(mDir.absoluteFilePath()));
+		mTaskId = MainWindow::Instance()->TaskPanelPtr()->Submit(QFileInfoList() << mDir, std::make_shared<DiskUsageHandler>());
+	}
+
+	void DiskUsageDialog::ShowTree() {
+		mDirTree->clear();
+		mTreemap->SetTree(&mTree);
+		if (mTree.IsEmpty())
+			return;
+		QTreeWidgetItem* root = AddItem(nullptr, 0);
+		root->setExpanded(true);
+		mDirTree->setCurrentItem(root);
+	}
+
+	QTreeWidgetItem* DiskUsageDialog::AddItem(QTreeWidgetItem* parent, int node) {
+		//! node is -1 for the files directly in the parent.
+		const DiskUsageNode& parentNode = mTree.Node(parent == nullptr ? 0 : parent->data(NameColumn, Qt::UserRole).toInt());
+		qint64 size = node < 0 ? parentNode.ownSize : mTree.Node(node).size;
+		qint64 files = node < 0 ? parentNode.ownFiles : mTree.Node(node).files;
+		qint64 permyriad = parentNode.size == 0 ? 0 : size * 10000 / parentNode.size;
+		QString name = node < 0 ? QObject::tr("[Files]") : (node == 0 ? mTree.Root() : mTree.Node(node).name);
+
+		QStringList texts;
+		texts << name << String::BytesHint(size) << QString::number(files) << QString("%1%").arg(permyriad / 100.0, 0, 'f', 1);
+		QTreeWidgetItem* item = parent == nullptr ? new DiskUsageItem(mDirTree, texts) : new DiskUsageItem(parent, texts);
+		item->setData(NameColumn, Qt::UserRole, node);
+		item->setData(SizeColumn, Qt::UserRole, size);
+		item->setData(FilesColumn, Qt::UserRole, files);
+		item->setData(PercentColumn, Qt::UserRole, permyriad);
+		if (node >= 0 && mTree.Node(node).childCount > 0)
+			item->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+		return item;
+	}
+
+	void DiskUsageDialog::PopulateChildren(QTreeWidgetItem* item) {
+		int node = item->data(NameColumn, Qt::UserRole).toInt();
+		//! Items are created when their parent is expanded, a large volume has millions of directories.
+		if (node < 0 || item->childCount() > 0)
+			return;
+		const DiskUsageNode& n = mTree.Node(node);
+		for (int i = n.firstChild; i < n.firstChild + n.childCount; i++)
+			AddItem(item, i);
+		if (n.ownFiles > 0 && n.childCount > 0)
+			AddItem(item, -1);
+	}
+
+	void DiskUsageDialog::SelectNode(int node) {
+		QVector<int> chain;
+		for (int i = node; i > 0; i = mTree.Node(i).parent)
+			chain.prepend(i);
+		QTreeWidgetItem* item = mDirTree->topLevelItem(0);
+		if (item == nullptr)
+			return;
+		for (int next : chain) {
+			PopulateChildren(item);
+			item->setExpanded(true);
+			QTreeWidgetItem* child = nullptr;
+			for (int i = 0; i < item->childCount() && child == nullptr; i++) {
+				if (item->child(i)->data(NameColumn, Qt::UserRole).toInt() == next)
+					child = item->child(i);
+			}
+			if (child == nullptr)
+				break;
+			item = child;
+		}
+		mDirTree->setCurrentItem(item);
+		mDirTree->scrollToItem(item);
+	}
+
+	void DiskUsageDialog::OnFileHandled(int taskId, const QFileInfo& fileInput, const QFileInfo& fileOutput, bool success, const QString& message) {
+		if (taskId != mTaskId)
+			return;
+		mInfoLabel->setText(message);
+	}
+
+	void DiskUsageDialog::OnTaskComplete(int taskId, bool success) {
+		if (taskId != mTaskId)
+			return;
+		mTaskId = -1;
+		mAnalyzeButton->setEnabled(true);
+		if (success && mTree.Load(DiskUsageTree::CachePath(mDir.absoluteFilePath())))
+			ShowTree();
+	}
+
+	void DiskUsageDialog::reject() {
+		if (mTaskId >= 0) {
+			MainWindow::Instance()->TaskPanelPtr()->Cancel(mTaskId);
+		}
+		QDialog::reject();
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "FFXDiskUsage.h"
+
+#include <QDialog>
+#include <QWidget>
+#include <QFileInfo>
+#include <QVector>
+#include <QRectF>
+
+class QLabel;
+class QGridLayout;
+class QSplitter;
+class QToolButton;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+namespace FFX {
+	/// <summary>
+	/// Squarified treemap of the subdirectories of one node of a DiskUsageTree, the files directly in the node
+	/// share one rectangle. Double clicking the rectangle of a directory goes into it.
+	/// </summary>
+	class DiskUsageTreemap : public QWidget {
+		Q_OBJECT
+
+	public:
+		DiskUsageTreemap(QWidget* parent = nullptr);
+
+	public:
+		void SetTree(const DiskUsageTree* tree);
+		void SetNode(int node);
+
+	Q_SIGNALS:
+		void NodeActivated(int node);
+
+	protected:
+		virtual void paintEvent(QPaintEvent* event) override;
+		virtual void resizeEvent(QResizeEvent* event) override;
+		virtual void mouseDoubleClickEvent(QMouseEvent* event) override;
+
+	private:
+		struct Cell {
+			//! Node of the directory, -1 for the files of the current node.
+			int node;
+			qint64 size;
+			QRectF rect;
+		};
+
+		void Layout();
+		int NodeAt(const QPoint& pos) const;
+
+	private:
+		const DiskUsageTree* mTree = nullptr;
+		int mNode = -1;
+		QVector<Cell> mCells;
+	};
+
+	/// <summary>
+	/// Runs a DiskUsageHandler task on a directory and shows the tree of directories sorted by size, beside the
+	/// treemap of the selected directory. Analyzing again only lists the directories changed since the last time.
+	/// </summary>
+	class DiskUsageDialog : public QDialog {
+		Q_OBJECT
+
+	public:
+		DiskUsageDialog(const QFileInfo& dir, QWidget* parent = nullptr);
+		~DiskUsageDialog();
+
+	private:
+		void SetupUi();
+		void Analyze();
+		void ShowTree();
+		QTreeWidgetItem* AddItem(QTreeWidgetItem* parent, int node);
+		void PopulateChildren(QTreeWidgetItem* item);
+		void SelectNode(int node);
+
+	private slots:
+		void OnFileHandled(int taskId, const QFileInfo& fileInput, const QFileInfo& fileOutput, bool success, const QString& message);
+		void OnTaskComplete(int taskId, bool success);
+		virtual void reject();
+
+	private:
+		QFileInfo mDir;
+		int mTaskId = -1;
+		DiskUsageTree mTree;
+		QLabel* mInfoLabel;
+		QSplitter* mSplitter;
+		QTreeWidget* mDirTree;
+		DiskUsageTreemap* mTreemap;
+		QToolButton* mAnalyzeButton;
+		QToolButton* mCloseButton;
+		QGridLayout* mMainLayout;
+	};
+}
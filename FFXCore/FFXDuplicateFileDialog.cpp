@@ -0,0 +1,158 @@
+#include "FFXDuplicateFileDialog.h"
+#include "FFXFileHandler.h"
+#include "FFXTaskPanel.h"
+#include "FFXMainWindow.h"
+#include "FFXString.h"
+
+#include <QLabel>
+#include <QGridLayout>
+#include <QSpacerItem>
+#include <QToolButton>
+#include <QTreeWidget>
+#include <QHeaderView>
+
+namespace FFX {
+	/************************************************************************************************************************
+	 * Class： DuplicateFileDialog
+	 *
+	 *
+	/************************************************************************************************************************/
+	DuplicateFileDialog::DuplicateFileDialog(QFileInfoList files, QWidget* parent)
+		: QDialog(parent)
+		, mFiles(files) {
+		SetupUi();
+		SetWorking(true);
+		mTaskId = MainWindow::Instance()->TaskPanelPtr()->Submit(mFiles, std::make_shared<DuplicateFinderHandler>());
+	}
+
+	DuplicateFileDialog::~DuplicateFileDialog()
+	{}
+
+	void DuplicateFileDialog::SetupUi() {
+		setWindowTitle(QObject::tr("Duplicate Files"));
+		resize(QSize(1024, 768));
+		setWindowFlags(Qt::WindowCloseButtonHint);
+
+		mInfoLabel = new QLabel(QObject::tr("Searching..."));
+		mGroupTree = new QTreeWidget;
+		mGroupTree->setColumnCount(2);
+		mGroupTree->setHeaderLabels(QStringList() << QObject::tr("File") << QObject::tr("Size"));
+		mGroupTree->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+		mGroupTree->header()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
+		mGroupTree->header()->setStretchLastSection(false);
+
+		mTrashButton = new QToolButton;
+		mTrashButton->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
+		mTrashButton->setText(QObject::tr("Move to Trash"));
+		mTrashButton->setIcon(QIcon(":/ffx/res/image/delete.svg"));
+		mHardlinkButton = new QToolButton;
+		mHardlinkButton->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
+		mHardlinkButton->setText(QObject::tr("Replace with Hard Links"));
+		mHardlinkButton->setIcon(QIcon(":/ffx/res/image/file-duplicate.svg"));
+		mReflinkButton = new QToolButton;
+		mReflinkButton->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
+		mReflinkButton->setText(QObject::tr("Replace with Reflinks"));
+		mReflinkButton->setIcon(QIcon(":/ffx/res/image/file-duplicate.svg"));
+		mCloseButton = new QToolButton;
+		mCloseButton->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
+		mCloseButton->setText(QObject::tr("Close"));
+		mCloseButton->setIcon(QIcon(":/ffx/res/image/cancel.svg"));
+
+		mMainLayout = new QGridLayout;
+		mMainLayout->addWidget(mInfoLabel, 0, 0, 1, 5);
+		mMainLayout->addWidget(mGroupTree, 1, 0, 1, 5);
+		mMainLayout->addItem(new QSpacerItem(20, 20, QSizePolicy::Expanding, QSizePolicy::Minimum), 2, 0, 1, 1);
+		mMainLayout->addWidget(mTrashButton, 2, 1, 1, 1);
+		mMainLayout->addWidget(mHardlinkButton, 2, 2, 1, 1);
+		mMainLayout->addWidget(mReflinkButton, 2, 3, 1, 1);
+		mMainLayout->addWidget(mCloseButton, 2, 4, 1, 1);
+		mMainLayout->setRowStretch(1, 1);
+		setLayout(mMainLayout);
+
+		connect(MainWindow::Instance()->TaskPanelPtr(), &TaskPanel::TaskFileHandled, this, &DuplicateFileDialog::OnFileHandled);
+		connect(MainWindow::Instance()->TaskPanelPtr(), &TaskPanel::TaskComplete, this, &DuplicateFileDialog::OnTaskComplete);
+		connect(mTrashButton, &QToolButton::clicked, this, [this]() { Resolve("Trash"); });
+		connect(mHardlinkButton, &QToolButton::clicked, this, [this]() { Resolve("Hardlink"); });
+		connect(mReflinkButton, &QToolButton::clicked, this, [this]() { Resolve("Reflink"); });
+		connect(mCloseButton, &QToolButton::clicked, this, &DuplicateFileDialog::reject);
+	}
+
+	void DuplicateFileDialog::SetWorking(bool work) {
+		mTrashButton->setEnabled(!work);
+		mHardlinkButton->setEnabled(!work);
+		mReflinkButton->setEnabled(!work);
+	}
+
+	void DuplicateFileDialog::UpdateInfo() {
+		mInfoLabel->setText(QObject::tr("%1 groups, %2 duplicate files, %3 can be freed.").arg(mGroups.size()).arg(mDuplicateCount).arg(String::BytesHint(mDuplicateSize)));
+	}
+
+	void DuplicateFileDialog::OnFileHandled(int taskId, const QFileInfo& fileInput, const QFileInfo& fileOutput, bool success, const QString& message) {
+		if (taskId != mTaskId || !success)
+			return;
+
+		QString original = fileOutput.absoluteFilePath();
+		QTreeWidgetItem* group = mGroups.value(original);
+		if (group == nullptr) {
+			group = new QTreeWidgetItem(mGroupTree, QStringList() << original << String::BytesHint(fileOutput.size()));
+			QFont font = group->font(0);
+			font.setBold(true);
+			group->setFont(0, font);
+			group->setExpanded(true);
+			mGroups[original] = group;
+		}
+		//! The duplicates are checked, the file kept is not.
+		QTreeWidgetItem* item = new QTreeWidgetItem(group, QStringList() << fileInput.absoluteFilePath() << String::BytesHint(fileInput.size()));
+		item->setCheckState(0, Qt::Checked);
+		mDuplicateCount++;
+		mDuplicateSize += fileInput.size();
+		UpdateInfo();
+	}
+
+	void DuplicateFileDialog::OnTaskComplete(int taskId, bool success) {
+		if (taskId != mTaskId)
+			return;
+		mTaskId = -1;
+		SetWorking(false);
+		UpdateInfo();
+	}
+
+	void DuplicateFileDialog::Resolve(const QString& action) {
+		QHash<QString, QString> originals;
+		QFileInfoList duplicates;
+		for (auto it = mGroups.begin(); it != mGroups.end();) {
+			QTreeWidgetItem* group = it.value();
+			for (int i = group->childCount() - 1; i >= 0; i--) {
+				QTreeWidgetItem* item = group->child(i);
+				if (item->checkState(0) != Qt::Checked)
+					continue;
+				QFileInfo duplicate(item->text(0));
+				originals[duplicate.absoluteFilePath()] = it.key();
+				duplicates << duplicate;
+				mDuplicateCount--;
+				mDuplicateSize -= duplicate.size();
+				delete item;
+			}
+			if (group->childCount() == 0) {
+				delete group;
+				it = mGroups.erase(it);
+			} else {
+				it++;
+			}
+		}
+		if (duplicates.isEmpty())
+			return;
+
+		std::shared_ptr<DuplicateResolveHandler> handler = std::make_shared<DuplicateResolveHandler>(action);
+		handler->SetOriginals(originals);
+		MainWindow::Instance()->TaskPanelPtr()->Submit(duplicates, handler);
+		UpdateInfo();
+	}
+
+	void DuplicateFileDialog::reject() {
+		if (mTaskId > 0) {
+			MainWindow::Instance()->TaskPanelPtr()->Cancel(mTaskId);
+		}
+		QDialog::reject();
+	}
+}
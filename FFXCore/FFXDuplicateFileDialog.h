@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QDialog>
+#include <QFileInfo>
+#include <QHash>
+
+class QLabel;
+class QGridLayout;
+class QToolButton;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+namespace FFX {
+	/// <summary>
+	/// Runs a DuplicateFinderHandler task on the files and lists the groups of duplicates as they are found,
+	/// the checked duplicates can be moved to the trash or replaced by links to the file kept in their group.
+	/// </summary>
+	class DuplicateFileDialog : public QDialog {
+		Q_OBJECT
+
+	public:
+		DuplicateFileDialog(QFileInfoList files, QWidget* parent = nullptr);
+		~DuplicateFileDialog();
+
+	private:
+		void SetupUi();
+		void SetWorking(bool work);
+		void Resolve(const QString& action);
+		void UpdateInfo();
+
+	private slots:
+		void OnFileHandled(int taskId, const QFileInfo& fileInput, const QFileInfo& fileOutput, bool success, const QString& message);
+		void OnTaskComplete(int taskId, bool success);
+		virtual void reject();
+
+	private:
+		QFileInfoList mFiles;
+		int mTaskId = -1;
+		int mDuplicateCount = 0;
+		qint64 mDuplicateSize = 0;
+		//! Group items by the path of the file kept.
+		QHash<QString, QTreeWidgetItem*> mGroups;
+		QLabel* mInfoLabel;
+		QTreeWidget* mGroupTree;
+		QToolButton* mTrashButton;
+		QToolButton* mHardlinkButton;
+		QToolButton* mReflinkButton;
+		QToolButton* mCloseButton;
+		QGridLayout* mMainLayout;
+	};
+}
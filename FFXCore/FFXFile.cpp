@@ -1,9 +1,10 @@
 #include "FFXFile.h"
+#include "FFXFileSystem.h"
 
 namespace FFX {
 	QString G_FILE_VALIDATOR = "^[^/\\\\:*?\"<>|]+$";
 	QSet<QString> File::CustomSuffix = { "shp.xml", "sbnand.sbx", "fbnand.fbx", "ainand.aih",
-										 "tar.gz", "tar.bz2"
+										 "tar.gz", "tar.bz2", "tar.xz", "tar.zst"
 									   };
 
 	QFileInfoList FileInfoList(const QStringList& files) {
@@ -41,11 +42,9 @@ namespace FFX {
 	}
 
 	qint64 SymbolLinkSize(const QFileInfo& file) {
-		QFile link(file.absoluteFilePath());
-		link.open(QIODevice::ReadOnly);
-		qint64 size = link.size();
-		link.close();
-		return size;
+		//! The size of the link itself, opening it would read the size of the target or hang on a dead network share.
+		FileSystem::FileStat stat;
+		return FileSystem::Stat(file.absoluteFilePath(), stat) ? stat.size : 0;
 	}
 
 	qint64 FileSize(const QFileInfo& file) {
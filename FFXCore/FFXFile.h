@@ -99,6 +99,7 @@ namespace FFX {
 	FFXCORE_EXPORT QFileInfoList FileInfoList(const QFileInfo& file);
 	FFXCORE_EXPORT QFileInfoList FileInfoList(const QList<QUrl> urls);
 	FFXCORE_EXPORT QStringList StringList(const QFileInfoList& files);
+	//! Size of the link itself, the target is not followed.
 	FFXCORE_EXPORT qint64 SymbolLinkSize(const QFileInfo& file);
 	FFXCORE_EXPORT qint64 FileSize(const QFileInfo& file);
 
@@ -1,5 +1,6 @@
 #include "FFXFileFilterExpr.h"
 #include "FFXString.h"
+#include "FFXContentIndex.h"
 
 namespace FFX {
 	LogicalOperator::LogicalOperator(const std::string& name, int priorIn, int priorOut)
@@ -60,6 +61,9 @@ namespace FFX {
 		return std::make_shared<NotFileFilter>(f1);
 	}
 
+	//! Terms like "content:keyword" are matched against the content index instead of the file name.
+	static const std::string ContentPrefix = "content:";
+
 	std::map<std::string, LogicalOperatorPtr> FileFilterExpr::sAllLogicalOperator = {
 		{"&", std::make_shared<LogicalAnd>()},
 		{"|", std::make_shared<LogicalOr>()},
@@ -98,6 +102,8 @@ namespace FFX {
 			if (op != nullptr) {
 				FileFilterPtr f = op->Apply(result);
 				result.push(f);
+			} else if (token.compare(0, ContentPrefix.size(), ContentPrefix) == 0) {
+				result.push(std::make_shared<ContentFileFilter>(QString::fromStdString(token.substr(ContentPrefix.size()))));
 			} else {
 				result.push(std::make_shared<RegExpFileFilter>(QString::fromStdString(token), QRegExp::Wildcard, mCaseSensitive));
 			}
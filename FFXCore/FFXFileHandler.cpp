@@ -1,7 +1,25 @@
 #include "FFXFileHandler.h"
+#include "FFXArchive.h"
+#include "FFXFileSystem.h"
+#include "FFXTaskJournal.h"
+#include "FFXTrash.h"
+#include "FFXDiskUsage.h"
+#include "FFXString.h"
 #include <QDebug>
 #include <QDirIterator>
 #include <QThread>
+#include <QThreadPool>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
 
 namespace FFX {
 	static DebugProgress dp;
@@ -264,27 +282,11 @@ namespace FFX {
 		bool r = mArgMap["Recursion"].Value().toBool();
 		progress->OnProgress(-1, QObject::tr("Scanning..."));
 		for (const QFileInfo& file : files) {
-			if(file.isFile()) {
-				AppendFile(file);
-			} else if (file.isSymLink()) {
-				AppendLink(file);
-			} else if(file.isDir()) {
-				AppendDir(file);
-				QDirIterator fit(file.absoluteFilePath(), QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
-				while (fit.hasNext() && r)
-				{
-					fit.next();
-					QFileInfo fi = fit.fileInfo();
-					if (fi.isSymLink()) {
-						AppendLink(fi);
-					} else if (fi.isFile()) {
-						AppendFile(fi);
-						continue;
-					} else if (fi.isDir()) {
-						AppendDir(fi);
-					}
-				}
-			}
+			Append(file);
+			//! Links to directories are counted as links, the tree they point to is counted where it is.
+			if (!r || file.isSymLink() || !file.isDir())
+				continue;
+			Walk(file.absoluteFilePath());
 		}
 		progress->OnComplete();
 		return QFileInfoList();
@@ -294,41 +296,84 @@ namespace FFX {
 		return FileHandlerPtr(new FileStatHandler(*this));
 	}
 
-	void FileStatHandler::AppendFile(const QFileInfo& file) {
-		mTotalSize += file.size();
-		mFileCount++;
-		if (file.isHidden())
-			mHiddenFileCount++;
-		QDateTime dt = file.lastModified();
+	void FileStatHandler::Append(const QFileInfo& file) {
+		//! Sizes come from the metadata, no file is opened and symbolic links are not followed.
+		FileSystem::FileStat stat;
+		if (!FileSystem::Stat(file.absoluteFilePath(), stat)) {
+			stat.size = file.isSymLink() ? 0 : file.size();
+			stat.allocated = stat.size;
+			stat.dir = file.isDir();
+			stat.symLink = file.isSymLink();
+			stat.hidden = file.isHidden();
+			stat.modified = file.lastModified().toMSecsSinceEpoch();
+		}
+		Append(stat);
+	}
+
+	void FileStatHandler::Append(const FileSystem::FileStat& stat) {
+		if (stat.symLink) {
+			AppendLink(stat);
+		} else if (stat.dir) {
+			AppendDir(stat);
+		} else {
+			AppendFile(stat);
+		}
+	}
+
+	void FileStatHandler::Walk(const QString& dir) {
+		//! The subdirectories are walked once the listing is closed, so only one directory is open at a time.
+		QStringList subDirs;
+		FileSystem::ListDir(dir, [&](const QString& name, const FileSystem::FileStat& stat) {
+			Append(stat);
+			if (stat.dir && !stat.symLink)
+				subDirs << dir + "/" + name;
+			});
+		for (const QString& subDir : subDirs) {
+			Walk(subDir);
+		}
+	}
+
+	void FileStatHandler::AppendTime(qint64 modified) {
+		QDateTime dt = QDateTime::fromMSecsSinceEpoch(modified);
 		if (dt < mOldestTime)
 			mOldestTime = dt;
 		if (dt > mNewestTime)
 			mNewestTime = dt;
 	}
 
-	void FileStatHandler::AppendLink(const QFileInfo& file) {
-		mTotalSize += SymbolLinkSize(file);
-		mLinkFileCount++;
-		if (file.isHidden())
+	void FileStatHandler::AppendFile(const FileSystem::FileStat& stat) {
+		mFileCount++;
+		if (stat.hidden)
 			mHiddenFileCount++;
+		AppendTime(stat.modified);
+
+		//! The data of a file with several names is counted once, only those files are remembered.
+		if (stat.links > 1) {
+			int count = mLinkedFiles.size();
+			mLinkedFiles.insert(qMakePair(stat.device, stat.inode));
+			if (mLinkedFiles.size() == count) {
+				mHardLinkCount++;
+				return;
+			}
+		}
+		mTotalSize += stat.size;
+		mAllocatedSize += stat.allocated;
+	}
 
-		QDateTime dt = file.lastModified();
-		if (dt < mOldestTime)
-			mOldestTime = dt;
-		if (dt > mNewestTime)
-			mNewestTime = dt;
+	void FileStatHandler::AppendLink(const FileSystem::FileStat& stat) {
+		mTotalSize += stat.size;
+		mAllocatedSize += stat.allocated;
+		mLinkFileCount++;
+		if (stat.hidden)
+			mHiddenFileCount++;
+		AppendTime(stat.modified);
 	}
 
-	void FileStatHandler::AppendDir(const QFileInfo& file) {
+	void FileStatHandler::AppendDir(const FileSystem::FileStat& stat) {
 		mDirCount++;
-		if (file.isHidden())
+		if (stat.hidden)
 			mHiddenDirCount++;
-
-		QDateTime dt = file.lastModified();
-		if (dt < mOldestTime)
-			mOldestTime = dt;
-		if (dt > mNewestTime)
-			mNewestTime = dt;
+		AppendTime(stat.modified);
 	}
 
 	/************************************************************************************************************************
@@ -378,10 +423,14 @@ namespace FFX {
 	 *
 	 *
 	/************************************************************************************************************************/
-	FileSearchHandler::FileSearchHandler(FileFilterPtr filter)
-		: mFileFilter(filter) {}
+	FileSearchHandler::FileSearchHandler(FileFilterPtr filter, bool searchArchives, FileFilterPtr entryFilter)
+		: mFileFilter(filter)
+		, mEntryFilter(entryFilter == nullptr ? filter : entryFilter) {
+		mArgMap["SearchArchives"] = Argument("SearchArchives", QObject::tr("Search Archives"), QObject::tr("Match the entries of archives by name without extracting them, default is false."), searchArchives, Argument::Bool);
+	}
 
 	QFileInfoList FileSearchHandler::Handle(const QFileInfoList& files, ProgressPtr progress) {
+		bool searchArchives = mArgMap["SearchArchives"].BoolValue();
 		QFileInfoList result;
 		for (QFileInfo file : files) {
 			progress->OnProgress(-1, QObject::tr("Matching: %1").arg(file.absoluteFilePath()));
@@ -389,6 +438,9 @@ namespace FFX {
 				result << file;
 				progress->OnFileComplete(file, file, true);
 			}
+			if (searchArchives && ArchiveIndex::IsArchive(file)) {
+				SearchArchive(file, file, result, progress);
+			}
 			if (file.isDir()) {
 				QDirIterator fit(file.absoluteFilePath(), QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
 				while (fit.hasNext() && !mCancelled) {
@@ -400,6 +452,9 @@ namespace FFX {
 						progress->OnFileComplete(file, fi, true);
 						QThread::usleep(1);
 					}
+					if (searchArchives && ArchiveIndex::IsArchive(fi)) {
+						SearchArchive(file, fi, result, progress);
+					}
 				}
 			}
 		}
@@ -407,6 +462,23 @@ namespace FFX {
 		return result;
 	}
 
+	void FileSearchHandler::SearchArchive(const QFileInfo& root, const QFileInfo& archive, QFileInfoList& result, ProgressPtr progress) {
+		progress->OnProgress(-1, QObject::tr("Matching: %1").arg(archive.absoluteFilePath()));
+		//! Listings are cached by path and mtime, searching again only reads the headers of changed archives.
+		ArchiveIndexPtr index = ArchiveIndex::Open(archive.absoluteFilePath());
+		if (index == nullptr)
+			return;
+		for (const ArchiveEntry& entry : index->Entries()) {
+			if (mCancelled)
+				return;
+			if (entry.dir || !mEntryFilter->Accept(QFileInfo(entry.path)))
+				continue;
+			QFileInfo hit(ArchiveIndex::JoinPath(archive.absoluteFilePath(), entry.path));
+			result << hit;
+			progress->OnFileComplete(root, hit, true);
+		}
+	}
+
 	std::shared_ptr<FileHandler> FileSearchHandler::Clone() {
 		return FileHandlerPtr(new FileSearchHandler(*this));
 	}
@@ -475,9 +547,14 @@ namespace FFX {
 	 *
 	 *
 	/************************************************************************************************************************/
-	FileCopyHandler::FileCopyHandler(const QString& destPath, int dupMode) {
+	static const qint64 CopyBlockSize = 1 << 20;
+	//! Files at least this large are copied with checkpoints in the task journal, smaller ones are copied again if interrupted.
+	static const qint64 CheckpointInterval = 64 << 20;
+
+	FileCopyHandler::FileCopyHandler(const QString& destPath, int dupMode, bool verify) {
 		mArgMap["DestPath"] = Argument("DestPath", QObject::tr("DestPath"), QObject::tr("Target directory for files copying."), destPath);
 		mArgMap["DupMode"] = Argument("DupMode", QObject::tr("DupMode"), QObject::tr("How to handle duplicate files, 0: rename, 1: overwrite, 2: ignored."), dupMode);
+		mArgMap["Verify"] = Argument("Verify", QObject::tr("Verify"), QObject::tr("Read every copy back and compare it with the data read from the source, a copy that differs is reported as failed and left in place, default is false."), verify, Argument::Bool);
 	}
 
 	QFileInfoList FileCopyHandler::Handle(const QFileInfoList& files, ProgressPtr progress) {
@@ -486,6 +563,15 @@ namespace FFX {
 		scaner.Handle(files);
 		mTotalFile = scaner.FileCount();
 
+		//! One reader is enough to keep up with the copy, the copies are read back in the order they were written.
+		QThreadPool verifyPool;
+		verifyPool.setMaxThreadCount(1);
+		QMutex verifiedMutex;
+		mVerifyPool = mArgMap["Verify"].BoolValue() ? &verifyPool : nullptr;
+		mVerifiedMutex = &verifiedMutex;
+		mVerified.clear();
+		mVerifyFailed = 0;
+
 		QFileInfoList result;
 		QString targetPath = mArgMap["DestPath"].Value().toString();
 		QDir targetDir(targetPath);
@@ -499,6 +585,14 @@ namespace FFX {
 			}
 			result << targetFile;
 		}
+		verifyPool.waitForDone();
+		ReportVerified(progress);
+		mVerifyPool = nullptr;
+		mVerifiedMutex = nullptr;
+		if (mVerifyFailed > 0) {
+			progress->OnComplete(false, QObject::tr("Finish, Total %1 files copied, %2 failed verification.").arg(mTotalFile).arg(mVerifyFailed));
+			return result;
+		}
 		progress->OnComplete(true, QObject::tr("Finish, Total %1 files copied.").arg(mTotalFile));
 		return result;
 	}
@@ -508,26 +602,173 @@ namespace FFX {
 	}
 
 	void FileCopyHandler::CopyFile(const QFileInfo& file, const QString& dest, ProgressPtr progress) {
+		ReportVerified(progress);
 		int dupMode = mArgMap["DupMode"].IntValue();
+		QString source = file.absoluteFilePath();
 
 		QString theTargetFile(dest);
-		if (QFile::exists(dest) && dupMode == 2)
+		qint64 offset = 0;
+		if (mJournal != nullptr && mJournal->IsDone(source, &theTargetFile)) {
+			mCopiedFile++;
+			progress->OnFileComplete(file, theTargetFile, true, QObject::tr("Copied before resuming."));
 			return;
-
-		if(QFile::exists(dest) && dupMode == 1) {
-			QFile::setPermissions(dest, QFileDevice::ReadOther | QFileDevice::WriteOther);
-			QFile::remove(dest);
 		}
+		//! The file in progress when the task stopped goes on into the same target.
+		bool resumed = mJournal != nullptr && mJournal->Partial(source, theTargetFile, offset);
+		//! The journal is synced once a second, a file copied after the last sync is already at dest with the time of the source.
+		if (!resumed && mJournal != nullptr && mJournal->Resumed() && QFile::exists(dest)) {
+			QFileInfo target(dest);
+			if (target.isFile() && target.size() == file.size()
+				&& target.lastModified().toSecsSinceEpoch() == file.lastModified().toSecsSinceEpoch()) {
+				mCopiedFile++;
+				mJournal->Done(source, dest);
+				progress->OnFileComplete(file, dest, true, QObject::tr("Copied before resuming."));
+				return;
+			}
+		}
+		if (!resumed) {
+			if (QFile::exists(dest) && dupMode == 2)
+				return;
 
-		if (QFile::exists(dest) && dupMode == 0) {
-			FileDuplicateHandler duph("_N", false);
-			QFileInfoList r = duph.Handle(FileInfoList(dest));
-			theTargetFile = r[0].absoluteFilePath();
+			if(QFile::exists(dest) && dupMode == 1) {
+				QFile::setPermissions(dest, QFileDevice::ReadOther | QFileDevice::WriteOther);
+				QFile::remove(dest);
+			}
+
+			if (QFile::exists(dest) && dupMode == 0) {
+				FileDuplicateHandler duph("_N", false);
+				QFileInfoList r = duph.Handle(FileInfoList(dest));
+				theTargetFile = r[0].absoluteFilePath();
+			}
 		}
 		double p = (mCopiedFile++ / (double)mTotalFile) * 100;
-		progress->OnProgress(p, QObject::tr("Copying: %1").arg(file.absoluteFilePath()));
-		bool flag = QFile::copy(file.absoluteFilePath(), theTargetFile);
-		progress->OnFileComplete(file, theTargetFile, flag);
+		progress->OnProgress(p, QObject::tr("Copying: %1").arg(source));
+		if (mVerifyPool == nullptr && (mJournal == nullptr || file.size() < CheckpointInterval)) {
+			bool flag = QFile::copy(source, theTargetFile);
+			if (flag && mJournal != nullptr) {
+				//! The copy takes the time of the source, so that a resumed task knows it is complete.
+				QFile copied(theTargetFile);
+				if (copied.open(QIODevice::Append)) {
+					copied.setFileTime(file.lastModified(), QFileDevice::FileModificationTime);
+					copied.close();
+				}
+				mJournal->Done(source, theTargetFile);
+			}
+			progress->OnFileComplete(file, theTargetFile, flag);
+			return;
+		}
+
+		QByteArray digest;
+		QString error;
+		if (!CopyAndHash(source, theTargetFile, offset, mVerifyPool != nullptr ? &digest : nullptr, error)) {
+			progress->OnFileComplete(file, theTargetFile, false, error);
+			return;
+		}
+		if (mVerifyPool == nullptr) {
+			mJournal->Done(source, theTargetFile);
+			progress->OnFileComplete(file, theTargetFile, true);
+			return;
+		}
+		//! The copy is read back while the next file is copied, the file is completed once it has been checked.
+		//! The result is queued, the copying thread reports it and records it in the journal.
+		mVerifyPool->start([this, file, source, theTargetFile, digest]() {
+			//! The copy is read from the device, the system cache still holds the data just written.
+			Checksum checksum(Checksum::XXH3);
+			bool flag = FileSystem::ReadUncached(theTargetFile, [&](const char* data, qint64 size) {
+				checksum.AddData(data, size);
+				return true;
+				}) && checksum.Result() == digest;
+			QMutexLocker locker(mVerifiedMutex);
+			mVerified << Verified{ file, source, theTargetFile, flag };
+			});
+	}
+
+	void FileCopyHandler::ReportVerified(ProgressPtr progress) {
+		if (mVerifiedMutex == nullptr)
+			return;
+		QList<Verified> verified;
+		{
+			QMutexLocker locker(mVerifiedMutex);
+			verified.swap(mVerified);
+		}
+		for (const Verified& v : verified) {
+			if (!v.success) {
+				mVerifyFailed++;
+			} else if (mJournal != nullptr) {
+				mJournal->Done(v.source, v.target);
+			}
+			progress->OnFileComplete(v.file, v.target, v.success, v.success ? QString() : QObject::tr("Verification failed, the copy differs from the source."));
+		}
+	}
+
+	bool FileCopyHandler::CopyAndHash(const QString& source, const QString& dest, qint64 offset, QByteArray* digest, QString& error) {
+		QFile in(source);
+		if (!in.open(QIODevice::ReadOnly)) {
+			error = in.errorString();
+			return false;
+		}
+		QFile out(dest);
+		//! A resumed copy keeps the data up to the checkpoint and writes the rest again.
+		if (!out.open(offset > 0 ? QIODevice::ReadWrite : QIODevice::WriteOnly | QIODevice::Truncate)) {
+			error = out.errorString();
+			return false;
+		}
+
+		Checksum checksum(Checksum::XXH3);
+		QByteArray buffer(CopyBlockSize, 0);
+		//! The digest covers the whole file, the part copied before resuming is hashed from the source.
+		while (digest != nullptr && in.pos() < offset) {
+			qint64 n = in.read(buffer.data(), qMin<qint64>(buffer.size(), offset - in.pos()));
+			if (n <= 0) {
+				error = in.errorString();
+				return false;
+			}
+			checksum.AddData(buffer.constData(), n);
+		}
+		if (offset > 0 && (!in.seek(offset) || !out.resize(offset) || !out.seek(offset))) {
+			error = out.errorString();
+			return false;
+		}
+
+		qint64 copied = offset;
+		qint64 checkpoint = offset;
+		while (!mCancelled) {
+			qint64 n = in.read(buffer.data(), buffer.size());
+			if (n == 0)
+				break;
+			if (n < 0 || out.write(buffer.constData(), n) != n) {
+				error = n < 0 ? in.errorString() : out.errorString();
+				out.remove();
+				return false;
+			}
+			if (digest != nullptr) {
+				checksum.AddData(buffer.constData(), n);
+			}
+			copied += n;
+			//! The checkpoint is recorded once the data before it is on the device.
+			if (mJournal != nullptr && copied - checkpoint >= CheckpointInterval) {
+				FileSystem::Sync(out);
+				mJournal->Checkpoint(source, dest, copied);
+				checkpoint = copied;
+			}
+		}
+		if (mCancelled) {
+			out.remove();
+			error = QObject::tr("Cancelled.");
+			return false;
+		}
+
+		if (digest != nullptr) {
+			//! The copy is read back from the device, the data must be there first.
+			FileSystem::Sync(out);
+		}
+		out.setFileTime(in.fileTime(QFileDevice::FileModificationTime), QFileDevice::FileModificationTime);
+		out.close();
+		out.setPermissions(in.permissions());
+		if (digest != nullptr) {
+			*digest = checksum.Result();
+		}
+		return true;
 	}
 
 	void FileCopyHandler::CopyDir(const QFileInfo& dir, const QString& dest, ProgressPtr progress) {
@@ -558,26 +799,43 @@ namespace FFX {
 	}
 
 	QFileInfoList FileMoveHandler::Handle(const QFileInfoList& files, ProgressPtr progress) {
-		FileStatHandler scaner;
-		progress->OnProgress(-1, QObject::tr("Scanning..."));
-		scaner.Handle(files);
-		mTotalFile = scaner.FileCount();
+		mCancelled = false;
+		mMovedOkCount = 0;
+		mFailedCount = 0;
+		mInputIndex = 0;
+		mInputCount = files.size();
+
 		QFileInfoList result;
 		QString targetPath = mArgMap["DestPath"].Value().toString();
 		QDir targetDir(targetPath);
+		targetDir.mkpath(".");
+		quint64 targetDevice = 0, targetInode = 0;
+		bool targetKnown = FileSystem::FileId(targetDir.absolutePath(), targetDevice, targetInode);
 		for (const QFileInfo& file : files) {
+			if (mCancelled)
+				break;
 			QString targetFile = targetDir.absoluteFilePath(file.fileName());
-			if (file.isDir()) {
-				targetDir.mkdir(file.fileName());
+			result << targetFile;
+			mInputBytes = 0;
+			mCopiedBytes = 0;
+			//! Resuming, the inputs moved before are gone from the source.
+			if (mJournal != nullptr && !file.exists() && !file.isSymLink()) {
+				mInputIndex++;
+				continue;
+			}
+
+			quint64 device = 0, inode = 0;
+			bool sameDevice = targetKnown && FileSystem::FileId(file.absoluteFilePath(), device, inode) && device == targetDevice;
+			if (!sameDevice) {
+				MoveAcross(file, targetFile, progress);
+			} else if (file.isDir() && !file.isSymLink()) {
 				MoveDir(file, targetFile, progress);
-				// Remove the dir
-				//QDir(file.absoluteFilePath()).removeRecursively();
 			} else {
 				MoveFile(file, targetFile, progress);
 			}
-			result << targetFile;
+			mInputIndex++;
 		}
-		progress->OnComplete(true, QObject::tr("Finish, Total %1 files moved, %2 failed.").arg(mMovedOkCount).arg(mTotalFile - mMovedOkCount));
+		progress->OnComplete(mFailedCount == 0 && !mCancelled, QObject::tr("Finish, Total %1 moved, %2 failed.").arg(mMovedOkCount).arg(mFailedCount));
 		return result;
 	}
 
@@ -586,11 +844,11 @@ namespace FFX {
 	}
 
 	void FileMoveHandler::MoveFile(const QFileInfo& file, const QString& dest, ProgressPtr progress) {
-		double p = (mMovedFile++ / (double)mTotalFile) * 100;
-		progress->OnProgress(p, QObject::tr("Moving: %1").arg(file.absoluteFilePath()));
+		progress->OnProgress(Percent(), QObject::tr("Moving: %1").arg(file.absoluteFilePath()));
 
 		if (QFile::exists(dest) && !mArgMap["Overwrite"].Value().toBool()) {
-			progress->OnFileComplete(file, dest, false);
+			mFailedCount++;
+			progress->OnFileComplete(file, dest, false, QObject::tr("The target exists."));
 			return;
 		}
 
@@ -600,30 +858,178 @@ namespace FFX {
 		}
 		
 		bool flag = QFile::rename(file.absoluteFilePath(), dest);
+		if (flag && mJournal != nullptr) {
+			mJournal->Done(file.absoluteFilePath(), dest);
+		}
 		progress->OnFileComplete(file, dest, flag);
 		if (flag) mMovedOkCount++;
+		else mFailedCount++;
 	}
 
 	void FileMoveHandler::MoveDir(const QFileInfo& dir, const QString& dest, ProgressPtr progress) {
-		QDirIterator fit(dir.absoluteFilePath(), QDir::Files | QDir::Dirs | QDir::System | QDir::Hidden | QDir::NoDotAndDotDot);
+		QString source = dir.absoluteFilePath();
+		if (!QFileInfo::exists(dest)) {
+			progress->OnProgress(Percent(), QObject::tr("Moving: %1").arg(source));
+			if (QDir().rename(source, dest)) {
+				if (mJournal != nullptr) {
+					mJournal->Done(source, dest);
+				}
+				mMovedOkCount++;
+				progress->OnFileComplete(dir, dest, true);
+				return;
+			}
+			//! A mount point or a locked file inside, the entries are moved one by one.
+			QDir().mkpath(dest);
+		}
+
+		QDir targetDir(dest);
+		QDirIterator fit(source, QDir::Files | QDir::Dirs | QDir::System | QDir::Hidden | QDir::NoDotAndDotDot);
 		while (fit.hasNext() && !mCancelled) {
 			fit.next();
 			QFileInfo fi = fit.fileInfo();
-			QDir targetDir(dest);
-			if (fi.isDir()) {
-				// make dir first.
-				targetDir.mkdir(fi.fileName());
+			if (fi.isDir() && !fi.isSymLink()) {
 				MoveDir(fi, targetDir.absoluteFilePath(fi.fileName()), progress);
 				continue;
 			}
-			QString theFilePath = fi.absoluteFilePath();
-			MoveFile(theFilePath, targetDir.absoluteFilePath(fi.fileName()), progress);
+			MoveFile(fi, targetDir.absoluteFilePath(fi.fileName()), progress);
+		}
+		QDir().rmdir(source);
+	}
+
+	void FileMoveHandler::MoveAcross(const QFileInfo& file, const QString& dest, ProgressPtr progress) {
+		FileStatHandler scaner;
+		progress->OnProgress(-1, QObject::tr("Scanning..."));
+		scaner.Handle(QFileInfoList() << file);
+		mInputBytes = scaner.TotalSize();
+
+		//! The sources are only deleted once they are copied, a failed or cancelled copy never costs a source.
+		QFileInfoList copied;
+		QStringList dirs;
+		auto copy = [&](const QFileInfo& fi, const QString& target) {
+			QString error;
+			if (CopyAcross(fi, target, error, progress)) {
+				copied << fi;
+				progress->OnFileComplete(fi, target, true);
+			} else {
+				mFailedCount++;
+				progress->OnFileComplete(fi, target, false, error);
+			}
+		};
+		if (file.isDir() && !file.isSymLink()) {
+			QDir root(file.absoluteFilePath());
+			QDir().mkpath(dest);
+			dirs << root.absolutePath();
+			QDirIterator fit(root.absolutePath(), QDir::Files | QDir::Dirs | QDir::System | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+			while (fit.hasNext() && !mCancelled) {
+				fit.next();
+				QFileInfo fi = fit.fileInfo();
+				QString target = QDir(dest).absoluteFilePath(root.relativeFilePath(fi.absoluteFilePath()));
+				if (fi.isDir() && !fi.isSymLink()) {
+					QDir().mkpath(target);
+					dirs << fi.absoluteFilePath();
+					continue;
+				}
+				copy(fi, target);
+			}
+		} else {
+			copy(file, dest);
+		}
+
+		progress->OnProgress(Percent(), QObject::tr("Deleting the sources of %1").arg(file.absoluteFilePath()));
+		for (const QFileInfo& fi : copied) {
+			QString path = fi.absoluteFilePath();
+			if (!QFile::remove(path)) {
+				QFile::setPermissions(path, fi.permissions() | QFileDevice::WriteOwner);
+				if (!QFile::remove(path)) {
+					mFailedCount++;
+					progress->OnFileComplete(fi, fi, false, QObject::tr("Copied, but the source cannot be deleted."));
+					continue;
+				}
+			}
+			mMovedOkCount++;
+		}
+		//! Deepest first, the directories still holding a source that failed are kept.
+		for (int i = dirs.size() - 1; i >= 0; i--) {
+			QDir().rmdir(dirs[i]);
 		}
-		QString dstr = dir.absoluteFilePath();
-		QDir d(dstr);
-		int count = d.entryList(QDir::Files | QDir::Dirs | QDir::System | QDir::Hidden | QDir::NoDotAndDotDot).size();
-		if(count == 0)
-			d.removeRecursively();
+	}
+
+	bool FileMoveHandler::CopyAcross(const QFileInfo& file, const QString& dest, QString& error, ProgressPtr progress) {
+		QString source = file.absoluteFilePath();
+		progress->OnProgress(Percent(), QObject::tr("Moving: %1").arg(source));
+		if (mJournal != nullptr && mJournal->IsDone(source)) {
+			mCopiedBytes += file.size();
+			return true;
+		}
+
+		QString target(dest);
+		qint64 offset = 0;
+		bool resumed = mJournal != nullptr && mJournal->Partial(source, target, offset);
+		if (!resumed && (QFileInfo::exists(dest) || QFileInfo(dest).isSymLink())) {
+			if (!mArgMap["Overwrite"].Value().toBool()) {
+				error = QObject::tr("The target exists.");
+				return false;
+			}
+			QFile::setPermissions(dest, QFileDevice::ReadOther | QFileDevice::WriteOther);
+			QFile::remove(dest);
+		}
+		if (file.isSymLink()) {
+			if (!QFile::link(file.symLinkTarget(), target)) {
+				error = QObject::tr("Cannot create the link.");
+				return false;
+			}
+			return true;
+		}
+
+		QFile in(source);
+		if (!in.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+			error = in.errorString();
+			return false;
+		}
+		QFile out(target);
+		if (!out.open((offset > 0 ? QIODevice::ReadWrite : QIODevice::WriteOnly | QIODevice::Truncate) | QIODevice::Unbuffered)) {
+			error = out.errorString();
+			return false;
+		}
+		if (offset > 0 && (!in.seek(offset) || !out.resize(offset) || !out.seek(offset))) {
+			error = out.errorString();
+			return false;
+		}
+
+		QByteArray buffer;
+		qint64 copied = offset;
+		qint64 checkpoint = offset;
+		mCopiedBytes += offset;
+		while (!mCancelled) {
+			qint64 n = FileSystem::CopyChunk(in, out, CopyBlockSize, buffer, &error);
+			if (n == 0)
+				break;
+			if (n < 0) {
+				out.remove();
+				return false;
+			}
+			copied += n;
+			mCopiedBytes += n;
+			progress->OnProgress(Percent(), QObject::tr("Moving: %1").arg(source));
+			if (mJournal != nullptr && copied - checkpoint >= CheckpointInterval) {
+				FileSystem::Sync(out);
+				mJournal->Checkpoint(source, target, copied);
+				checkpoint = copied;
+			}
+		}
+		if (mCancelled) {
+			out.remove();
+			error = QObject::tr("Cancelled.");
+			return false;
+		}
+
+		out.setFileTime(in.fileTime(QFileDevice::FileModificationTime), QFileDevice::FileModificationTime);
+		out.close();
+		out.setPermissions(in.permissions());
+		if (mJournal != nullptr) {
+			mJournal->Done(source, target);
+		}
+		return true;
 	}
 
 	/************************************************************************************************************************
@@ -631,35 +1037,56 @@ namespace FFX {
 	 *
 	 *
 	/************************************************************************************************************************/
-	FileDeleteHandler::FileDeleteHandler(bool forced) {
+	FileDeleteHandler::FileDeleteHandler(bool forced, int maxParallel) {
 		mArgMap["Forced"] = Argument("Forced", QObject::tr("Forced"), QObject::tr("Delete file with forced."), forced);
+		mArgMap["MaxParallel"] = Argument("MaxParallel", QObject::tr("Max Parallel"), QObject::tr("Max number of threads deleting a directory tree with forced, 0 means the number of CPU cores, default is 0."), maxParallel);
+		mArgMap["MaxParallel"].AddLimit("^(0|[1-9]\\d{0,2})$");
 	}
 
 	QFileInfoList FileDeleteHandler::Handle(const QFileInfoList& files, ProgressPtr progress) {
+		mCancelled = false;
 		bool forced = mArgMap["Forced"].Value().toBool();
 		if (forced) {
-			FileStatHandler scaner;
-			scaner.Handle(files);
-			mTotalFile = scaner.FileCount();
-			for (const QFileInfo& file : files) {
-				if (file.isFile())
-					DeleteFile(file, progress);
-				if (file.isDir()) {
-					QDirIterator fit(file.absoluteFilePath(), QDir::Files | QDir::System | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
-					while (fit.hasNext()) {
-						fit.next();
-						DeleteFile(fit.fileInfo(), progress);
-					}
-					QDir(file.absoluteFilePath()).removeRecursively();
+			//! No scan first, the tree is walked once by the workers removing it.
+			int maxParallel = mArgMap["MaxParallel"].IntValue();
+			int failed = 0;
+			QMutex mutex;
+			for (int i = 0; i < files.size() && !mCancelled; i++) {
+				const QFileInfo& file = files[i];
+				double p = i * 100.0 / files.size();
+				progress->OnProgress(p, QObject::tr("Deleting: %1").arg(file.absoluteFilePath()));
+				bool flag = FileSystem::RemoveTree(file.absoluteFilePath(), maxParallel,
+					[&](const QString& path, const QString& error) {
+						QMutexLocker locker(&mutex);
+						QFileInfo entry(path);
+						if (entry != file) {
+							progress->OnFileComplete(entry, QFileInfo(), false, error);
+						}
+					},
+					[&](qint64 removed) {
+						QMutexLocker locker(&mutex);
+						progress->OnProgress(p, QObject::tr("Deleting: %1, %2 entries removed").arg(file.absoluteFilePath()).arg(removed));
+					},
+					[this]() { return mCancelled; });
+				if (!flag) {
+					failed++;
 				}
-			}
-		} else {
-			for (const QFileInfo& file : files) {
-				bool flag = QFile::moveToTrash(file.absoluteFilePath());
 				progress->OnFileComplete(file, QFileInfo(), flag);
 			}
+			progress->OnComplete(failed == 0 && !mCancelled, QObject::tr("Finish."));
+			return QFileInfoList();
 		}
-		progress->OnComplete(true, QObject::tr("Finish."));
+
+		//! The output of each file is its path in the trash, TrashRestoreHandler takes them to undo the operation.
+		int trashed = 0;
+		int failed = 0;
+		Trash::MoveToTrash(files, [&](const QFileInfo& file, const QString& pathInTrash, const QString& error) {
+			bool flag = !pathInTrash.isEmpty();
+			flag ? trashed++ : failed++;
+			progress->OnProgress((trashed + failed) * 100.0 / files.size(), QObject::tr("Moving to trash: %1").arg(file.absoluteFilePath()));
+			progress->OnFileComplete(file, flag ? QFileInfo(pathInTrash) : QFileInfo(), flag, error);
+		}, [this]() { return mCancelled; });
+		progress->OnComplete(failed == 0 && !mCancelled, QObject::tr("Finish, Total %1 trashed, %2 failed.").arg(trashed).arg(failed));
 		return QFileInfoList();
 	}
 
@@ -668,16 +1095,50 @@ namespace FFX {
 	}
 
 	void FileDeleteHandler::DeleteFile(const QFileInfo& file, ProgressPtr progress) {
-		// Modify the file attributes to delete.
-		QFile::setPermissions(file.absoluteFilePath(), QFileDevice::ReadOther | QFileDevice::WriteOther);
 		double p = (mDeletedFile++ / (double)mTotalFile) * 100;
 		progress->OnProgress(p, QObject::tr("Deleting: %1").arg(file.absoluteFilePath()));
 		QFile f(file.absoluteFilePath());
 		bool flag = f.remove();
-		QString fs = file.absoluteFilePath();
+		if (!flag) {
+			//! Modify the file attributes only when they are in the way.
+			QFile::setPermissions(file.absoluteFilePath(), QFileDevice::ReadOther | QFileDevice::WriteOther);
+			flag = f.remove();
+		}
 		progress->OnFileComplete(file, QFileInfo(), flag, flag ? "" : f.errorString());
 	}
 
+	/************************************************************************************************************************
+	 * Class： TrashRestoreHandler
+	 *
+	 *
+	/************************************************************************************************************************/
+	TrashRestoreHandler::TrashRestoreHandler() {
+	}
+
+	QFileInfoList TrashRestoreHandler::Handle(const QFileInfoList& files, ProgressPtr progress) {
+		mCancelled = false;
+		QFileInfoList result;
+		int failed = 0;
+		for (int i = 0; i < files.size() && !mCancelled; i++) {
+			const QFileInfo& file = files[i];
+			progress->OnProgress(i * 100.0 / files.size(), QObject::tr("Restoring: %1").arg(file.absoluteFilePath()));
+			QString original, error;
+			bool flag = Trash::Restore(file.absoluteFilePath(), original, error);
+			progress->OnFileComplete(file, flag ? QFileInfo(original) : QFileInfo(), flag, error);
+			if (flag) {
+				result << QFileInfo(original);
+			} else {
+				failed++;
+			}
+		}
+		progress->OnComplete(failed == 0 && !mCancelled, QObject::tr("Finish, Total %1 restored, %2 failed.").arg(result.size()).arg(failed));
+		return result;
+	}
+
+	std::shared_ptr<FileHandler> TrashRestoreHandler::Clone() {
+		return FileHandlerPtr(new TrashRestoreHandler(*this));
+	}
+
 	FileEnvelopeByDirHandler::FileEnvelopeByDirHandler() {
 
 	}
@@ -761,13 +1222,1038 @@ namespace FFX {
 		}
 	}
 
+	/************************************************************************************************************************
+	 * Class： ChecksumHandler
+	 *
+	 *
+	/************************************************************************************************************************/
+	//! GNU coreutils format, "<hex digest>  <path>" with paths relative to the manifest and '/' separated.
+	static bool WriteManifest(const QString& manifest, const QFileInfoList& files, const QVector<QByteArray>& digests) {
+		QDir root = QFileInfo(manifest).absoluteDir();
+		QStringList lines;
+		for (int i = 0; i < files.size(); i++) {
+			if (!digests[i].isEmpty())
+				lines << QString("%1  %2").arg(QString(digests[i].toHex())).arg(root.relativeFilePath(files[i].absoluteFilePath()));
+		}
+		std::sort(lines.begin(), lines.end(), [](const QString& l1, const QString& l2) { return l1.mid(l1.indexOf(' ') + 2) < l2.mid(l2.indexOf(' ') + 2); });
+
+		QSaveFile file(manifest);
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+			return false;
+		QTextStream out(&file);
+		out.setCodec("UTF-8");
+		for (const QString& line : lines)
+			out << line << "\n";
+		out.flush();
+		return file.commit();
+	}
+
+	ChecksumHandler::ChecksumHandler(const QString& algorithm, int maxParallel, const QString& manifest, bool verify) {
+		mArgMap["Algorithm"] = Argument("Algorithm", QObject::tr("Algorithm"), QObject::tr("Hash algorithm, XXH3 is the fastest, BLAKE3 is a fast cryptographic hash, SHA256 is the most common in manifests, default is SHA256."), algorithm, Argument::Option);
+		for (const QString& name : Checksum::AlgorithmNames()) {
+			mArgMap["Algorithm"].AddLimit(name);
+		}
+		mArgMap["MaxParallel"] = Argument("MaxParallel", QObject::tr("Max Parallel"), QObject::tr("Max number of files hashed at the same time, 0 means the number of CPU cores, use 1 for spinning disks, default is 0."), maxParallel);
+		mArgMap["MaxParallel"].AddLimit("^(0|[1-9]\\d{0,2})$");
+		mArgMap["Manifest"] = Argument("Manifest", QObject::tr("Manifest"), QObject::tr("Write the checksums to this manifest file, the paths are relative to its directory, a suffix naming an algorithm such as .sha256 or .b3 overrides Algorithm, empty means no manifest."), manifest, Argument::SaveFile);
+		mArgMap["Manifest"].AddLimit("Manifest(*.sha256 *.sha512 *.sha1 *.md5 *.xxh64 *.xxh3 *.b3)");
+		mArgMap["Verify"] = Argument("Verify", QObject::tr("Verify"), QObject::tr("The input files are manifests, check the files listed in them against their checksums, the algorithm is taken from the suffix of the manifest, default is false."), verify, Argument::Bool);
+	}
+
+	QFileInfoList ChecksumHandler::Handle(const QFileInfoList& files, ProgressPtr progress) {
+		mCancelled = false;
+		if (mArgMap["Verify"].BoolValue())
+			return VerifyManifests(files, progress);
+		return HashTree(files, progress);
+	}
+
+	std::shared_ptr<FileHandler> ChecksumHandler::Clone() {
+		return FileHandlerPtr(new ChecksumHandler(*this));
+	}
+
+	QFileInfoList ChecksumHandler::HashTree(const QFileInfoList& files, ProgressPtr progress) {
+		Checksum::Algorithm algorithm = Checksum::AlgorithmByName(mArgMap["Algorithm"].StringValue());
+		QString manifest = mArgMap["Manifest"].StringValue();
+		QString manifestPath = manifest.isEmpty() ? QString() : QFileInfo(manifest).absoluteFilePath();
+		//! The manifest is verified with the algorithm its suffix names, it is written with the same one.
+		if (!manifest.isEmpty()) {
+			algorithm = Checksum::AlgorithmByName(QFileInfo(manifest).suffix(), algorithm);
+		}
+
+		progress->OnProgress(-1, QObject::tr("Scanning..."));
+		QFileInfoList filesTodo;
+		for (const QFileInfo& file : files) {
+			if (file.isDir()) {
+				QDirIterator fit(file.absoluteFilePath(), QDir::Files | QDir::System | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+				while (fit.hasNext() && !mCancelled) {
+					fit.next();
+					if (fit.fileInfo().absoluteFilePath() != manifestPath)
+						filesTodo << fit.fileInfo();
+				}
+			} else if (file.isFile() && file.absoluteFilePath() != manifestPath) {
+				filesTodo << file;
+			}
+		}
+
+		QVector<QByteArray> digests(filesTodo.size());
+		HashFiles(filesTodo, algorithm, progress, [&](int i, const QByteArray& digest) {
+			digests[i] = digest;
+			progress->OnFileComplete(filesTodo[i], filesTodo[i], !digest.isEmpty(), digest.isEmpty() ? QObject::tr("Cannot read the file.") : QString(digest.toHex()));
+			});
+
+		QFileInfoList result;
+		for (int i = 0; i < filesTodo.size(); i++) {
+			if (!digests[i].isEmpty())
+				result << filesTodo[i];
+		}
+		if (mCancelled) {
+			progress->OnComplete(false, QObject::tr("Cancelled."));
+			return result;
+		}
+		if (!manifest.isEmpty() && !WriteManifest(manifestPath, filesTodo, digests)) {
+			progress->OnComplete(false, QObject::tr("Cannot write manifest %1.").arg(manifest));
+			return result;
+		}
+		progress->OnComplete(result.size() == filesTodo.size(), QObject::tr("Finish, %1 files hashed, %2 failed.").arg(result.size()).arg(filesTodo.size() - result.size()));
+		return result;
+	}
+
+	QFileInfoList ChecksumHandler::VerifyManifests(const QFileInfoList& files, ProgressPtr progress) {
+		Checksum::Algorithm defaultAlgorithm = Checksum::AlgorithmByName(mArgMap["Algorithm"].StringValue());
+		QFileInfoList result;
+		int failed = 0;
+		for (const QFileInfo& manifest : files) {
+			if (!manifest.isFile() || mCancelled)
+				continue;
+			QFile file(manifest.absoluteFilePath());
+			if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+				progress->OnFileComplete(manifest, QFileInfo(), false, file.errorString());
+				failed++;
+				continue;
+			}
+
+			//! Lines are "<hex digest>  <path>", a '*' before the path marks binary mode in the GNU format and is ignored.
+			QDir root = manifest.absoluteDir();
+			QFileInfoList listed;
+			QVector<QByteArray> expected;
+			QTextStream in(&file);
+			in.setCodec("UTF-8");
+			while (!in.atEnd()) {
+				QString line = in.readLine();
+				int space = line.indexOf(' ');
+				if (line.trimmed().isEmpty() || line.startsWith('#') || space <= 0)
+					continue;
+				QString path = line.mid(space + 1);
+				if (path.startsWith(' ') || path.startsWith('*'))
+					path.remove(0, 1);
+				listed << QFileInfo(root.absoluteFilePath(path));
+				expected << QByteArray::fromHex(line.left(space).toLatin1());
+			}
+
+			Checksum::Algorithm algorithm = Checksum::AlgorithmByName(manifest.suffix(), defaultAlgorithm);
+			QVector<bool> matched(listed.size(), false);
+			HashFiles(listed, algorithm, progress, [&](int i, const QByteArray& digest) {
+				matched[i] = !digest.isEmpty() && digest == expected[i];
+				QString msg;
+				if (!listed[i].exists())
+					msg = QObject::tr("Missing.");
+				else if (digest.isEmpty())
+					msg = QObject::tr("Cannot read the file.");
+				else if (!matched[i])
+					msg = QObject::tr("Checksum mismatch, expected %1, got %2.").arg(QString(expected[i].toHex())).arg(QString(digest.toHex()));
+				progress->OnFileComplete(listed[i], listed[i], matched[i], msg);
+				});
+			for (int i = 0; i < listed.size(); i++) {
+				if (matched[i])
+					result << listed[i];
+				else
+					failed++;
+			}
+		}
+		if (mCancelled) {
+			progress->OnComplete(false, QObject::tr("Cancelled."));
+		} else {
+			progress->OnComplete(failed == 0, QObject::tr("Finish, %1 files verified, %2 failed.").arg(result.size()).arg(failed));
+		}
+		return result;
+	}
+
+	void ChecksumHandler::HashFiles(const QFileInfoList& files, Checksum::Algorithm algorithm, ProgressPtr progress, const std::function<void(int, const QByteArray&)>& hashed) {
+		int maxParallel = mArgMap["MaxParallel"].IntValue();
+		if (maxParallel <= 0) {
+			maxParallel = QThread::idealThreadCount();
+		}
+		//! Files are weighted by their size, empty files count as one byte.
+		qint64 total = 0;
+		for (const QFileInfo& file : files) {
+			total += qMax<qint64>(file.size(), 1);
+		}
+
+		QMutex mutex;
+		qint64 done = 0;
+		QThreadPool workers;
+		workers.setMaxThreadCount(maxParallel);
+		for (int i = 0; i < files.size(); i++) {
+			workers.start([&, i]() {
+				if (mCancelled)
+					return;
+				const QFileInfo& file = files[i];
+				qint64 reported = 0;
+				QByteArray digest = Checksum::HashFile(file.absoluteFilePath(), algorithm, [&](qint64 bytes) {
+					QMutexLocker locker(&mutex);
+					done += bytes - reported;
+					reported = bytes;
+					progress->OnProgress(100.0 * done / total, QObject::tr("Hashing: %1").arg(file.absoluteFilePath()));
+					return !mCancelled;
+					});
+				//! The results are reported under the lock too, the progress of the task is not thread safe.
+				QMutexLocker locker(&mutex);
+				done += qMax<qint64>(file.size(), 1) - reported;
+				if (!mCancelled)
+					hashed(i, digest);
+				});
+		}
+		workers.waitForDone();
+	}
+
+	/************************************************************************************************************************
+	 * Class： DuplicateFinderHandler
+	 *
+	 *
+	/************************************************************************************************************************/
+	static const qint64 PartialBlockSize = 64 << 10;
+	//! Size groups are hashed in batches of about this many files, only one batch of digests is held at a time.
+	static const int DuplicateBatchSize = 4096;
+
+	//! Hash of the first and the last blocks, the whole content for small files.
+	static QByteArray PartialDigest(const QString& path, qint64 size) {
+		QFile file(path);
+		if (!file.open(QIODevice::ReadOnly))
+			return QByteArray();
+		Checksum checksum(Checksum::XXH3);
+		if (size <= 2 * PartialBlockSize) {
+			checksum.AddData(file.readAll());
+		} else {
+			checksum.AddData(file.read(PartialBlockSize));
+			if (!file.seek(size - PartialBlockSize))
+				return QByteArray();
+			checksum.AddData(file.read(PartialBlockSize));
+		}
+		return checksum.Result();
+	}
+
+	DuplicateFinderHandler::DuplicateFinderHandler(int minSize, const QString& action, int maxParallel) {
+		mArgMap["MinSize"] = Argument("MinSize", QObject::tr("Min Size(KB)"), QObject::tr("Files smaller than this are ignored, empty files are always ignored, default is 0."), minSize);
+		mArgMap["MinSize"].AddLimit("^(0|[1-9]\\d{0,8})$");
+		mArgMap["Action"] = Argument("Action", QObject::tr("Action"), QObject::tr("What to do with the duplicates, the oldest file of each group is kept, None only reports them."), action, Argument::Option);
+		mArgMap["Action"].AddLimit("None").AddLimit("Trash").AddLimit("Delete").AddLimit("Hardlink").AddLimit("Reflink");
+		mArgMap["MaxParallel"] = Argument("MaxParallel", QObject::tr("Max Parallel"), QObject::tr("Max number of files hashed at the same time, 0 means the number of CPU cores, use 1 for spinning disks, default is 0."), maxParallel);
+		mArgMap["MaxParallel"].AddLimit("^(0|[1-9]\\d{0,2})$");
+	}
+
+	QFileInfoList DuplicateFinderHandler::Handle(const QFileInfoList& files, ProgressPtr progress) {
+		mCancelled = false;
+		qint64 minSize = qMax<qint64>((qint64)mArgMap["MinSize"].IntValue() * 1024, 1);
+
+		//! The first walk only counts the sizes, the second one keeps the files sharing their size with another file,
+		//! so a tree of millions of mostly unique files never has all its paths in memory.
+		progress->OnProgress(-1, QObject::tr("Scanning..."));
+		QHash<qint64, int> sizeCounts;
+		Walk(files, [&](const QFileInfo& file) {
+			if (file.size() >= minSize)
+				sizeCounts[file.size()]++;
+			});
+		QVector<Candidate> candidates;
+		Walk(files, [&](const QFileInfo& file) {
+			if (sizeCounts.value(file.size()) > 1)
+				candidates << Candidate{ file.size(), file.absoluteFilePath() };
+			});
+		sizeCounts.clear();
+		sizeCounts.squeeze();
+
+		//! The largest files first, they free the most space.
+		std::sort(candidates.begin(), candidates.end(), [](const Candidate& c1, const Candidate& c2) {
+			return c1.size != c2.size ? c1.size > c2.size : c1.path < c2.path;
+			});
+
+		QFileInfoList result;
+		int count = candidates.size();
+		for (int begin = 0; begin < count && !mCancelled;) {
+			int end = begin + 1;
+			while (end < count && (end - begin < DuplicateBatchSize || candidates[end].size == candidates[end - 1].size))
+				end++;
+			FindInBatch(candidates, begin, end, 100.0 * begin / count, result, progress);
+			begin = end;
+		}
+		if (mCancelled) {
+			progress->OnComplete(false, QObject::tr("Cancelled."));
+			return result;
+		}
+		progress->OnComplete(true, QObject::tr("Finish, %1 duplicate files found.").arg(result.size()));
+		return result;
+	}
+
+	std::shared_ptr<FileHandler> DuplicateFinderHandler::Clone() {
+		return FileHandlerPtr(new DuplicateFinderHandler(*this));
+	}
+
+	void DuplicateFinderHandler::Walk(const QFileInfoList& files, const std::function<void(const QFileInfo&)>& visit) {
+		for (const QFileInfo& file : files) {
+			if (file.isSymLink())
+				continue;
+			if (file.isFile()) {
+				visit(file);
+				continue;
+			}
+			QDirIterator fit(file.absoluteFilePath(), QDir::Files | QDir::System | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+			while (fit.hasNext() && !mCancelled) {
+				fit.next();
+				if (!fit.fileInfo().isSymLink())
+					visit(fit.fileInfo());
+			}
+		}
+	}
+
+	void DuplicateFinderHandler::ForEach(const QVector<int>& indices, const std::function<void(int)>& task) {
+		int maxParallel = mArgMap["MaxParallel"].IntValue();
+		QThreadPool workers;
+		workers.setMaxThreadCount(maxParallel > 0 ? maxParallel : QThread::idealThreadCount());
+		for (int i : indices) {
+			workers.start([&, i]() {
+				if (!mCancelled)
+					task(i);
+				});
+		}
+		workers.waitForDone();
+	}
+
+	void DuplicateFinderHandler::FindInBatch(const QVector<Candidate>& candidates, int begin, int end, double percent, QFileInfoList& result, ProgressPtr progress) {
+		int count = end - begin;
+		QVector<int> all(count);
+		for (int i = 0; i < count; i++)
+			all[i] = i;
+
+		//! Stage two, the files of a size are told apart by their first and last blocks.
+		QVector<QByteArray> partials(count);
+		QVector<QPair<quint64, quint64>> ids(count, qMakePair(0ULL, 0ULL));
+		progress->OnProgress(percent, QObject::tr("Comparing: %1").arg(candidates[begin].path));
+		ForEach(all, [&](int i) {
+			const Candidate& c = candidates[begin + i];
+			FileSystem::FileId(c.path, ids[i].first, ids[i].second);
+			partials[i] = PartialDigest(c.path, c.size);
+			});
+
+		//! Hard links of one file, or a file reached from two inputs, share their id and are the same file.
+		QMap<QPair<qint64, QByteArray>, QVector<int>> partialGroups;
+		QSet<QPair<quint64, quint64>> seen;
+		qint64 lastSize = -1;
+		for (int i = 0; i < count; i++) {
+			const Candidate& c = candidates[begin + i];
+			if (c.size != lastSize) {
+				seen.clear();
+				lastSize = c.size;
+			}
+			if (partials[i].isEmpty())
+				continue;
+			if (ids[i].second != 0 && seen.contains(ids[i]))
+				continue;
+			seen << ids[i];
+			partialGroups[qMakePair(c.size, partials[i])] << i;
+		}
+		partials.clear();
+
+		//! Stage three, the survivors larger than the two blocks are hashed completely.
+		QVector<int> fullTodo;
+		for (const QVector<int>& group : partialGroups) {
+			if (group.size() > 1 && candidates[begin + group[0]].size > 2 * PartialBlockSize)
+				fullTodo << group;
+		}
+		QVector<QByteArray> fulls(count);
+		QMutex mutex;
+		ForEach(fullTodo, [&](int i) {
+			const Candidate& c = candidates[begin + i];
+			{
+				QMutexLocker locker(&mutex);
+				progress->OnProgress(percent, QObject::tr("Comparing: %1").arg(c.path));
+			}
+			fulls[i] = Checksum::HashFile(c.path, Checksum::XXH3, [&](qint64) { return !mCancelled; });
+			});
+		if (mCancelled)
+			return;
+
+		QString action = mArgMap["Action"].StringValue();
+		for (const QVector<int>& group : partialGroups) {
+			if (group.size() < 2)
+				continue;
+			QMap<QByteArray, QFileInfoList> fullGroups;
+			for (int i : group) {
+				const Candidate& c = candidates[begin + i];
+				if (c.size <= 2 * PartialBlockSize)
+					fullGroups[QByteArray()] << QFileInfo(c.path);
+				else if (!fulls[i].isEmpty())
+					fullGroups[fulls[i]] << QFileInfo(c.path);
+			}
+			for (QFileInfoList& same : fullGroups) {
+				if (same.size() < 2)
+					continue;
+				//! The oldest file is taken as the original.
+				std::sort(same.begin(), same.end(), [](const QFileInfo& f1, const QFileInfo& f2) {
+					return f1.lastModified() != f2.lastModified() ? f1.lastModified() < f2.lastModified() : f1.absoluteFilePath() < f2.absoluteFilePath();
+					});
+				const QFileInfo& original = same[0];
+				for (int i = 1; i < same.size(); i++) {
+					QString error;
+					bool flag = action == "None" || DuplicateResolveHandler::Resolve(action, same[i].absoluteFilePath(), original.absoluteFilePath(), error);
+					progress->OnFileComplete(same[i], original, flag, flag ? QObject::tr("Same content as %1, %2.").arg(original.absoluteFilePath()).arg(String::BytesHint(same[i].size())) : error);
+					if (flag)
+						result << same[i];
+				}
+			}
+		}
+	}
+
+	/************************************************************************************************************************
+	 * Class： DuplicateResolveHandler
+	 *
+	 *
+	/************************************************************************************************************************/
+	static bool SameContent(const QString& path1, const QString& path2) {
+		QFile file1(path1);
+		QFile file2(path2);
+		if (!file1.open(QIODevice::ReadOnly) || !file2.open(QIODevice::ReadOnly) || file1.size() != file2.size())
+			return false;
+		QByteArray buffer1(CopyBlockSize, 0);
+		QByteArray buffer2(CopyBlockSize, 0);
+		while (true) {
+			qint64 n1 = file1.read(buffer1.data(), CopyBlockSize);
+			qint64 n2 = file2.read(buffer2.data(), CopyBlockSize);
+			if (n1 != n2 || n1 < 0)
+				return false;
+			if (n1 == 0)
+				return true;
+			if (memcmp(buffer1.constData(), buffer2.constData(), n1) != 0)
+				return false;
+		}
+	}
+
+	DuplicateResolveHandler::DuplicateResolveHandler(const QString& action) {
+		mArgMap["Action"] = Argument("Action", QObject::tr("Action"), QObject::tr("Move the duplicates to the trash, delete them, or replace them with hard links or reflinks to their originals."), action, Argument::Option);
+		mArgMap["Action"].AddLimit("Trash").AddLimit("Delete").AddLimit("Hardlink").AddLimit("Reflink");
+	}
+
+	bool DuplicateResolveHandler::Resolve(const QString& action, const QString& duplicate, const QString& original, QString& error) {
+		quint64 device1 = 0, inode1 = 0, device2 = 0, inode2 = 0;
+		if (FileSystem::FileId(duplicate, device1, inode1) && FileSystem::FileId(original, device2, inode2) && device1 == device2 && inode1 == inode2) {
+			error = QObject::tr("%1 and %2 are the same file.").arg(duplicate).arg(original);
+			return false;
+		}
+		if (!SameContent(duplicate, original)) {
+			error = QObject::tr("%1 no longer has the same content as %2.").arg(duplicate).arg(original);
+			return false;
+		}
+
+		if (action == "Trash" || action == "Delete") {
+			QFile file(duplicate);
+			bool flag = action == "Trash" ? file.moveToTrash() : file.remove();
+			if (!flag)
+				error = file.errorString();
+			return flag;
+		}
+
+		//! The link is made beside the duplicate first, the duplicate is only replaced once the link exists.
+		QFileInfo dup(duplicate);
+		QString temp = dup.absoluteDir().absoluteFilePath(QString(".%1.ffx-link").arg(dup.fileName()));
+		QFile::remove(temp);
+		bool linked = action == "Hardlink" ? FileSystem::HardLink(original, temp, &error) : FileSystem::Reflink(original, temp, &error);
+		if (!linked)
+			return false;
+		if (!QFile::remove(duplicate) || !QFile::rename(temp, duplicate)) {
+			error = QObject::tr("Cannot replace %1, the link is left at %2.").arg(duplicate).arg(temp);
+			return false;
+		}
+		return true;
+	}
+
+	QFileInfoList DuplicateResolveHandler::Handle(const QFileInfoList& files, ProgressPtr progress) {
+		mCancelled = false;
+		QString action = mArgMap["Action"].StringValue();
+		QFileInfoList result;
+		int size = files.size();
+		for (int i = 0; i < size && !mCancelled; i++) {
+			const QFileInfo& file = files[i];
+			QString original = mOriginals.value(file.absoluteFilePath());
+			if (original.isEmpty())
+				continue;
+			progress->OnProgress(100.0 * i / size, QObject::tr("Resolving: %1").arg(file.absoluteFilePath()));
+			QString error;
+			bool flag = Resolve(action, file.absoluteFilePath(), original, error);
+			progress->OnFileComplete(file, QFileInfo(original), flag, error);
+			if (flag)
+				result << file;
+		}
+		progress->OnComplete(!mCancelled, mCancelled ? QObject::tr("Cancelled.") : QObject::tr("Finish, %1 duplicate files resolved.").arg(result.size()));
+		return result;
+	}
+
+	std::shared_ptr<FileHandler> DuplicateResolveHandler::Clone() {
+		return FileHandlerPtr(new DuplicateResolveHandler(*this));
+	}
+
+	/************************************************************************************************************************
+	 * Class： FileMirrorHandler
+	 *
+	 *
+	/************************************************************************************************************************/
+	//! FAT and SMB shares keep modification times in 2 seconds steps.
+	static const qint64 ModifyWindow = 2000;
+	static const qint64 DeltaBlockSize = 64 << 10;
+	static const quint32 DeltaSignatureMagic = 0x46465853;
+	static const quint32 DeltaSignatureVersion = 1;
+
+	/// <summary>
+	/// rsync's rolling checksum of a window, the window slides or shrinks by one byte in constant time.
+	/// </summary>
+	struct RollingSum {
+		quint32 a = 0;
+		quint32 b = 0;
+		qint64 size = 0;
+
+		void Init(const uchar* data, qint64 n) {
+			a = b = 0;
+			size = n;
+			for (qint64 i = 0; i < n; i++) {
+				a += data[i];
+				b += (quint32)(n - i) * data[i];
+			}
+		}
+		void Roll(uchar out, uchar in) {
+			a += in - out;
+			b += a - (quint32)size * out;
+		}
+		void Drop(uchar out) {
+			a -= out;
+			b -= (quint32)size * out;
+			size--;
+		}
+		quint32 Value() const { return (b << 16) | (a & 0xffff); }
+	};
+
+	static inline int DeltaTag(quint32 weak) {
+		return (int)((weak ^ (weak >> 16)) & 0xffff);
+	}
+
+	//! Weak and strong sums of every block of a file, kept per destination with the size and time they were taken at.
+	struct DeltaSignature {
+		qint64 size = 0;
+		qint64 modified = 0;
+		QVector<quint32> weak;
+		QVector<quint64> strong;
+
+		void Append(const char* data, qint64 n) {
+			RollingSum sum;
+			sum.Init((const uchar*)data, n);
+			Checksum checksum(Checksum::XXH64);
+			checksum.AddData(data, n);
+			weak << sum.Value();
+			strong << qFromBigEndian<quint64>(checksum.Result().constData());
+		}
+	};
+
+	static QString DeltaSignaturePath(const QString& dest) {
+		QCryptographicHash hash(QCryptographicHash::Sha1);
+		hash.addData(QFileInfo(dest).absoluteFilePath().toUtf8());
+		QDir dir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation));
+		return dir.absoluteFilePath(QString("mirror/%1.sig").arg(QString(hash.result().toHex().left(16))));
+	}
+
+	//! The signature left by the last update, unless the destination changed since.
+	static bool LoadDeltaSignature(const QFileInfo& dest, DeltaSignature& signature) {
+		QFile file(DeltaSignaturePath(dest.absoluteFilePath()));
+		if (!file.open(QIODevice::ReadOnly))
+			return false;
+		QDataStream stream(&file);
+		quint32 magic = 0, version = 0;
+		stream >> magic >> version;
+		if (magic != DeltaSignatureMagic || version != DeltaSignatureVersion)
+			return false;
+		stream >> signature.size >> signature.modified >> signature.weak >> signature.strong;
+		return stream.status() == QDataStream::Ok && signature.size == dest.size() && signature.modified == dest.lastModified().toMSecsSinceEpoch()
+			&& signature.weak.size() == signature.strong.size() && signature.weak.size() == (signature.size + DeltaBlockSize - 1) / DeltaBlockSize;
+	}
+
+	static void SaveDeltaSignature(const QFileInfo& dest, DeltaSignature& signature) {
+		signature.size = dest.size();
+		signature.modified = dest.lastModified().toMSecsSinceEpoch();
+		QString path = DeltaSignaturePath(dest.absoluteFilePath());
+		QDir().mkpath(QFileInfo(path).absolutePath());
+		QSaveFile file(path);
+		if (!file.open(QIODevice::WriteOnly))
+			return;
+		QDataStream stream(&file);
+		stream << DeltaSignatureMagic << DeltaSignatureVersion << signature.size << signature.modified << signature.weak << signature.strong;
+		file.commit();
+	}
+
+	FileMirrorHandler::FileMirrorHandler(const QString& destPath, bool compareHash, bool deleteExtraneous, int deltaMinSize) {
+		mArgMap["DestPath"] = Argument("DestPath", QObject::tr("DestPath"), QObject::tr("Target directory the files are mirrored into."), destPath, Argument::Dir);
+		mArgMap["CompareHash"] = Argument("CompareHash", QObject::tr("Compare Hash"), QObject::tr("Compare the content of the files with the same size instead of their modification time, slower but catches every change, default is false."), compareHash, Argument::Bool);
+		mArgMap["DeleteExtraneous"] = Argument("DeleteExtraneous", QObject::tr("Delete Extraneous"), QObject::tr("Delete the files of the mirrored directories that are not in the source, default is false."), deleteExtraneous, Argument::Bool);
+		mArgMap["DeltaMinSize"] = Argument("DeltaMinSize", QObject::tr("Delta Min Size(MB)"), QObject::tr("Changed files at least this large are updated block by block instead of copied again, 0 means always copy whole files, default is 16."), deltaMinSize);
+		mArgMap["DeltaMinSize"].AddLimit("^(0|[1-9]\\d{0,5})$");
+	}
+
+	QFileInfoList FileMirrorHandler::Handle(const QFileInfoList& files, ProgressPtr progress) {
+		mCancelled = false;
+		mSourceFiles = 0;
+		mSourceBytes = 0;
+		mTotalBytes = 0;
+		mDoneBytes = 0;
+
+		QFileInfoList result;
+		QList<Transfer> transfers;
+		QStringList extraneous;
+		QDir targetDir(mArgMap["DestPath"].StringValue());
+		targetDir.mkpath(".");
+		for (const QFileInfo& file : files) {
+			QString targetFile = targetDir.absoluteFilePath(file.fileName());
+			Compare(file, targetFile, transfers, extraneous, progress);
+			result << targetFile;
+		}
+
+		//! Extraneous files go first, so their space is free for the transfers.
+		int deleted = 0;
+		if (mArgMap["DeleteExtraneous"].BoolValue()) {
+			for (const QString& path : extraneous) {
+				if (mCancelled)
+					break;
+				QFileInfo file(path);
+				bool flag = file.isDir() && !file.isSymLink() ? QDir(path).removeRecursively() : QFile::remove(path);
+				if (flag) {
+					deleted++;
+				}
+				progress->OnFileComplete(file, file, flag, flag ? QObject::tr("Not in the source, deleted.") : QObject::tr("Not in the source, cannot be deleted."));
+			}
+		}
+
+		for (const Transfer& transfer : transfers) {
+			mTotalBytes += transfer.source.size();
+		}
+		//! Unchanged files are not transferred at all.
+		qint64 saved = mSourceBytes - mTotalBytes;
+		qint64 deltaMinSize = mArgMap["DeltaMinSize"].IntValue() * qint64(1 << 20);
+		int copied = 0, updated = 0, failed = 0;
+		for (const Transfer& transfer : transfers) {
+			if (mCancelled)
+				break;
+			progress->OnProgress(Percent(), QObject::tr("Mirroring: %1").arg(transfer.source.absoluteFilePath()));
+			qint64 size = transfer.source.size();
+			QString message;
+			QString error;
+			bool flag;
+			if (transfer.update && deltaMinSize > 0 && size >= deltaMinSize && QFileInfo(transfer.dest).isFile()) {
+				qint64 transferred = 0;
+				flag = CopyDelta(transfer.source, transfer.dest, transferred, error, progress);
+				if (flag) {
+					saved += size - transferred;
+					message = QObject::tr("Updated, %1 of %2 transferred.").arg(String::BytesHint(transferred)).arg(String::BytesHint(size));
+				}
+			} else {
+				flag = CopyWhole(transfer.source, transfer.dest, error, progress);
+				message = transfer.update ? QObject::tr("Replaced.") : QObject::tr("Copied.");
+			}
+			if (!flag) {
+				failed++;
+				message = error;
+			} else if (transfer.update) {
+				updated++;
+			} else {
+				copied++;
+			}
+			progress->OnFileComplete(transfer.source, transfer.dest, flag, message);
+		}
+
+		QString summary = QObject::tr("Finish, %1 files copied, %2 updated, %3 unchanged, %4 deleted, %5 saved.")
+			.arg(copied).arg(updated).arg(mSourceFiles - transfers.size()).arg(deleted).arg(String::BytesHint(saved));
+		if (failed > 0) {
+			summary += QObject::tr(" %1 files failed.").arg(failed);
+		}
+		progress->OnComplete(failed == 0 && !mCancelled, summary);
+		return result;
+	}
+
+	std::shared_ptr<FileHandler> FileMirrorHandler::Clone() {
+		return FileHandlerPtr(new FileMirrorHandler(*this));
+	}
+
+	void FileMirrorHandler::Compare(const QFileInfo& source, const QString& dest, QList<Transfer>& transfers, QStringList& extraneous, ProgressPtr progress) {
+		if (mCancelled)
+			return;
+		QFileInfo destInfo(dest);
+		if (!source.isDir()) {
+			mSourceFiles++;
+			mSourceBytes += source.size();
+			if (destInfo.isDir()) {
+				//! A directory in the way is only removed with DeleteExtraneous, the transfer fails otherwise.
+				extraneous << dest;
+				transfers << Transfer{ source, dest, false };
+			} else if (!destInfo.exists()) {
+				transfers << Transfer{ source, dest, false };
+			} else if (Changed(source, destInfo)) {
+				transfers << Transfer{ source, dest, true };
+			}
+			return;
+		}
+
+		if (destInfo.exists() && !destInfo.isDir()) {
+			extraneous << dest;
+		} else if (!destInfo.exists()) {
+			QDir().mkpath(dest);
+		}
+		progress->OnProgress(-1, QObject::tr("Comparing: %1").arg(source.absoluteFilePath()));
+
+		QSet<QString> names;
+		QDir destDir(dest);
+		QDirIterator fit(source.absoluteFilePath(), QDir::Files | QDir::Dirs | QDir::System | QDir::Hidden | QDir::NoDotAndDotDot);
+		while (fit.hasNext() && !mCancelled) {
+			fit.next();
+			QFileInfo fi = fit.fileInfo();
+#ifdef Q_OS_WIN
+			names << fi.fileName().toLower();
+#else
+			names << fi.fileName();
+#endif
+			//! Links to directories are not followed, they may lead back up the tree.
+			if (fi.isSymLink() && fi.isDir())
+				continue;
+			Compare(fi, destDir.absoluteFilePath(fi.fileName()), transfers, extraneous, progress);
+		}
+		if (!destInfo.isDir())
+			return;
+
+		QDirIterator dit(dest, QDir::Files | QDir::Dirs | QDir::System | QDir::Hidden | QDir::NoDotAndDotDot);
+		while (dit.hasNext() && !mCancelled) {
+			dit.next();
+#ifdef Q_OS_WIN
+			QString name = dit.fileName().toLower();
+#else
+			QString name = dit.fileName();
+#endif
+			if (!names.contains(name)) {
+				extraneous << dit.filePath();
+			}
+		}
+	}
+
+	bool FileMirrorHandler::Changed(const QFileInfo& source, const QFileInfo& dest) {
+		if (source.size() != dest.size())
+			return true;
+		bool timeChanged = qAbs(source.lastModified().msecsTo(dest.lastModified())) >= ModifyWindow;
+		if (!mArgMap["CompareHash"].BoolValue())
+			return timeChanged;
+		if (Checksum::HashFile(source.absoluteFilePath(), Checksum::XXH3) != Checksum::HashFile(dest.absoluteFilePath(), Checksum::XXH3))
+			return true;
+		if (timeChanged) {
+			//! Same content, only the time is brought over so a run without CompareHash sees the file unchanged.
+			QFile file(dest.absoluteFilePath());
+			if (file.open(QIODevice::Append)) {
+				file.setFileTime(source.lastModified(), QFileDevice::FileModificationTime);
+			}
+		}
+		return false;
+	}
+
+	bool FileMirrorHandler::CopyWhole(const QFileInfo& source, const QString& dest, QString& error, ProgressPtr progress) {
+		QFile in(source.absoluteFilePath());
+		if (!in.open(QIODevice::ReadOnly)) {
+			error = in.errorString();
+			return false;
+		}
+		QDir().mkpath(QFileInfo(dest).absolutePath());
+		//! Written beside the old copy and renamed over it at the end, an interrupted transfer leaves the old copy intact.
+		QSaveFile out(dest);
+		if (!out.open(QIODevice::WriteOnly)) {
+			error = out.errorString();
+			return false;
+		}
+
+		QByteArray buffer(CopyBlockSize, 0);
+		while (!mCancelled) {
+			qint64 n = in.read(buffer.data(), buffer.size());
+			if (n == 0)
+				break;
+			if (n < 0 || out.write(buffer.constData(), n) != n) {
+				error = n < 0 ? in.errorString() : out.errorString();
+				out.cancelWriting();
+				return false;
+			}
+			mDoneBytes += n;
+			progress->OnProgress(Percent(), QObject::tr("Mirroring: %1").arg(source.absoluteFilePath()));
+		}
+		if (mCancelled) {
+			out.cancelWriting();
+			error = QObject::tr("Cancelled.");
+			return false;
+		}
+		//! The modification time is what the next run compares.
+		out.setFileTime(in.fileTime(QFileDevice::FileModificationTime), QFileDevice::FileModificationTime);
+		if (!out.commit()) {
+			error = out.errorString();
+			return false;
+		}
+		QFile::setPermissions(dest, in.permissions());
+		return true;
+	}
+
+	bool FileMirrorHandler::CopyDelta(const QFileInfo& source, const QString& dest, qint64& transferred, QString& error, ProgressPtr progress) {
+		QFile in(source.absoluteFilePath());
+		if (!in.open(QIODevice::ReadOnly)) {
+			error = in.errorString();
+			return false;
+		}
+		QFile old(dest);
+		if (!old.open(QIODevice::ReadOnly)) {
+			error = old.errorString();
+			return false;
+		}
+
+		//! The blocks of the destination are hashed once, the next updates take their sums from the cache as long as the destination is unchanged.
+		QFileInfo destInfo(dest);
+		DeltaSignature signature;
+		if (!LoadDeltaSignature(destInfo, signature)) {
+			signature = DeltaSignature();
+			QByteArray block(DeltaBlockSize, 0);
+			while (!mCancelled) {
+				qint64 n = old.read(block.data(), block.size());
+				if (n < 0) {
+					error = old.errorString();
+					return false;
+				}
+				if (n == 0)
+					break;
+				signature.Append(block.constData(), n);
+				signature.size += n;
+			}
+		}
+		//! Most windows match nothing, a table of 16 bit tags rules them out before the hash is looked up.
+		QMultiHash<quint32, int> blocks;
+		std::vector<bool> tags(1 << 16);
+		for (int i = 0; i < signature.weak.size(); i++) {
+			blocks.insert(signature.weak[i], i);
+			tags[DeltaTag(signature.weak[i])] = true;
+		}
+
+		//! Written beside the old copy and renamed over it at the end, an interrupted update leaves the old copy intact.
+		QSaveFile out(dest);
+		if (!out.open(QIODevice::WriteOnly)) {
+			error = out.errorString();
+			return false;
+		}
+		//! The sums of the new content are taken while it is written, for the next update.
+		DeltaSignature next;
+		QByteArray pending;
+		auto write = [&](const char* data, qint64 n) {
+			if (out.write(data, n) != n)
+				return false;
+			while (n > 0) {
+				qint64 m = qMin(n, DeltaBlockSize - pending.size());
+				pending.append(data, (int)m);
+				data += m;
+				n -= m;
+				if (pending.size() == DeltaBlockSize) {
+					next.Append(pending.constData(), pending.size());
+					pending.clear();
+				}
+			}
+			return true;
+		};
+
+		//! The window slides over the source a byte at a time, a window whose sums match a block of the destination is taken
+		//! from the destination and the bytes skipped before it are taken from the source.
+		QByteArray buffer;
+		int pos = 0;
+		int literal = 0;
+		bool eof = false;
+		bool rolling = false;
+		RollingSum sum;
+		Checksum strong(Checksum::XXH64);
+		QByteArray block(DeltaBlockSize, 0);
+		transferred = 0;
+		while (!mCancelled) {
+			//! Literal runs are written out before the buffer grows past a copy block.
+			if (pos - literal >= CopyBlockSize) {
+				if (!write(buffer.constData() + literal, pos - literal)) {
+					error = out.errorString();
+					out.cancelWriting();
+					return false;
+				}
+				transferred += pos - literal;
+				literal = pos;
+			}
+			if (!eof && buffer.size() - pos <= DeltaBlockSize) {
+				buffer.remove(0, literal);
+				pos -= literal;
+				literal = 0;
+				int size = buffer.size();
+				buffer.resize(size + CopyBlockSize);
+				qint64 n = in.read(buffer.data() + size, CopyBlockSize);
+				if (n < 0) {
+					error = in.errorString();
+					out.cancelWriting();
+					return false;
+				}
+				buffer.resize(size + (int)n);
+				eof = n == 0;
+				mDoneBytes += n;
+				progress->OnProgress(Percent(), QObject::tr("Mirroring: %1").arg(source.absoluteFilePath()));
+				continue;
+			}
+
+			qint64 n = qMin<qint64>(DeltaBlockSize, buffer.size() - pos);
+			if (n == 0)
+				break;
+			const uchar* window = (const uchar*)buffer.constData() + pos;
+			if (!rolling) {
+				sum.Init(window, n);
+				rolling = true;
+			}
+
+			int match = -1;
+			bool hashed = false;
+			quint64 digest = 0;
+			quint32 value = sum.Value();
+			auto it = tags[DeltaTag(value)] ? blocks.constFind(value) : blocks.constEnd();
+			for (; it != blocks.constEnd() && it.key() == value; ++it) {
+				int k = it.value();
+				if (qMin(DeltaBlockSize, signature.size - k * DeltaBlockSize) != n)
+					continue;
+				if (!hashed) {
+					strong.Reset();
+					strong.AddData((const char*)window, n);
+					digest = qFromBigEndian<quint64>(strong.Result().constData());
+					hashed = true;
+				}
+				if (signature.strong[k] == digest) {
+					match = k;
+					break;
+				}
+			}
+
+			//! The block is read back to be copied, a destination changed behind the cached sums or a collision of both sums is caught here.
+			if (match >= 0 && (!old.seek(match * DeltaBlockSize) || old.read(block.data(), n) != n || memcmp(block.constData(), window, n) != 0)) {
+				blocks.remove(value, match);
+				match = -1;
+			}
+			if (match < 0) {
+				//! Near the end the window shrinks, only the last block of the destination can match there.
+				if (pos + n < buffer.size()) {
+					sum.Roll(window[0], window[n]);
+				} else {
+					sum.Drop(window[0]);
+				}
+				pos++;
+				continue;
+			}
+
+			if (!write(buffer.constData() + literal, pos - literal) || !write(block.constData(), n)) {
+				error = out.errorString();
+				out.cancelWriting();
+				return false;
+			}
+			transferred += pos - literal;
+			pos += n;
+			literal = pos;
+			rolling = false;
+		}
+		if (mCancelled) {
+			out.cancelWriting();
+			error = QObject::tr("Cancelled.");
+			return false;
+		}
+		if (!write(buffer.constData() + literal, buffer.size() - literal)) {
+			error = out.errorString();
+			out.cancelWriting();
+			return false;
+		}
+		transferred += buffer.size() - literal;
+		if (!pending.isEmpty()) {
+			next.Append(pending.constData(), pending.size());
+		}
+
+		//! The modification time is what the next run compares, the old copy is closed so it can be replaced.
+		old.close();
+		out.setFileTime(in.fileTime(QFileDevice::FileModificationTime), QFileDevice::FileModificationTime);
+		if (!out.commit()) {
+			error = out.errorString();
+			return false;
+		}
+		QFile::setPermissions(dest, in.permissions());
+		SaveDeltaSignature(QFileInfo(dest), next);
+		return true;
+	}
+
+	/************************************************************************************************************************
+	 * Class： DiskUsageHandler
+	 *
+	 *
+	/************************************************************************************************************************/
+	DiskUsageHandler::DiskUsageHandler(int maxParallel) {
+		mArgMap["MaxParallel"] = Argument("MaxParallel", QObject::tr("Max Parallel"), QObject::tr("Max number of directories listed at the same time, 0 means the number of CPU cores, default is 0."), maxParallel);
+		mArgMap["MaxParallel"].AddLimit("^(0|[1-9]\\d{0,2})$");
+	}
+
+	QFileInfoList DiskUsageHandler::Handle(const QFileInfoList& files, ProgressPtr progress) {
+		mCancelled = false;
+		int maxParallel = mArgMap["MaxParallel"].IntValue();
+		QFileInfoList result;
+		QMutex mutex;
+		for (int i = 0; i < files.size() && !mCancelled; i++) {
+			const QFileInfo& dir = files[i];
+			if (!dir.isDir() || dir.isSymLink())
+				continue;
+			double p = i * 100.0 / files.size();
+			progress->OnProgress(p, QObject::tr("Analyzing: %1").arg(dir.absoluteFilePath()));
+
+			//! The cached tree of the last analysis saves listing the directories that did not change since.
+			QString cachePath = DiskUsageTree::CachePath(dir.absoluteFilePath());
+			DiskUsageTree previous;
+			previous.Load(cachePath);
+			DiskUsageTree tree;
+			bool flag = tree.Scan(dir.absoluteFilePath(), maxParallel, previous,
+				[&](qint64 scanned) {
+					QMutexLocker locker(&mutex);
+					progress->OnProgress(p, QObject::tr("Analyzing: %1, %2 directories").arg(dir.absoluteFilePath()).arg(scanned));
+				},
+				[this]() { return mCancelled; });
+			if (!flag || !tree.Save(cachePath)) {
+				progress->OnFileComplete(dir, QFileInfo(), false, mCancelled ? QObject::tr("Cancelled.") : QObject::tr("Cannot analyze %1.").arg(dir.absoluteFilePath()));
+				continue;
+			}
+			const DiskUsageNode& root = tree.Node(0);
+			progress->OnFileComplete(dir, QFileInfo(cachePath), true, QObject::tr("%1 in %2 files, %3 directories, %4 listed again.")
+				.arg(String::BytesHint(root.size)).arg(root.files).arg(root.dirs).arg(tree.ListedCount()));
+			result << dir;
+		}
+		progress->OnComplete(!mCancelled, QObject::tr("Finish, Total %1 directories analyzed.").arg(result.size()));
+		return result;
+	}
+
+	std::shared_ptr<FileHandler> DiskUsageHandler::Clone() {
+		return FileHandlerPtr(new DiskUsageHandler(*this));
+	}
+
 	HandlerFactory::HandlerFactory() {
 		Append(std::make_shared<FileRenameHandler>(""));
 		Append(std::make_shared<FileCopyHandler>(""));
 		Append(std::make_shared<FileMoveHandler>(""));
 		Append(std::make_shared<FileDeleteHandler>());
+		Append(std::make_shared<TrashRestoreHandler>());
 		Append(std::make_shared<FileEnvelopeByDirHandler>());
 		Append(std::make_shared<ClearFolderHandler>());
+		Append(std::make_shared<ChecksumHandler>());
+		Append(std::make_shared<DuplicateFinderHandler>());
+		Append(std::make_shared<DuplicateResolveHandler>());
+		Append(std::make_shared<FileMirrorHandler>(""));
+		Append(std::make_shared<DiskUsageHandler>());
 	}
 
 	void HandlerFactory::Append(FileHandlerPtr handler) {
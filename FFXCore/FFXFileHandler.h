@@ -2,16 +2,29 @@
 #define _FFXFILEHANDLER_H_
 #include "FFXFile.h"
 #include "FFXFileFilter.h"
+#include "FFXChecksum.h"
+#include "FFXFileSystem.h"
 
 #include <QFileInfo>
 #include <QDir>
 #include <QSet>
+#include <QPair>
 #include <QVariant>
 #include <QDateTime>
 #include <QSize>
 #include <QRect>
+#include <QAtomicInt>
 #include <QDebug>
 #include <memory> // for shared_ptr
+#include <functional>
+
+class QThreadPool;
+class QMutex;
+
+namespace FFX {
+	class TaskJournal;
+	typedef std::shared_ptr<TaskJournal> TaskJournalPtr;
+}
 
 namespace FFX {
 	class Argument {
@@ -138,14 +151,19 @@ namespace FFX {
 		virtual QString Description() { return ""; }
 		virtual QString String();
 		virtual bool IsIdempotent() { return true; }
+		//! Resumable handlers record their progress in the journal the task panel sets, so an interrupted task can go on where it stopped.
+		virtual bool IsResumable() { return false; }
 	public:
 		FileHandler& SetArg(const QString& name, QVariant value);
 		QVariant Arg(const QString& name, QVariant defaultValue = QVariant());
 		const ArgumentMap& ArgMap() const { return mArgMap; }
 		ArgumentMap& ArgMap() { return mArgMap; }
+		void SetJournal(TaskJournalPtr journal) { mJournal = journal; }
+		TaskJournalPtr Journal() const { return mJournal; }
 
 	protected:
 		ArgumentMap mArgMap;
+		TaskJournalPtr mJournal;
 	};
 
 	typedef std::shared_ptr<FileHandler> FileHandlerPtr;
@@ -239,14 +257,24 @@ namespace FFX {
 		int FileCount() { return mFileCount + mLinkFileCount; }
 		int HiddenFileCount() { return mHiddenFileCount; }
 		int HiddenDirCount() { return mHiddenDirCount; }
+		//! Apparent size, the data of hard linked files is counted once.
 		qint64 TotalSize() { return mTotalSize; }
+		//! Bytes allocated on the devices, smaller than TotalSize for sparse and compressed files.
+		qint64 AllocatedSize() { return mAllocatedSize; }
+		//! Names of files whose data was already counted under another name.
+		int HardLinkCount() { return mHardLinkCount; }
 		QDateTime OldestTime() const { return mOldestTime; }
 		QDateTime NewestTime() const { return mNewestTime; }
 
 	private:
-		void AppendFile(const QFileInfo& file);
-		void AppendLink(const QFileInfo& file);
-		void AppendDir(const QFileInfo& file);
+		void Append(const QFileInfo& file);
+		void Append(const FileSystem::FileStat& stat);
+		void AppendFile(const FileSystem::FileStat& stat);
+		void AppendLink(const FileSystem::FileStat& stat);
+		void AppendDir(const FileSystem::FileStat& stat);
+		void AppendTime(qint64 modified);
+		//! Everything below dir, from the listings without opening the entries one by one.
+		void Walk(const QString& dir);
 
 	private:
 		int mDirCount = 0;
@@ -254,7 +282,11 @@ namespace FFX {
 		int mLinkFileCount = 0;
 		int mHiddenDirCount = 0;
 		int mHiddenFileCount = 0;
+		int mHardLinkCount = 0;
 		qint64 mTotalSize = 0;
+		qint64 mAllocatedSize = 0;
+		//! (device, inode) of the files with more than one name counted so far.
+		QSet<QPair<quint64, quint64>> mLinkedFiles;
 		QDateTime mOldestTime = QDateTime::currentDateTime();
 		QDateTime mNewestTime = QDateTime::fromTime_t(0);
 	};
@@ -277,7 +309,9 @@ namespace FFX {
 
 	class FFXCORE_EXPORT FileSearchHandler : public FileHandler {
 	public:
-		FileSearchHandler(FileFilterPtr filter);
+		//! When searchArchives is set, the file entries of archives are matched by name against entryFilter, or filter if it is null,
+		//! and reported as archive-path!entry-path.
+		FileSearchHandler(FileFilterPtr filter, bool searchArchives = false, FileFilterPtr entryFilter = nullptr);
 	public:
 		virtual QFileInfoList Handle(const QFileInfoList& files, ProgressPtr progress = G_DebugProgress) override;
 		virtual std::shared_ptr<FileHandler> Clone() override;
@@ -285,8 +319,11 @@ namespace FFX {
 		virtual QString DisplayName() { return QObject::tr("FileSearchHandler"); }
 		virtual QString Description() { return QObject::tr("Search for files that meet the criteria in the specified location."); }
 		virtual void Cancel() { mCancelled = true; }
+	private:
+		void SearchArchive(const QFileInfo& root, const QFileInfo& archive, QFileInfoList& result, ProgressPtr progress);
 	private:
 		FileFilterPtr mFileFilter;
+		FileFilterPtr mEntryFilter;
 		bool mCancelled = false;
 	};
 
@@ -312,7 +349,7 @@ namespace FFX {
 
 	class FFXCORE_EXPORT FileCopyHandler : public FileHandler {
 	public:
-		FileCopyHandler(const QString& destPath, int dupMode = 0);
+		FileCopyHandler(const QString& destPath, int dupMode = 0, bool verify = false);
 	public:
 		virtual QFileInfoList Handle(const QFileInfoList& files, ProgressPtr progress = G_DebugProgress) override;
 		virtual std::shared_ptr<FileHandler> Clone() override;
@@ -320,15 +357,34 @@ namespace FFX {
 		virtual QString DisplayName() { return QObject::tr("FileCopyHandler"); }
 		virtual QString Description() { return QObject::tr("Copy files to the specified location."); }
 		virtual void Cancel() { mCancelled = true; }
+		virtual bool IsResumable() override { return true; }
 
 	private:
 		void CopyFile(const QFileInfo& file, const QString& dest, ProgressPtr progress = G_DebugProgress);
 		void CopyDir(const QFileInfo& dir, const QString& dest, ProgressPtr progress = G_DebugProgress);
+		//! Copies the file from offset on, hashing the data on the way if digest is set so the source is read only once.
+		bool CopyAndHash(const QString& source, const QString& dest, qint64 offset, QByteArray* digest, QString& error);
+		//! Reports the copies checked by the verify thread so far, on the copying thread.
+		void ReportVerified(ProgressPtr progress);
+
+	private:
+		struct Verified {
+			QFileInfo file;
+			QString source;
+			QString target;
+			bool success;
+		};
 
 	private:
 		bool mCancelled = false;
 		int mCopiedFile = 0;
 		int mTotalFile = 0;
+		//! Reads back the copies while the next files are copied, only set while handling with verify on.
+		QThreadPool* mVerifyPool = nullptr;
+		//! Guards mVerified, which the verify thread fills and the copying thread drains.
+		QMutex* mVerifiedMutex = nullptr;
+		QList<Verified> mVerified;
+		int mVerifyFailed = 0;
 	};
 
 	class FFXCORE_EXPORT FileMoveHandler : public FileHandler {
@@ -342,21 +398,33 @@ namespace FFX {
 		virtual QString DisplayName() { return QObject::tr("Move Files"); }
 		virtual QString Description() { return QObject::tr("Move files to the specified location."); }
 		virtual void Cancel() { mCancelled = true; }
+		virtual bool IsResumable() override { return true; }
 
 	private:
+		//! Same volume, the file or link is renamed.
 		void MoveFile(const QFileInfo& file, const QString& dest, ProgressPtr progress = G_DebugProgress);
+		//! Same volume, the whole directory is renamed at once unless dest exists, it is merged entry by entry then.
 		void MoveDir(const QFileInfo& dir, const QString& dest, ProgressPtr progress = G_DebugProgress);
+		//! Another volume, everything is copied first and the sources copied are deleted in one pass at the end.
+		void MoveAcross(const QFileInfo& file, const QString& dest, ProgressPtr progress = G_DebugProgress);
+		bool CopyAcross(const QFileInfo& file, const QString& dest, QString& error, ProgressPtr progress = G_DebugProgress);
+		//! By inputs, and by bytes within an input moved across volumes.
+		//! Hard linked files are copied once per name but their data is scanned once, so the copied bytes may pass the scanned ones.
+		double Percent() const { return mInputCount > 0 ? (mInputIndex + (mInputBytes > 0 ? qMin(1.0, mCopiedBytes / (double)mInputBytes) : 0)) * 100 / mInputCount : 100; }
 
 	private:
 		bool mCancelled = false;
-		int mMovedFile = 0;
-		int mTotalFile = 0;
 		int mMovedOkCount = 0;
+		int mFailedCount = 0;
+		int mInputIndex = 0;
+		int mInputCount = 0;
+		qint64 mInputBytes = 0;
+		qint64 mCopiedBytes = 0;
 	};
 
 	class FFXCORE_EXPORT FileDeleteHandler : public FileHandler {
 	public:
-		FileDeleteHandler(bool forced = false);
+		FileDeleteHandler(bool forced = false, int maxParallel = 0);
 	public:
 		virtual QFileInfoList Handle(const QFileInfoList& files, ProgressPtr progress = G_DebugProgress) override;
 		virtual std::shared_ptr<FileHandler> Clone() override;
@@ -375,6 +443,23 @@ namespace FFX {
 		int mTotalFile = 0;
 	};
 
+	//! Moves files out of the trash back to where they were trashed from, the inputs are paths in the trash.
+	class FFXCORE_EXPORT TrashRestoreHandler : public FileHandler {
+	public:
+		TrashRestoreHandler();
+	public:
+		virtual QFileInfoList Handle(const QFileInfoList& files, ProgressPtr progress = G_DebugProgress) override;
+		virtual std::shared_ptr<FileHandler> Clone() override;
+		virtual bool IsIdempotent() override { return false; }
+		virtual QString Name() { return QStringLiteral("TrashRestoreHandler"); }
+		virtual QString DisplayName() { return QObject::tr("TrashRestoreHandler"); }
+		virtual QString Description() { return QObject::tr("Restore files from the trash to their original location."); }
+		virtual void Cancel() { mCancelled = true; }
+
+	protected:
+		bool mCancelled = false;
+	};
+
 	class FFXCORE_EXPORT FileEnvelopeByDirHandler : public FileHandler {
 	public:
 		FileEnvelopeByDirHandler();
@@ -403,6 +488,139 @@ namespace FFX {
 		void ClearDir(const QFileInfo& dir, ProgressPtr progress);
 	};
 
+	class FFXCORE_EXPORT ChecksumHandler : public FileHandler {
+	public:
+		ChecksumHandler(const QString& algorithm = "SHA256", int maxParallel = 0, const QString& manifest = "", bool verify = false);
+	public:
+		virtual QFileInfoList Handle(const QFileInfoList& files, ProgressPtr progress = G_DebugProgress) override;
+		virtual std::shared_ptr<FileHandler> Clone() override;
+		virtual QString Name() { return QStringLiteral("ChecksumHandler"); }
+		virtual QString DisplayName() { return QObject::tr("ChecksumHandler"); }
+		virtual QString Description() { return QObject::tr("Compute the checksums of files, or verify files against manifests."); }
+		virtual void Cancel() { mCancelled = true; }
+
+	private:
+		QFileInfoList HashTree(const QFileInfoList& files, ProgressPtr progress);
+		QFileInfoList VerifyManifests(const QFileInfoList& files, ProgressPtr progress);
+		//! Hashes the files in parallel, hashed is called from the worker threads one at a time, with an empty digest if a file cannot be read.
+		void HashFiles(const QFileInfoList& files, Checksum::Algorithm algorithm, ProgressPtr progress, const std::function<void(int, const QByteArray&)>& hashed);
+
+	private:
+		bool mCancelled = false;
+	};
+
+	class FFXCORE_EXPORT DuplicateFinderHandler : public FileHandler {
+	public:
+		//! action is applied to every duplicate found, see DuplicateResolveHandler, "None" only reports them.
+		DuplicateFinderHandler(int minSize = 0, const QString& action = "None", int maxParallel = 0);
+	public:
+		//! Reports every duplicate with the file kept as its output, returns the duplicates.
+		virtual QFileInfoList Handle(const QFileInfoList& files, ProgressPtr progress = G_DebugProgress) override;
+		virtual std::shared_ptr<FileHandler> Clone() override;
+		virtual bool IsIdempotent() override { return mArgMap["Action"].StringValue() == "None"; }
+		virtual QString Name() { return QStringLiteral("DuplicateFinderHandler"); }
+		virtual QString DisplayName() { return QObject::tr("DuplicateFinderHandler"); }
+		virtual QString Description() { return QObject::tr("Find files with the same content."); }
+		virtual void Cancel() { mCancelled = true; }
+
+	private:
+		struct Candidate {
+			qint64 size;
+			QString path;
+		};
+		//! Regular files below the inputs, symbolic links are skipped.
+		void Walk(const QFileInfoList& files, const std::function<void(const QFileInfo&)>& visit);
+		//! Candidates [begin, end) are sorted by size and hold whole size groups.
+		void FindInBatch(const QVector<Candidate>& candidates, int begin, int end, double percent, QFileInfoList& result, ProgressPtr progress);
+		//! Runs the task for the indices on the worker threads.
+		void ForEach(const QVector<int>& indices, const std::function<void(int)>& task);
+
+	private:
+		bool mCancelled = false;
+	};
+
+	class FFXCORE_EXPORT DuplicateResolveHandler : public FileHandler {
+	public:
+		//! action is one of "Trash", "Delete", "Hardlink" and "Reflink", the duplicate is replaced by a link to its original for the last two.
+		DuplicateResolveHandler(const QString& action = "Trash");
+	public:
+		//! The original of each duplicate, duplicates without one are skipped.
+		void SetOriginals(const QHash<QString, QString>& originals) { mOriginals = originals; }
+		//! The duplicate is compared with the original byte for byte first, it is left alone if it changed since it was found.
+		static bool Resolve(const QString& action, const QString& duplicate, const QString& original, QString& error);
+
+	public:
+		virtual QFileInfoList Handle(const QFileInfoList& files, ProgressPtr progress = G_DebugProgress) override;
+		virtual std::shared_ptr<FileHandler> Clone() override;
+		virtual bool IsIdempotent() override { return false; }
+		virtual QString Name() { return QStringLiteral("DuplicateResolveHandler"); }
+		virtual QString DisplayName() { return QObject::tr("DuplicateResolveHandler"); }
+		virtual QString Description() { return QObject::tr("Delete duplicate files or replace them with links to their originals."); }
+		virtual void Cancel() { mCancelled = true; }
+
+	private:
+		QHash<QString, QString> mOriginals;
+		bool mCancelled = false;
+	};
+
+	/// <summary>
+	/// Mirrors the inputs into the destination directory like rsync: files are compared by size and modification time,
+	/// or by content with CompareHash, and only the new and changed ones are copied. Large files that changed are rebuilt
+	/// from the blocks of the old copy found by rolling checksums, only the bytes in between are taken from the source.
+	/// </summary>
+	class FFXCORE_EXPORT FileMirrorHandler : public FileHandler {
+	public:
+		FileMirrorHandler(const QString& destPath, bool compareHash = false, bool deleteExtraneous = false, int deltaMinSize = 16);
+	public:
+		//! Returns the mirrors of the inputs in the destination directory.
+		virtual QFileInfoList Handle(const QFileInfoList& files, ProgressPtr progress = G_DebugProgress) override;
+		virtual std::shared_ptr<FileHandler> Clone() override;
+		virtual bool IsIdempotent() override { return false; }
+		virtual QString Name() { return QStringLiteral("FileMirrorHandler"); }
+		virtual QString DisplayName() { return QObject::tr("Mirror Files"); }
+		virtual QString Description() { return QObject::tr("Copy the new and changed files to the specified location, so it mirrors the source."); }
+		virtual void Cancel() { mCancelled = true; }
+
+	private:
+		struct Transfer {
+			QFileInfo source;
+			QString dest;
+			//! The destination exists and may be updated block by block.
+			bool update;
+		};
+		//! Collects the transfers and the extraneous destination files of source mirrored to dest.
+		void Compare(const QFileInfo& source, const QString& dest, QList<Transfer>& transfers, QStringList& extraneous, ProgressPtr progress);
+		bool Changed(const QFileInfo& source, const QFileInfo& dest);
+		bool CopyWhole(const QFileInfo& source, const QString& dest, QString& error, ProgressPtr progress);
+		//! Rebuilds dest from the blocks it shares with source wherever they moved, transferred is the number of bytes taken from source.
+		bool CopyDelta(const QFileInfo& source, const QString& dest, qint64& transferred, QString& error, ProgressPtr progress);
+		double Percent() const { return mTotalBytes > 0 ? mDoneBytes * 100.0 / mTotalBytes : 100; }
+
+	private:
+		bool mCancelled = false;
+		int mSourceFiles = 0;
+		qint64 mSourceBytes = 0;
+		//! Bytes of the files to transfer and the part of them done.
+		qint64 mTotalBytes = 0;
+		qint64 mDoneBytes = 0;
+	};
+
+	class FFXCORE_EXPORT DiskUsageHandler : public FileHandler {
+	public:
+		DiskUsageHandler(int maxParallel = 0);
+	public:
+		//! Analyzes every directory into its DiskUsageTree cache, reported as the output of the directory.
+		virtual QFileInfoList Handle(const QFileInfoList& files, ProgressPtr progress = G_DebugProgress) override;
+		virtual std::shared_ptr<FileHandler> Clone() override;
+		virtual QString Name() { return QStringLiteral("DiskUsageHandler"); }
+		virtual QString DisplayName() { return QObject::tr("DiskUsageHandler"); }
+		virtual QString Description() { return QObject::tr("Compute the size and the file count of every directory in the trees."); }
+		virtual void Cancel() { mCancelled = true; }
+
+	private:
+		bool mCancelled = false;
+	};
+
 	class FFXCORE_EXPORT HandlerFactory {
 	public:
 		HandlerFactory();
@@ -5,6 +5,8 @@
 #include "FFXFileQuickView.h"
 #include "FFXRenameDialog.h"
 #include "FFXFilePropertyDialog.h"
+#include "FFXDuplicateFileDialog.h"
+#include "FFXDiskUsageDialog.h"
 #include "FFXFile.h"
 #include "FFXString.h"
 #include "FFXFileFilterExpr.h"
@@ -34,6 +36,8 @@
 #include <QFileIconProvider>
 #include <QDebug>
 
+#include <algorithm>
+
 #ifdef Q_OS_WIN
 #include <cstdlib>
 #include <Windows.h>
@@ -294,6 +298,10 @@ namespace FFX {
 		mMoveToTrashShortcut->setContext(Qt::WidgetShortcut);
 		connect(mMoveToTrashShortcut, &QShortcut::activated, this, &DefaultFileListView::OnActionMoveToTrash);
 
+		mUndoTrashShortcut = new QShortcut(QKeySequence::Undo, this);
+		mUndoTrashShortcut->setContext(Qt::WidgetShortcut);
+		connect(mUndoTrashShortcut, &QShortcut::activated, this, &DefaultFileListView::OnActionUndoTrash);
+
 		mInvertSelectShortcut = new QShortcut(QKeySequence("Ctrl+Alt+A"), this);
 		mInvertSelectShortcut->setContext(Qt::WidgetShortcut);
 		connect(mInvertSelectShortcut, &QShortcut::activated, this, &DefaultFileListView::OnInvertSelect);
@@ -483,6 +491,8 @@ namespace FFX {
 			if (QFileInfo(selectFiles[0]).isDir()) {
 				menu->addAction(MainWindow::Instance()->FileMainViewPtr()->FixedToQuickPanelAction());
 				menu->addAction(MainWindow::Instance()->FileMainViewPtr()->ClearFolderAction());
+				menu->addAction(MainWindow::Instance()->FileMainViewPtr()->FindDuplicatesAction());
+				menu->addAction(MainWindow::Instance()->FileMainViewPtr()->DiskUsageAction());
 				menu->addAction(MainWindow::Instance()->FileMainViewPtr()->OpenCommandPromptAction());
 			}
 			menu->addAction(MainWindow::Instance()->FileMainViewPtr()->CopyFilePathAction());
@@ -495,6 +505,7 @@ namespace FFX {
 		} else {
 			menu->addAction(MainWindow::Instance()->FileMainViewPtr()->RenameAction());
 			menu->addAction(MainWindow::Instance()->FileMainViewPtr()->EnvelopeFilesAction());
+			menu->addAction(MainWindow::Instance()->FileMainViewPtr()->FindDuplicatesAction());
 			menu->addSeparator();
 			const QList<QMenu*>& subMenus = MainWindow::Instance()->FileMainViewPtr()->ContextMenus();
 			for (QMenu* subMenu : subMenus) {
@@ -519,12 +530,31 @@ namespace FFX {
 	}
 
 	void DefaultFileListView::OnActionMoveToTrash() {
-		FFX::FileHandlerPtr handler = std::make_shared<FFX::FileDeleteHandler>();
 		QStringList files = SelectedFiles();
 		if (files.isEmpty())
 			return;
 
-		MainWindow::Instance()->TaskPanelPtr()->Submit(FileInfoList(files), std::make_shared<FFX::FileDeleteHandler>());
+		TaskPanel* taskPanel = MainWindow::Instance()->TaskPanelPtr();
+		connect(taskPanel, &TaskPanel::TaskFileHandled, this, &DefaultFileListView::OnTrashFileHandled, Qt::UniqueConnection);
+		mLastTrashed.clear();
+		mLastTrashTask = taskPanel->Submit(FileInfoList(files), std::make_shared<FFX::FileDeleteHandler>());
+	}
+
+	void DefaultFileListView::OnActionUndoTrash() {
+		if (mLastTrashed.isEmpty())
+			return;
+
+		MainWindow::Instance()->TaskPanelPtr()->Submit(FileInfoList(mLastTrashed), std::make_shared<FFX::TrashRestoreHandler>());
+		mLastTrashTask = -1;
+		mLastTrashed.clear();
+	}
+
+	void DefaultFileListView::OnTrashFileHandled(int taskId, const QFileInfo& fileInput, const QFileInfo& fileOutput, bool success, const QString& message) {
+		Q_UNUSED(fileInput)
+		Q_UNUSED(message)
+		if (taskId != mLastTrashTask || !success || fileOutput.filePath().isEmpty())
+			return;
+		mLastTrashed << fileOutput.absoluteFilePath();
 	}
 
 	void DefaultFileListView::OnInvertSelect() {
@@ -652,6 +682,204 @@ namespace FFX {
 		mSortProxyModel->Refresh();
 	}
 
+	/************************************************************************************************************************
+	 * Class： ArchiveItemModel
+	 *
+	 *
+	/************************************************************************************************************************/
+	ArchiveItemModel::ArchiveItemModel(QObject* parent)
+		: QAbstractListModel(parent) {
+	}
+
+	bool ArchiveItemModel::SetPath(const QString& path) {
+		QString archive, entry;
+		if (!ArchiveIndex::SplitPath(path, archive, entry))
+			return false;
+		ArchiveIndexPtr index = ArchiveIndex::Open(archive);
+		if (index == nullptr || !index->IsDir(entry))
+			return false;
+
+		QVector<ArchiveEntry> entries = index->Children(entry);
+		QCollator collator;
+		std::sort(entries.begin(), entries.end(), [&](const ArchiveEntry& left, const ArchiveEntry& right) {
+			if (left.dir != right.dir)
+				return left.dir;
+			return collator.compare(left.Name(), right.Name()) < 0;
+			});
+
+		beginResetModel();
+		mPath = ArchiveIndex::JoinPath(archive, entry);
+		mIndex = index;
+		mEntries = entries;
+		endResetModel();
+		return true;
+	}
+
+	QString ArchiveItemModel::VirtualPath(const QModelIndex& index) const {
+		return ArchiveIndex::JoinPath(mIndex->Archive(), Entry(index).path);
+	}
+
+	int ArchiveItemModel::rowCount(const QModelIndex& parent) const {
+		return parent.isValid() ? 0 : mEntries.size();
+	}
+
+	QVariant ArchiveItemModel::data(const QModelIndex& index, int role) const {
+		if (!index.isValid() || index.row() >= mEntries.size())
+			return QVariant();
+
+		const ArchiveEntry& entry = mEntries[index.row()];
+		if (role == Qt::DisplayRole) {
+			return entry.Name();
+		}
+		if (role == Qt::DecorationRole) {
+			QFileIconProvider fip;
+			return fip.icon(entry.dir ? QFileIconProvider::Folder : QFileIconProvider::File);
+		}
+		if (role == Qt::ToolTipRole) {
+			QString tip = entry.lastModified.toString("yyyy-MM-dd hh:mm:ss");
+			if (!entry.dir) {
+				tip = QString("%1 \t %2").arg(tip).arg(String::BytesHint(entry.size));
+			}
+			return tip;
+		}
+		return QVariant();
+	}
+
+	/************************************************************************************************************************
+	 * Class： ArchiveListView
+	 *
+	 *
+	/************************************************************************************************************************/
+	ArchiveListView::ArchiveListView(QWidget* parent)
+		: QListView(parent) {
+		mModel = new ArchiveItemModel(this);
+		setModel(mModel);
+		setEditTriggers(QAbstractItemView::NoEditTriggers);
+		setSelectionMode(QAbstractItemView::ExtendedSelection);
+		setSelectionRectVisible(true);
+		setIconSize(QSize(32, 32));
+		setSpacing(2);
+
+		connect(this, &QListView::doubleClicked, this, &ArchiveListView::OnItemDoubleClicked);
+
+		mCollectFilesShortcut = new QShortcut(QKeySequence("Ctrl+C"), this);
+		mCollectFilesShortcut->setContext(Qt::WidgetShortcut);
+		connect(mCollectFilesShortcut, &QShortcut::activated, this, &ArchiveListView::OnCollectFiles);
+		connect(this, &ArchiveListView::OpenFileReady, this, &ArchiveListView::OnOpenFileReady);
+		connect(this, &ArchiveListView::CollectFilesReady, this, &ArchiveListView::OnCollectFilesReady);
+
+		mExtractPool.setMaxThreadCount(1);
+		mPreviewPool.setMaxThreadCount(1);
+		mPreviewPool.start([]() { ArchiveIndex::PruneCache(); });
+	}
+
+	ArchiveListView::~ArchiveListView() {
+		mPreviewPool.clear();
+		mPreviewPool.waitForDone();
+		mExtractPool.clear();
+		mExtractPool.waitForDone();
+	}
+
+	bool ArchiveListView::SetPath(const QString& path) {
+		if (!mModel->SetPath(path))
+			return false;
+		clearSelection();
+		return true;
+	}
+
+	QStringList ArchiveListView::SelectedEntries() {
+		QStringList entries;
+		for (const QModelIndex& index : selectionModel()->selectedIndexes()) {
+			entries << mModel->VirtualPath(index);
+		}
+		return entries;
+	}
+
+	void ArchiveListView::RequestPreviewFile(const QString& path) {
+		static const quint64 MaxPreviewSize = 64 << 20;
+		//! The entries selected while one is extracted are skipped, only the last one matters.
+		mPreviewPool.clear();
+		mPreviewPool.start([this, path]() {
+			QString archive, entry, file;
+			if (ArchiveIndex::SplitPath(path, archive, entry)) {
+				ArchiveIndexPtr index = ArchiveIndex::Open(archive);
+				const ArchiveEntry* e = index == nullptr ? nullptr : index->Entry(entry);
+				if (e != nullptr && !e->dir && e->size <= MaxPreviewSize)
+					file = index->Materialize(entry);
+			}
+			emit PreviewFileReady(path, file);
+			});
+	}
+
+	void ArchiveListView::OnItemDoubleClicked(const QModelIndex& index) {
+		const ArchiveEntry& entry = mModel->Entry(index);
+		if (entry.dir) {
+			emit DirDoubleClicked(mModel->VirtualPath(index));
+			return;
+		}
+
+		//! Large entries take a while to extract, the file is opened when it is ready.
+		ArchiveIndexPtr archive = mModel->Index();
+		QString path = entry.path;
+		mExtractPool.start([this, archive, path]() {
+			QString error;
+			QString file = archive->Materialize(path, &error);
+			if (file.isEmpty() && error.isEmpty())
+				error = QObject::tr("Cannot extract %1.").arg(path);
+			emit OpenFileReady(path, file, error);
+			});
+	}
+
+	void ArchiveListView::OnOpenFileReady(const QString& entry, const QString& file, const QString& error) {
+		if (file.isEmpty()) {
+			QMessageBox::warning(this, QObject::tr("Warning"), QObject::tr("Extract %1 failed:%2").arg(entry.section('/', -1)).arg(error));
+			return;
+		}
+		QDesktopServices::openUrl(QUrl::fromLocalFile(file));
+	}
+
+	void ArchiveListView::OnCollectFiles() {
+		QModelIndexList selection = selectionModel()->selectedIndexes();
+		if (selection.isEmpty())
+			return;
+
+		//! Only the selected entries are extracted, the copies in the cache directory are put on the clipboard when they are ready.
+		ArchiveIndexPtr archive = mModel->Index();
+		QStringList paths;
+		for (const QModelIndex& index : selection) {
+			paths << mModel->Entry(index).path;
+		}
+		mExtractPool.start([this, archive, paths]() {
+			QStringList files;
+			QString error;
+			for (const QString& path : paths) {
+				QString file = archive->Materialize(path, &error);
+				if (file.isEmpty()) {
+					if (error.isEmpty())
+						error = QObject::tr("Cannot extract %1.").arg(path);
+					break;
+				}
+				files << file;
+			}
+			emit CollectFilesReady(files, error);
+			});
+	}
+
+	void ArchiveListView::OnCollectFilesReady(const QStringList& files, const QString& error) {
+		if (!error.isEmpty()) {
+			QMessageBox::warning(this, QObject::tr("Warning"), QObject::tr("Extract files failed:%1").arg(error));
+			return;
+		}
+
+		QList<QUrl> urls;
+		for (const QString& file : files) {
+			urls << QUrl::fromLocalFile(file);
+		}
+		QMimeData* mimeData = new QMimeData;
+		mimeData->setUrls(urls);
+		QApplication::clipboard()->setMimeData(mimeData);
+	}
+
 	PathEditWidget::PathEditWidget(QWidget* parent)
 		: QLineEdit(parent) {
 
@@ -715,7 +943,7 @@ namespace FFX {
 	void DefaultFileListViewNavigator::Goto(const QString& path) {
 		if (path == mCurrentPath)
 			return;
-		if (!QFileInfo::exists(path)) {
+		if (!QFileInfo::exists(path) && !ArchiveIndex::IsVirtualPath(path)) {
 			QMessageBox::warning(this, QObject::tr("Warning"), QObject::tr("Invalid directory path."));
 			return;
 		}
@@ -748,6 +976,10 @@ namespace FFX {
 
 	void DefaultFileListViewNavigator::OnUpward() {
 		QString root = mCurrentPath;
+		if (ArchiveIndex::IsVirtualPath(root)) {
+			Goto(ArchiveIndex::ParentPath(root));
+			return;
+		}
 		QDir dir(root);
 		if (dir.cdUp()) {
 			Goto(dir.absolutePath());
@@ -780,6 +1012,8 @@ namespace FFX {
 
 		mFileViewNavigator = new DefaultFileListViewNavigator;
 		mFileListView = new DefaultFileListView;
+		mArchiveListView = new ArchiveListView;
+		mArchiveListView->setVisible(false);
 		mFileQuickView = new FileQuickView;
 		mClipboardPanel = new ClipboardPanel;
 
@@ -795,6 +1029,8 @@ namespace FFX {
 		mMoveFilesAction = new QAction(QIcon(":/ffx/res/image/move-files.svg"), QObject::tr("Move Files Here"));
 		mEnvelopeFilesAction = new QAction(QIcon(":/ffx/res/image/file-envelope.svg"), QObject::tr("Envelope Files By Folder"));
 		mClearFolderAction = new QAction(QIcon(":/ffx/res/image/clear-folders.svg"), QObject::tr("Clear Folder"));
+		mFindDuplicatesAction = new QAction(QIcon(":/ffx/res/image/file-duplicate.svg"), QObject::tr("Find Duplicates"));
+		mDiskUsageAction = new QAction(QIcon(":/ffx/res/image/stat-file.svg"), QObject::tr("Disk Usage"));
 		mFixedToQuickPanelAction = new QAction(QIcon(":/ffx/res/image/pin.svg"), QObject::tr("Fix in Quick Panel"));
 		mRenameAction = new QAction(QIcon(":/ffx/res/image/edit.svg"), QObject::tr("Rename"));
 		mPropertyAction = new QAction(QIcon(":/ffx/res/image/file-prop.svg"), QObject::tr("Property"));
@@ -809,6 +1045,7 @@ namespace FFX {
 		rightWidgetLayout->setMargin(0);
 		rightWidgetLayout->addWidget(mFileViewNavigator);
 		rightWidgetLayout->addWidget(mFileListView);
+		rightWidgetLayout->addWidget(mArchiveListView);
 
 		splitter->addWidget(mFileQuickView);
 		splitter->addWidget(rightWidget);
@@ -871,12 +1108,25 @@ namespace FFX {
 
 		connect(mFixedToQuickPanelAction, &QAction::triggered, this, &FileMainView::OnFixedToQuickPanel);
 		connect(mFileViewNavigator, &DefaultFileListViewNavigator::RootPathChanged, this, [=](const QString& path) {
-			mFileListView->SetRootPath(path);
+			bool inArchive = ArchiveIndex::IsVirtualPath(path);
+			if (inArchive) {
+				QApplication::setOverrideCursor(Qt::WaitCursor);
+				inArchive = mArchiveListView->SetPath(path);
+				QApplication::restoreOverrideCursor();
+				if (!inArchive) {
+					QMessageBox::warning(this, QObject::tr("Warning"), QObject::tr("Cannot open archive %1.").arg(path));
+				}
+			} else {
+				mFileListView->SetRootPath(path);
+			}
+			mArchiveListView->setVisible(inArchive);
+			mFileListView->setVisible(!inArchive);
 			emit CurrentPathChanged(path); // Transfer the signals for 
 			});
 		connect(mFileQuickView->QuickNaviPanelPtr(), &QuickNavigatePanel::RootPathChanged, this, &FileMainView::OnRootPathChanged);
 		connect(mFileQuickView->FileTreeNaviPanelPtr(), &FileTreeNavigatePanel::RootPathChanged, this, &FileMainView::OnRootPathChanged);
 		connect(mFileListView, &DefaultFileListView::FileDoubleClicked, this, &FileMainView::OnFileDoubleClicked);
+		connect(mArchiveListView, &ArchiveListView::DirDoubleClicked, this, &FileMainView::Goto);
 
 		connect(mMakeDirAction, &QAction::triggered, mFileListView, &DefaultFileListView::MakeDirAndEdit);
 		connect(mMakeFileAction, &QAction::triggered, mFileListView, [=]() { mFileListView->MakeFileAndEdit(""); });
@@ -887,9 +1137,30 @@ namespace FFX {
 		connect(mRefreshAction, &QAction::triggered, mFileListView, &DefaultFileListView::Refresh);
 
 		connect(mFileListView->selectionModel(), &QItemSelectionModel::selectionChanged, this, [=]() { emit SelectionChanged(mFileListView->SelectedFiles()); });
+		connect(this, &FileMainView::SelectionChanged, mFileQuickView->PreviewPanelPtr(), [=](QStringList files) {
+			mFileQuickView->PreviewPanelPtr()->SetFile(files.size() == 1 ? files[0] : QString());
+			});
+		connect(mArchiveListView->selectionModel(), &QItemSelectionModel::selectionChanged, this, [=]() {
+			//! Nothing is extracted unless a provider can preview the entry.
+			QStringList entries = mArchiveListView->SelectedEntries();
+			if (entries.size() != 1 || !mFileQuickView->PreviewPanelPtr()->Accept(QFileInfo(entries[0]))) {
+				mFileQuickView->PreviewPanelPtr()->SetFile(QString());
+				return;
+			}
+			mArchiveListView->RequestPreviewFile(entries[0]);
+			});
+		connect(mArchiveListView, &ArchiveListView::PreviewFileReady, this, [=](const QString& entry, const QString& file) {
+			//! The selection may have moved on while the entry was extracted.
+			QStringList entries = mArchiveListView->SelectedEntries();
+			if (entries.size() == 1 && entries[0] == entry) {
+				mFileQuickView->PreviewPanelPtr()->SetFile(file);
+			}
+			});
 		
 		connect(mEnvelopeFilesAction, &QAction::triggered, this, &FileMainView::OnEnvelopeFiles);
 		connect(mClearFolderAction, &QAction::triggered, this, &FileMainView::OnClearFolder);
+		connect(mFindDuplicatesAction, &QAction::triggered, this, &FileMainView::OnFindDuplicates);
+		connect(mDiskUsageAction, &QAction::triggered, this, &FileMainView::OnDiskUsage);
 		connect(mRenameAction, &QAction::triggered, this, &FileMainView::OnRename);
 		connect(mPropertyAction, &QAction::triggered, this, &FileMainView::OnFileProperty);
 		connect(mCopyFilePathAction, &QAction::triggered, this, &FileMainView::OnCopyFilePath);
@@ -957,6 +1228,8 @@ namespace FFX {
 	void FileMainView::OnFileDoubleClicked(const QFileInfo& file) {
 		if (file.isDir()) {
 			Goto(file.absoluteFilePath());
+		} else if (ArchiveIndex::IsArchive(file)) {
+			Goto(ArchiveIndex::JoinPath(file.absoluteFilePath(), QString()));
 		} else if (file.isFile()) {
 			QDesktopServices::openUrl(QUrl::fromLocalFile(file.absoluteFilePath()));
 		}
@@ -993,6 +1266,23 @@ namespace FFX {
 		MainWindow::Instance()->TaskPanelPtr()->Submit(FileInfoList(selectedFiles), std::make_shared<ClearFolderHandler>());
 	}
 
+	void FileMainView::OnFindDuplicates() {
+		QFileInfoList files = FileInfoList(mFileListView->SelectedFiles());
+		if (files.isEmpty())
+			files = FileInfoList(mFileListView->CurrentDir());
+		DuplicateFileDialog dialog(files);
+		dialog.exec();
+	}
+
+	void FileMainView::OnDiskUsage() {
+		QStringList selectedFiles = mFileListView->SelectedFiles();
+		QFileInfo dir(selectedFiles.size() == 1 ? selectedFiles[0] : mFileListView->CurrentDir());
+		if (!dir.isDir())
+			return;
+		DiskUsageDialog dialog(dir);
+		dialog.exec();
+	}
+
 	void FileMainView::OnRename() {
 		QStringList selectedFiles = mFileListView->SelectedFiles();
 		RenameDialog dialog(selectedFiles);
@@ -2,6 +2,7 @@
 #include "FFXCore.h"
 #include "FFXFileFilter.h"
 #include "FFXAppConfig.h"
+#include "FFXArchive.h"
 
 #include <QListView>
 #include <QUndoCommand>
@@ -10,6 +11,8 @@
 #include <QStyledItemDelegate>
 #include <QSortFilterProxyModel>
 #include <QLineEdit>
+#include <QAbstractListModel>
+#include <QThreadPool>
 
 class QShortcut;
 class QToolButton;
@@ -131,6 +134,8 @@ namespace FFX {
 		virtual void OnCustomContextMenuRequested(const QPoint& pos);
 		void OnActionDelete();
 		void OnActionMoveToTrash();
+		void OnActionUndoTrash();
+		void OnTrashFileHandled(int taskId, const QFileInfo& fileInput, const QFileInfo& fileOutput, bool success, const QString& message);
 		void OnInvertSelect();
 		void OnCollectFiles();
 		void OnAppendCollectFiles();
@@ -143,9 +148,13 @@ namespace FFX {
 		DefaultFileListViewModel* mFileModel;
 		DefaultSortProxyModel* mSortProxyModel;
 		bool mEditing = false;
+		//! The last move to trash and the paths in the trash of its files, undone as a whole.
+		int mLastTrashTask = -1;
+		QStringList mLastTrashed;
 		//! Shortcut
 		QShortcut* mDeleteForceShortcut;
 		QShortcut* mMoveToTrashShortcut;
+		QShortcut* mUndoTrashShortcut;
 		QShortcut* mInvertSelectShortcut;
 		QShortcut* mPasteFilesShortcut;
 		QShortcut* mOverwritePasteFilesShortcut;
@@ -156,6 +165,69 @@ namespace FFX {
 		//! Actions
 	};
 
+	/// <summary>
+	/// Lists the entries of one directory inside an archive, directories first.
+	/// </summary>
+	class ArchiveItemModel : public QAbstractListModel {
+		Q_OBJECT
+	public:
+		ArchiveItemModel(QObject* parent = nullptr);
+
+	public:
+		bool SetPath(const QString& path);
+		QString Path() const { return mPath; }
+		ArchiveIndexPtr Index() const { return mIndex; }
+		const ArchiveEntry& Entry(const QModelIndex& index) const { return mEntries[index.row()]; }
+		QString VirtualPath(const QModelIndex& index) const;
+
+	public:
+		virtual int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+		virtual QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+	private:
+		QString mPath;
+		ArchiveIndexPtr mIndex;
+		QVector<ArchiveEntry> mEntries;
+	};
+
+	/// <summary>
+	/// Shows an archive as a directory. Nothing is extracted to browse it, entries are extracted to the
+	/// cache directory of the archive only when they are opened, previewed or copied out.
+	/// </summary>
+	class ArchiveListView : public QListView {
+		Q_OBJECT
+	public:
+		ArchiveListView(QWidget* parent = nullptr);
+		~ArchiveListView();
+
+	public:
+		bool SetPath(const QString& path);
+		QString CurrentPath() const { return mModel->Path(); }
+		QStringList SelectedEntries();
+		//! Extracts a file entry small enough to be previewed on a worker, PreviewFileReady is emitted with its local copy.
+		void RequestPreviewFile(const QString& entry);
+
+	private slots:
+		void OnItemDoubleClicked(const QModelIndex& index);
+		void OnCollectFiles();
+		void OnOpenFileReady(const QString& entry, const QString& file, const QString& error);
+		void OnCollectFilesReady(const QStringList& files, const QString& error);
+
+	Q_SIGNALS:
+		void DirDoubleClicked(const QString& path);
+		void PreviewFileReady(const QString& entry, const QString& file);
+		void OpenFileReady(const QString& entry, const QString& file, const QString& error);
+		void CollectFilesReady(const QStringList& files, const QString& error);
+
+	private:
+		ArchiveItemModel* mModel;
+		QShortcut* mCollectFilesShortcut;
+		//! One entry is extracted for preview at a time, the requests queued behind it are replaced by the latest one.
+		QThreadPool mPreviewPool;
+		//! Entries opened or copied are extracted here in the order they were requested.
+		QThreadPool mExtractPool;
+	};
+
 	class PathEditWidget : public QLineEdit {
 		Q_OBJECT
 	public:
@@ -248,6 +320,8 @@ namespace FFX {
 		QAction* RefreshAction() { return mRefreshAction; }
 		QAction* EnvelopeFilesAction() { return mEnvelopeFilesAction; }
 		QAction* ClearFolderAction() { return mClearFolderAction; }
+		QAction* FindDuplicatesAction() { return mFindDuplicatesAction; }
+		QAction* DiskUsageAction() { return mDiskUsageAction; }
 		QAction* RenameAction() { return mRenameAction; }
 		QAction* PropertyAction() { return mPropertyAction; }
 		QAction* CopyFilePathAction() { return mCopyFilePathAction; }
@@ -263,6 +337,8 @@ namespace FFX {
 		void OnFixedToQuickPanel();
 		void OnEnvelopeFiles();
 		void OnClearFolder();
+		void OnFindDuplicates();
+		void OnDiskUsage();
 		void OnRename();
 		void OnFileProperty();
 		void OnCopyFilePath();
@@ -279,6 +355,7 @@ namespace FFX {
 	private:
 		DefaultFileListViewNavigator* mFileViewNavigator;
 		DefaultFileListView* mFileListView;
+		ArchiveListView* mArchiveListView;
 		FileQuickView* mFileQuickView;
 		ClipboardPanel* mClipboardPanel;
 		QVBoxLayout* mMainLayout;
@@ -304,6 +381,8 @@ namespace FFX {
 		
 		QAction* mEnvelopeFilesAction;
 		QAction* mClearFolderAction;
+		QAction* mFindDuplicatesAction;
+		QAction* mDiskUsageAction;
 		QAction* mRenameAction;
 		QAction* mPropertyAction;
 		QAction* mCopyFilePathAction;
@@ -3,6 +3,8 @@
 #include "FFXMainWindow.h"
 #include "FFXFile.h"
 #include "FFXString.h"
+#include "FFXDiskUsage.h"
+#include "FFXFileSystem.h"
 
 #include <QLabel>
 #include <QGridLayout>
@@ -13,6 +15,10 @@
 #include <QTabWidget>
 #include <QTableWidget>
 #include <QLineEdit>
+#include <QHeaderView>
+#include <QVBoxLayout>
+
+#include <algorithm>
 
 namespace FFX {
 	FileBasicPropertyWidget::FileBasicPropertyWidget(QWidget* parent)
@@ -80,6 +86,35 @@ namespace FFX {
 
 	void FileSizeDetailPropertyWidget::SetupUi() {
 		mFileSizeTable = new QTableWidget;
+		mFileSizeTable->setColumnCount(3);
+		mFileSizeTable->setHorizontalHeaderLabels(QStringList() << QObject::tr("Directory") << QObject::tr("Size") << QObject::tr("Files"));
+		mFileSizeTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+		mFileSizeTable->horizontalHeader()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
+		mFileSizeTable->horizontalHeader()->setSectionResizeMode(2, QHeaderView::ResizeToContents);
+		mFileSizeTable->verticalHeader()->setVisible(false);
+		mFileSizeTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+		QVBoxLayout* layout = new QVBoxLayout;
+		layout->addWidget(mFileSizeTable);
+		setLayout(layout);
+	}
+
+	void FileSizeDetailPropertyWidget::SetTree(const DiskUsageTree& tree) {
+		mFileSizeTable->setRowCount(0);
+		if (tree.IsEmpty())
+			return;
+		const DiskUsageNode& root = tree.Node(0);
+		QVector<int> children;
+		for (int i = root.firstChild; i < root.firstChild + root.childCount; i++)
+			children << i;
+		std::sort(children.begin(), children.end(), [&tree](int a, int b) { return tree.Node(a).size > tree.Node(b).size; });
+		mFileSizeTable->setRowCount(children.size());
+		for (int row = 0; row < children.size(); row++) {
+			const DiskUsageNode& node = tree.Node(children[row]);
+			mFileSizeTable->setItem(row, 0, new QTableWidgetItem(node.name));
+			mFileSizeTable->setItem(row, 1, new QTableWidgetItem(String::BytesHint(node.size)));
+			mFileSizeTable->setItem(row, 2, new QTableWidgetItem(QString::number(node.files)));
+		}
 	}
 
 	FilePropertyDialog::FilePropertyDialog(QFileInfoList files, QWidget *parent)
@@ -92,6 +127,13 @@ namespace FFX {
 		} else {
 			mFileBasicPropertyWidget->SetLinkInfoVisible(false);
 		}
+		//! The sizes of the subdirectories are there only once the directory has been analyzed.
+		DiskUsageTree tree;
+		if (files.size() == 1 && files[0].isDir() && tree.Load(DiskUsageTree::CachePath(files[0].absoluteFilePath()))) {
+			mFileSizeDetailPropertyWidget = new FileSizeDetailPropertyWidget;
+			mFileSizeDetailPropertyWidget->SetTree(tree);
+			mTabWidget->addTab(mFileSizeDetailPropertyWidget, QObject::tr("Size Detail"));
+		}
 		mTaskId = MainWindow::Instance()->TaskPanelPtr()->Submit(files, std::make_shared<FileSearchHandler>(FileFilterPtr(new EmptyFilter())), false);
 	}
 
@@ -150,21 +192,32 @@ namespace FFX {
 		if (taskId != mTaskId)
 			return;
 
-		if (fileOutput.isDir()) {
+		//! Links are sized themselves, not by their targets, and the data of hard linked files is counted once.
+		FileSystem::FileStat stat;
+		bool sized = FileSystem::Stat(fileOutput.absoluteFilePath(), stat);
+		if (fileOutput.isSymLink()) {
+			mFileCount++;
+			if (sized) {
+				mTotalSize += stat.size;
+				mAllocatedSize += stat.allocated;
+			}
+		}
+		else if (fileOutput.isDir()) {
 			mDirCount++;
 			if (fileOutput.isHidden())
 				mHiddenDirCount++;
 		}
 		else if (fileOutput.isFile()) {
 			mFileCount++;
-			mTotalSize += fileOutput.size();
+			if (sized && (stat.links <= 1 || !mLinkedFiles.contains(qMakePair(stat.device, stat.inode)))) {
+				if (stat.links > 1)
+					mLinkedFiles.insert(qMakePair(stat.device, stat.inode));
+				mTotalSize += stat.size;
+				mAllocatedSize += stat.allocated;
+			}
 			if (fileOutput.isHidden())
 				mHiddenFileCount++;
 		}
-		else if (fileOutput.isSymLink()) {
-			mFileCount++;
-			mTotalSize = SymbolLinkSize(fileOutput);
-		}
 
 		//mHiddenDirCount += handler.HiddenDirCount();
 		//mHiddenFileCount += handler.HiddenFileCount();
@@ -197,7 +250,7 @@ namespace FFX {
 			mFileBasicPropertyWidget->mHiddenCheckBox->setCheckState(Qt::PartiallyChecked);
 		mFileBasicPropertyWidget->mDateInfoLabel->setText(dateStr);
 		mFileBasicPropertyWidget->mCountInfoLabel->setText(QObject::tr("%1 files %2 directories").arg(mFileCount).arg(mDirCount));
-		mFileBasicPropertyWidget->mTotalSizeInfoLabel->setText(QString("%1 (%2 Bytes)").arg(String::BytesHint(mTotalSize)).arg(mTotalSize));
+		mFileBasicPropertyWidget->mTotalSizeInfoLabel->setText(QObject::tr("%1 (%2 Bytes), %3 on disk").arg(String::BytesHint(mTotalSize)).arg(mTotalSize).arg(String::BytesHint(mAllocatedSize)));
 	}
 }
 
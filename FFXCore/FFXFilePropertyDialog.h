@@ -3,6 +3,8 @@
 #include <QDialog>
 #include <QFileInfo>
 #include <QDateTime>
+#include <QSet>
+#include <QPair>
 
 class QLabel;
 class QFrame;
@@ -15,6 +17,8 @@ class QLineEdit;
 class QHBoxLayout;
 
 namespace FFX {
+	class DiskUsageTree;
+
 	class FileBasicPropertyWidget : public QWidget {
 		Q_OBJECT
 
@@ -52,6 +56,10 @@ namespace FFX {
 		FileSizeDetailPropertyWidget(QWidget* parent = nullptr);
 		friend class FilePropertyDialog;
 
+	public:
+		//! Lists the subdirectories of the root of the tree, largest first.
+		void SetTree(const DiskUsageTree& tree);
+
 	private:
 		void SetupUi();
 
@@ -77,6 +85,7 @@ namespace FFX {
 	private:
 		QTabWidget* mTabWidget;
 		FileBasicPropertyWidget* mFileBasicPropertyWidget;
+		FileSizeDetailPropertyWidget* mFileSizeDetailPropertyWidget = nullptr;
 		QToolButton* mOkButton;
 		QToolButton* mCancelButton;
 		QGridLayout* mMainLayout;
@@ -89,6 +98,9 @@ namespace FFX {
 		int mHiddenFileCount = 0;
 		int mReadonlyFileCount = 0;
 		qint64 mTotalSize = 0;
+		qint64 mAllocatedSize = 0;
+		//! (device, inode) of the files with more than one name counted so far.
+		QSet<QPair<quint64, quint64>> mLinkedFiles;
 		QDateTime mOldestTime = QDateTime::currentDateTime();
 		QDateTime mNewestTime = QDateTime::fromTime_t(0);
 	};
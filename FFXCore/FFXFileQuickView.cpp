@@ -11,6 +11,7 @@
 #include <QSizePolicy>
 #include <QShortcut>
 #include <QMenu>
+#include <QPixmap>
 #include <QDebug>
 
 namespace FFX {
@@ -26,6 +27,10 @@ namespace FFX {
         mMainLayout->addWidget(bn);
     }
 
+    void FileQuickViewHeader::SetTitle(const QString& title) {
+        mHeaderLabel->setText(title);
+    }
+
     void FileQuickViewHeader::SetupUi() {
         mHeaderLabel = new QLabel(QObject::tr("Quick Panel"));
         mHeaderLabel->setFixedHeight(32);
@@ -208,6 +213,76 @@ namespace FFX {
         emit RootPathChanged(currentFileInfo);
     }
 
+    FilePreviewPanel::FilePreviewPanel(QWidget* parent)
+        : QWidget(parent) {
+        SetupUi();
+    }
+
+    void FilePreviewPanel::SetupUi() {
+        mHeader = new FileQuickViewHeader;
+        mHeader->SetTitle(QObject::tr("Preview"));
+        mPreviewLabel = new QLabel;
+        mPreviewLabel->setAlignment(Qt::AlignCenter);
+        mPreviewLabel->setMinimumHeight(mPreviewSize.height() / 2);
+        mMainLayout = new QVBoxLayout;
+        mMainLayout->setContentsMargins(0, 0, 0, 0);
+        mMainLayout->addWidget(mHeader);
+        mMainLayout->addWidget(mPreviewLabel, 1);
+        setLayout(mMainLayout);
+        //! Hide the panel until a provider accepts the current file.
+        setVisible(false);
+    }
+
+    void FilePreviewPanel::AddProvider(FilePreviewProvider* provider) {
+        if (provider == nullptr || mProviders.contains(provider))
+            return;
+        mProviders << provider;
+        connect(provider, &FilePreviewProvider::PreviewReady, this, &FilePreviewPanel::OnPreviewReady);
+    }
+
+    void FilePreviewPanel::RemoveProvider(FilePreviewProvider* provider) {
+        if (!mProviders.removeOne(provider))
+            return;
+        disconnect(provider, &FilePreviewProvider::PreviewReady, this, &FilePreviewPanel::OnPreviewReady);
+    }
+
+    bool FilePreviewPanel::Accept(const QFileInfo& file) const {
+        for (FilePreviewProvider* provider : mProviders) {
+            if (provider->Accept(file))
+                return true;
+        }
+        return false;
+    }
+
+    void FilePreviewPanel::SetFile(const QString& file) {
+        if (file == mCurrentFile)
+            return;
+        mCurrentFile = file;
+        mPreviewLabel->clear();
+
+        QFileInfo fileInfo(file);
+        if (file.isEmpty() || !fileInfo.isFile()) {
+            setVisible(false);
+            return;
+        }
+
+        for (FilePreviewProvider* provider : mProviders) {
+            if (provider->Accept(fileInfo)) {
+                setVisible(true);
+                provider->Request(fileInfo, mPreviewSize);
+                return;
+            }
+        }
+        setVisible(false);
+    }
+
+    void FilePreviewPanel::OnPreviewReady(const QString& file, const QImage& image) {
+        //! The result of a previous selection, ignore it.
+        if (QFileInfo(file) != QFileInfo(mCurrentFile))
+            return;
+        mPreviewLabel->setPixmap(QPixmap::fromImage(image));
+    }
+
 	FileQuickView::FileQuickView(QWidget* parent)
 		: QWidget(parent) {
         SetupUi();
@@ -231,6 +306,7 @@ namespace FFX {
     void FileQuickView::SetupUi() {
         mQuickNaviPanel = new QuickNavigatePanel;
         mFileTreeNavigatePanel = new FileTreeNavigatePanel;
+        mFilePreviewPanel = new FilePreviewPanel;
         mMainLayout = new QVBoxLayout;
 
         mMainLayout->setContentsMargins(0, 0, 0, 0);
@@ -240,6 +316,7 @@ namespace FFX {
         //line->setFrameShadow(QFrame::Sunken);
         //mMainLayout->addWidget(line);
         mMainLayout->addWidget(mFileTreeNavigatePanel, 5);
+        mMainLayout->addWidget(mFilePreviewPanel, 3);
         //mMainLayout->setSpacing(9);
         setLayout(mMainLayout);
 
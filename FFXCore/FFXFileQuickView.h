@@ -1,4 +1,5 @@
 #pragma once
+#include "FFXCore.h"
 
 #include <QWidget>
 #include <QFrame>
@@ -6,6 +7,7 @@
 #include <QTreeView>
 #include <QFileSystemModel>
 #include <QPair>
+#include <QImage>
 
 class QHBoxLayout;
 class QVBoxLayout;
@@ -25,6 +27,7 @@ namespace FFX {
 
 	public:
 		void AddAction(QAction* action);
+		void SetTitle(const QString& title);
 
 	protected:
 		virtual void paintEvent(QPaintEvent* event) override;
@@ -105,6 +108,54 @@ namespace FFX {
 		void RootPathChanged(const QFileInfo& file);
 	};
 
+	/// <summary>
+	/// Provides preview images of files for the FilePreviewPanel, such as the thumbnail of the first page of a PDF.
+	/// Request must not block, the provider emits PreviewReady when the image is ready.
+	/// Accept is decided from the file name only, so entries not extracted from an archive yet can be checked.
+	/// </summary>
+	class FFXCORE_EXPORT FilePreviewProvider : public QObject {
+		Q_OBJECT
+	public:
+		FilePreviewProvider(QObject* parent = nullptr) : QObject(parent) {}
+		virtual ~FilePreviewProvider() = default;
+
+	public:
+		virtual bool Accept(const QFileInfo& file) = 0;
+		virtual void Request(const QFileInfo& file, const QSize& size) = 0;
+
+	Q_SIGNALS:
+		void PreviewReady(const QString& file, const QImage& image);
+	};
+
+	class FFXCORE_EXPORT FilePreviewPanel : public QWidget {
+		Q_OBJECT
+	public:
+		FilePreviewPanel(QWidget* parent = nullptr);
+
+	public:
+		void AddProvider(FilePreviewProvider* provider);
+		void RemoveProvider(FilePreviewProvider* provider);
+		//! A provider can preview this kind of file.
+		bool Accept(const QFileInfo& file) const;
+
+	public slots:
+		void SetFile(const QString& file);
+
+	private:
+		void SetupUi();
+
+	private slots:
+		void OnPreviewReady(const QString& file, const QImage& image);
+
+	private:
+		FileQuickViewHeader* mHeader;
+		QLabel* mPreviewLabel;
+		QVBoxLayout* mMainLayout;
+		QList<FilePreviewProvider*> mProviders;
+		QString mCurrentFile;
+		QSize mPreviewSize = QSize(256, 256);
+	};
+
 	class FileQuickView : public QWidget {
 		Q_OBJECT
 
@@ -115,6 +166,7 @@ namespace FFX {
 	public:
 		QuickNavigatePanel* QuickNaviPanelPtr() { return mQuickNaviPanel; }
 		FileTreeNavigatePanel* FileTreeNaviPanelPtr() { return mFileTreeNavigatePanel; }
+		FilePreviewPanel* PreviewPanelPtr() { return mFilePreviewPanel; }
 
 	protected:
 		// virtual void paintEvent(QPaintEvent* event) override;
@@ -125,6 +177,7 @@ namespace FFX {
 	private:
 		QuickNavigatePanel* mQuickNaviPanel;
 		FileTreeNavigatePanel* mFileTreeNavigatePanel;
+		FilePreviewPanel* mFilePreviewPanel;
 		QVBoxLayout* mMainLayout;
 	};
 
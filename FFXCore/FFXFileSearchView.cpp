@@ -50,11 +50,19 @@ namespace FFX {
 		mSearchCaseButton->setFixedSize(QSize(32, 32));
 		mSearchCaseButton->setCheckable(true);
 		mSearchCaseButton->setChecked(true);
+		mSearchArchiveButton = new QToolButton;
+		mSearchArchiveButton->setIcon(QIcon(":/ffx/res/image/search-archive.svg"));
+		mSearchArchiveButton->setIconSize(QSize(20, 20));
+		mSearchArchiveButton->setFixedSize(QSize(32, 32));
+		mSearchArchiveButton->setToolTip(QObject::tr("Search in archives"));
+		mSearchArchiveButton->setCheckable(true);
+		mSearchArchiveButton->setChecked(false);
 		mMainLayout = new QGridLayout;
 		mMainLayout->addWidget(mSearchEdit, 0, 0, 1, 1);
 		mMainLayout->addWidget(mSearchFileOnlyButton, 0, 1, 1, 1);
 		mMainLayout->addWidget(mSearchCaseButton, 0, 2, 1, 1);
-		mMainLayout->addWidget(mSearchFileListView, 1, 0, 1, 3);
+		mMainLayout->addWidget(mSearchArchiveButton, 0, 3, 1, 1);
+		mMainLayout->addWidget(mSearchFileListView, 1, 0, 1, 4);
 		mMainLayout->setRowStretch(0, 1);
 		mMainLayout->setColumnStretch(1, 1);
 		mMainLayout->setContentsMargins(0, 9, 5, 0); // Set the right margin to 5 pixels.
@@ -99,6 +107,7 @@ namespace FFX {
 		mSearchEdit->setReadOnly(work);
 		mSearchFileOnlyButton->setEnabled(!work);
 		mSearchCaseButton->setEnabled(!work);
+		mSearchArchiveButton->setEnabled(!work);
 		mSearchAction->setIcon(work ? QIcon(":/ffx/res/image/cancel.svg") : QIcon(":/ffx/res/image/search.svg"));
 	}
 
@@ -113,12 +122,13 @@ namespace FFX {
 			return;
 		}
 		FileFilterExpr fe(expression.toStdString(), mSearchCaseButton->isChecked());
-		FileFilterPtr filter = fe.Filter();
+		FileFilterPtr nameFilter = fe.Filter();
+		FileFilterPtr filter = nameFilter;
 		if (mSearchFileOnlyButton->isChecked()) {
 			filter = std::make_shared<AndFileFilter>(filter, std::make_shared<OnlyFileFilter>());
 		}
 		SetWorking();
-		mSearchTaskId = MainWindow::Instance()->TaskPanelPtr()->Submit(FileInfoList(mSearchDir), std::make_shared<FileSearchHandler>(filter));
+		mSearchTaskId = MainWindow::Instance()->TaskPanelPtr()->Submit(FileInfoList(mSearchDir), std::make_shared<FileSearchHandler>(filter, mSearchArchiveButton->isChecked(), nameFilter));
 	}
 
 	void FileSearchView::ActivateSearch() {
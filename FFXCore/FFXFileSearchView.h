@@ -41,6 +41,7 @@ namespace FFX {
 		QLineEdit* mSearchEdit;
 		QToolButton* mSearchFileOnlyButton;
 		QToolButton* mSearchCaseButton;
+		QToolButton* mSearchArchiveButton;
 		QGridLayout* mMainLayout;
 	};
 }
@@ -0,0 +1,735 @@
+#include "FFXFileSystem.h"
+
+#include <QObject>
+#include <QDir>
+#include <QFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#include <io.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <linux/fs.h>
+#endif
+
+namespace FFX {
+	namespace FileSystem {
+#ifdef Q_OS_WIN
+		static QString LastError() {
+			wchar_t* buffer = nullptr;
+			FormatMessageW(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+				nullptr, GetLastError(), 0, (LPWSTR)&buffer, 0, nullptr);
+			QString error = buffer != nullptr ? QString::fromWCharArray(buffer).trimmed() : QString();
+			LocalFree(buffer);
+			return error;
+		}
+#else
+		static QString LastError() {
+			return QString::fromLocal8Bit(strerror(errno));
+		}
+#endif
+
+#ifdef Q_OS_WIN
+		static qint64 FileTimeMSecs(quint64 time) {
+			//! FILETIME counts 100 ns intervals since 1601-01-01.
+			return (qint64)(time / 10000) - 11644473600000LL;
+		}
+
+		static HANDLE OpenMetadata(const QString& file) {
+			return CreateFileW((LPCWSTR)QDir::toNativeSeparators(file).utf16(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OPEN_REPARSE_POINT, nullptr);
+		}
+#else
+		static void FromStat(const struct stat& st, FileStat& stat) {
+			stat.device = (quint64)st.st_dev;
+			stat.inode = (quint64)st.st_ino;
+			stat.size = st.st_size;
+			//! st_blocks is in 512 byte units whatever the block size of the file system.
+			stat.allocated = (qint64)st.st_blocks * 512;
+			stat.links = (quint32)st.st_nlink;
+			stat.dir = S_ISDIR(st.st_mode);
+			stat.symLink = S_ISLNK(st.st_mode);
+			stat.modified = (qint64)st.st_mtime * 1000;
+		}
+#endif
+
+		bool Stat(const QString& file, FileStat& stat) {
+#ifdef Q_OS_WIN
+			HANDLE handle = OpenMetadata(file);
+			if (handle == INVALID_HANDLE_VALUE)
+				return false;
+			BY_HANDLE_FILE_INFORMATION info;
+			if (!GetFileInformationByHandle(handle, &info)) {
+				CloseHandle(handle);
+				return false;
+			}
+			stat.device = info.dwVolumeSerialNumber;
+			stat.inode = ((quint64)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+			stat.size = ((qint64)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+			stat.allocated = stat.size;
+			stat.links = info.nNumberOfLinks;
+			stat.dir = (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+			stat.symLink = (info.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+			stat.hidden = (info.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN) != 0;
+			stat.modified = FileTimeMSecs(((quint64)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime);
+			//! Only the data of regular files can be sparse or compressed.
+			FILE_STANDARD_INFO standard;
+			if (!stat.dir && !stat.symLink && GetFileInformationByHandleEx(handle, FileStandardInfo, &standard, sizeof(standard))) {
+				stat.allocated = standard.AllocationSize.QuadPart;
+			}
+			CloseHandle(handle);
+			return true;
+#else
+			struct stat st;
+			if (lstat(QFile::encodeName(file).constData(), &st) != 0)
+				return false;
+			FromStat(st, stat);
+			stat.hidden = QFileInfo(file).fileName().startsWith('.');
+			return true;
+#endif
+		}
+
+		bool ListDir(const QString& dir, const std::function<void(const QString& name, const FileStat& stat)>& entry) {
+#ifdef Q_OS_WIN
+			HANDLE handle = CreateFileW((LPCWSTR)QDir::toNativeSeparators(dir).utf16(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+			if (handle == INVALID_HANDLE_VALUE)
+				return false;
+			BY_HANDLE_FILE_INFORMATION volume;
+			if (!GetFileInformationByHandle(handle, &volume)) {
+				CloseHandle(handle);
+				return false;
+			}
+
+			//! One query returns the sizes, attributes and ids of many entries, the link count is the only thing missing.
+			std::vector<quint64> buffer(8 << 10);
+			FILE_INFO_BY_HANDLE_CLASS infoClass = FileIdBothDirectoryRestartInfo;
+			while (GetFileInformationByHandleEx(handle, infoClass, buffer.data(), (DWORD)(buffer.size() * sizeof(quint64)))) {
+				infoClass = FileIdBothDirectoryInfo;
+				const FILE_ID_BOTH_DIR_INFO* info = (const FILE_ID_BOTH_DIR_INFO*)buffer.data();
+				while (true) {
+					QString name = QString::fromWCharArray(info->FileName, info->FileNameLength / sizeof(WCHAR));
+					if (name != "." && name != "..") {
+						FileStat stat;
+						stat.device = volume.dwVolumeSerialNumber;
+						stat.inode = (quint64)info->FileId.QuadPart;
+						stat.size = info->EndOfFile.QuadPart;
+						stat.allocated = info->AllocationSize.QuadPart;
+						stat.dir = (info->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+						stat.symLink = (info->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+						stat.hidden = (info->FileAttributes & FILE_ATTRIBUTE_HIDDEN) != 0;
+						stat.modified = FileTimeMSecs((quint64)info->LastWriteTime.QuadPart);
+						//! Directories and links never share their data, only regular files are opened.
+						if (!stat.dir && !stat.symLink) {
+							HANDLE file = OpenMetadata(dir + "/" + name);
+							FILE_STANDARD_INFO standard;
+							if (file != INVALID_HANDLE_VALUE && GetFileInformationByHandleEx(file, FileStandardInfo, &standard, sizeof(standard))) {
+								stat.links = standard.NumberOfLinks;
+							}
+							if (file != INVALID_HANDLE_VALUE) {
+								CloseHandle(file);
+							}
+						}
+						entry(name, stat);
+					}
+					if (info->NextEntryOffset == 0)
+						break;
+					info = (const FILE_ID_BOTH_DIR_INFO*)((const char*)info + info->NextEntryOffset);
+				}
+			}
+			bool ok = GetLastError() == ERROR_NO_MORE_FILES;
+			CloseHandle(handle);
+			return ok;
+#else
+			DIR* d = opendir(QFile::encodeName(dir).constData());
+			if (d == nullptr)
+				return false;
+			int fd = dirfd(d);
+			while (struct dirent* e = readdir(d)) {
+				if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0)
+					continue;
+				struct stat st;
+				if (fstatat(fd, e->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+					continue;
+				FileStat stat;
+				FromStat(st, stat);
+				stat.hidden = e->d_name[0] == '.';
+				entry(QFile::decodeName(e->d_name), stat);
+			}
+			closedir(d);
+			return true;
+#endif
+		}
+
+		bool FileId(const QString& file, quint64& device, quint64& inode) {
+			FileStat stat;
+			if (!Stat(file, stat))
+				return false;
+			device = stat.device;
+			inode = stat.inode;
+			return true;
+		}
+
+		bool HardLink(const QString& target, const QString& link, QString* error) {
+#ifdef Q_OS_WIN
+			bool ok = CreateHardLinkW((LPCWSTR)QDir::toNativeSeparators(link).utf16(), (LPCWSTR)QDir::toNativeSeparators(target).utf16(), nullptr);
+#else
+			bool ok = ::link(QFile::encodeName(target).constData(), QFile::encodeName(link).constData()) == 0;
+#endif
+			if (!ok && error != nullptr)
+				*error = LastError();
+			return ok;
+		}
+
+		bool Reflink(const QString& target, const QString& link, QString* error) {
+#ifdef Q_OS_LINUX
+			int in = open(QFile::encodeName(target).constData(), O_RDONLY | O_CLOEXEC);
+			if (in < 0) {
+				if (error != nullptr)
+					*error = LastError();
+				return false;
+			}
+			int out = open(QFile::encodeName(link).constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+			if (out < 0) {
+				if (error != nullptr)
+					*error = LastError();
+				close(in);
+				return false;
+			}
+			bool ok = ioctl(out, FICLONE, in) == 0;
+			if (!ok && error != nullptr)
+				*error = LastError();
+			if (ok) {
+				struct stat st;
+				if (fstat(in, &st) == 0)
+					fchmod(out, st.st_mode & 07777);
+			}
+			close(out);
+			close(in);
+			if (!ok)
+				unlink(QFile::encodeName(link).constData());
+			return ok;
+#else
+			if (error != nullptr)
+				*error = QObject::tr("Reflinks are not supported on this system.");
+			return false;
+#endif
+		}
+
+		bool Sync(QFile& file) {
+			if (!file.flush())
+				return false;
+#ifdef Q_OS_WIN
+			return _commit(file.handle()) == 0;
+#else
+			return fsync(file.handle()) == 0;
+#endif
+		}
+
+		bool ReadUncached(const QString& file, const std::function<bool(const char* data, qint64 size)>& data, QString* error) {
+			static const int BlockSize = 1 << 20;
+#ifdef Q_OS_WIN
+			HANDLE handle = CreateFileW((LPCWSTR)QDir::toNativeSeparators(file).utf16(), GENERIC_READ, FILE_SHARE_READ,
+				nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (handle == INVALID_HANDLE_VALUE) {
+				if (error != nullptr)
+					*error = LastError();
+				return false;
+			}
+			//! Unbuffered reads need a buffer aligned to the sector size, VirtualAlloc returns page aligned memory. The last read
+			//! asks for a whole block and gets the bytes up to the end of the file.
+			char* buffer = (char*)VirtualAlloc(nullptr, BlockSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+			bool ok = buffer != nullptr;
+			if (!ok && error != nullptr)
+				*error = LastError();
+			while (ok) {
+				DWORD n = 0;
+				if (!ReadFile(handle, buffer, BlockSize, &n, nullptr)) {
+					if (error != nullptr)
+						*error = LastError();
+					ok = false;
+				} else if (n == 0) {
+					break;
+				} else if (!data(buffer, n)) {
+					ok = false;
+				}
+			}
+			if (buffer != nullptr)
+				VirtualFree(buffer, 0, MEM_RELEASE);
+			CloseHandle(handle);
+			return ok;
+#else
+			int fd = open(QFile::encodeName(file).constData(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0) {
+				if (error != nullptr)
+					*error = LastError();
+				return false;
+			}
+#ifdef Q_OS_MACOS
+			fcntl(fd, F_NOCACHE, 1);
+#else
+			//! Only the clean pages are dropped, the file is expected to be synced.
+			posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+			posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+			QByteArray buffer(BlockSize, 0);
+			bool ok = true;
+			while (ok) {
+				ssize_t n = read(fd, buffer.data(), buffer.size());
+				if (n < 0 && errno == EINTR)
+					continue;
+				if (n < 0) {
+					if (error != nullptr)
+						*error = LastError();
+					ok = false;
+				} else if (n == 0) {
+					break;
+				} else if (!data(buffer.constData(), n)) {
+					ok = false;
+				}
+			}
+			close(fd);
+			return ok;
+#endif
+		}
+
+		qint64 CopyChunk(QFile& in, QFile& out, qint64 size, QByteArray& buffer, QString* error) {
+#ifdef Q_OS_LINUX
+			static std::atomic<bool> unsupported(false);
+			if (!unsupported) {
+				ssize_t n = copy_file_range(in.handle(), nullptr, out.handle(), nullptr, (size_t)size, 0);
+				if (n >= 0)
+					return n;
+				//! Older kernels cannot copy across file systems, the data goes through the buffer then.
+				if (errno != ENOSYS && errno != EXDEV && errno != EINVAL && errno != EOPNOTSUPP) {
+					if (error != nullptr)
+						*error = LastError();
+					return -1;
+				}
+				if (errno == ENOSYS)
+					unsupported = true;
+			}
+			//! QFile does not know how far the kernel copied.
+			in.seek(lseek(in.handle(), 0, SEEK_CUR));
+			out.seek(lseek(out.handle(), 0, SEEK_CUR));
+#endif
+			if (buffer.size() < size)
+				buffer.resize((int)size);
+			qint64 n = in.read(buffer.data(), size);
+			if (n < 0 || (n > 0 && out.write(buffer.constData(), n) != n)) {
+				if (error != nullptr)
+					*error = n < 0 ? in.errorString() : out.errorString();
+				return -1;
+			}
+			return n;
+		}
+
+		//! The progress is reported every this many entries removed.
+		static const qint64 RemoveReportInterval = 1024;
+
+		struct RemoveNode {
+			RemoveNode* parent;
+			QString path;
+			//! The listing of the directory and its subdirectories not removed yet.
+			std::atomic<int> pending;
+			//! Something below could not be removed, so the directory stays.
+			std::atomic<bool> keep;
+			//! Name in the parent, below the root a directory is opened and removed relative to its parent and never through a link.
+			QByteArray name;
+			//! The directory itself from its listing until it is released, its subdirectories are opened from it.
+			int fd = -1;
+		};
+
+		/// <summary>
+		/// Removes a tree with a work-stealing walker: every worker lists the directories of its own queue depth first and
+		/// takes the directories nearest to the root from the others when it runs out. A directory is removed by the worker
+		/// that finishes its last subdirectory, so the tree is walked once.
+		/// </summary>
+		class TreeRemover {
+		public:
+			TreeRemover(int workers, const std::function<void(const QString&, const QString&)>& failed,
+				const std::function<void(qint64)>& removed, const std::function<bool()>& cancelled)
+				: mFailed(failed)
+				, mRemoved(removed)
+				, mCancelled(cancelled) {
+				for (int i = 0; i < workers; i++) {
+					mQueues.emplace_back(new Queue);
+				}
+			}
+
+			bool Run(const QString& path) {
+				QFileInfo info(path);
+				if (!info.isDir() || info.isSymLink()) {
+					QString error;
+					if (!RemoveFile(path, error)) {
+						mFailed(path, error);
+						return false;
+					}
+					Removed();
+					return true;
+				}
+
+				RemoveNode* root = new RemoveNode{ nullptr, info.absoluteFilePath(), { 1 }, { false } };
+				mRootRemoved = false;
+				mOutstanding = 1;
+				mQueues[0]->nodes.push_back(root);
+				QThreadPool pool;
+				pool.setMaxThreadCount((int)mQueues.size());
+				for (int i = 0; i < (int)mQueues.size(); i++) {
+					pool.start([this, i]() { Work(i); });
+				}
+				pool.waitForDone();
+				mRemoved(mRemovedCount.load());
+				return mRootRemoved;
+			}
+
+		private:
+			struct Queue {
+				QMutex mutex;
+				std::deque<RemoveNode*> nodes;
+			};
+
+			void Work(int worker) {
+				while (true) {
+					RemoveNode* node = Take(worker);
+					if (node == nullptr) {
+						//! Checked again under the lock, a push or the end of the walk wakes the idle workers.
+						QMutexLocker locker(&mIdleMutex);
+						while ((node = Take(worker)) == nullptr && mOutstanding.load() > 0) {
+							mIdle.wait(&mIdleMutex);
+						}
+						if (node == nullptr)
+							return;
+					}
+					if (mCancelled()) {
+						node->keep = true;
+						Release(node);
+					} else {
+						List(node, worker);
+					}
+					if (--mOutstanding == 0) {
+						QMutexLocker locker(&mIdleMutex);
+						mIdle.wakeAll();
+					}
+				}
+			}
+
+			RemoveNode* Take(int worker) {
+				{
+					Queue& own = *mQueues[worker];
+					QMutexLocker locker(&own.mutex);
+					if (!own.nodes.empty()) {
+						RemoveNode* node = own.nodes.back();
+						own.nodes.pop_back();
+						return node;
+					}
+				}
+				for (size_t i = 1; i < mQueues.size(); i++) {
+					Queue& other = *mQueues[(worker + i) % mQueues.size()];
+					QMutexLocker locker(&other.mutex);
+					if (!other.nodes.empty()) {
+						RemoveNode* node = other.nodes.front();
+						other.nodes.pop_front();
+						return node;
+					}
+				}
+				return nullptr;
+			}
+
+			void Push(int worker, RemoveNode* parent, const QString& path, const QByteArray& name = QByteArray()) {
+				parent->pending++;
+				mOutstanding++;
+				{
+					Queue& own = *mQueues[worker];
+					QMutexLocker locker(&own.mutex);
+					own.nodes.push_back(new RemoveNode{ parent, path, { 1 }, { false }, name });
+				}
+				QMutexLocker locker(&mIdleMutex);
+				mIdle.wakeOne();
+			}
+
+			//! The directory is removed once its listing and all its subdirectories are done.
+			void Release(RemoveNode* node) {
+				while (node != nullptr) {
+					if (--node->pending > 0)
+						return;
+					bool removed = false;
+					if (!node->keep) {
+						QString error;
+						removed = RemoveDir(node, error);
+						if (removed) {
+							Removed();
+						} else {
+							mFailed(node->path, error);
+						}
+					}
+					CloseDir(node);
+					RemoveNode* parent = node->parent;
+					if (parent == nullptr) {
+						mRootRemoved = removed;
+					} else if (!removed) {
+						parent->keep = true;
+					}
+					delete node;
+					node = parent;
+				}
+			}
+
+			void Removed() {
+				qint64 count = ++mRemovedCount;
+				if (count % RemoveReportInterval == 0) {
+					mRemoved(count);
+				}
+			}
+
+#ifdef Q_OS_WIN
+			static bool RemoveFile(const QString& path, QString& error) {
+				std::wstring native = QDir::toNativeSeparators(path).toStdWString();
+				DWORD attributes = GetFileAttributesW(native.c_str());
+				auto remove = [&]() {
+					//! Junctions and directory links are removed as directories, their targets are left alone.
+					return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) ? RemoveDirectoryW(native.c_str()) : DeleteFileW(native.c_str());
+				};
+				if (remove())
+					return true;
+				if (GetLastError() == ERROR_ACCESS_DENIED && SetFileAttributesW(native.c_str(), FILE_ATTRIBUTE_NORMAL) && remove())
+					return true;
+				error = LastError();
+				return false;
+			}
+
+			static bool RemoveDir(RemoveNode* node, QString& error) {
+				std::wstring native = QDir::toNativeSeparators(node->path).toStdWString();
+				if (RemoveDirectoryW(native.c_str()))
+					return true;
+				if (GetLastError() == ERROR_ACCESS_DENIED && SetFileAttributesW(native.c_str(), FILE_ATTRIBUTE_NORMAL) && RemoveDirectoryW(native.c_str()))
+					return true;
+				error = LastError();
+				return false;
+			}
+
+			static void CloseDir(RemoveNode*) {}
+
+			void List(RemoveNode* node, int worker) {
+				WIN32_FIND_DATAW data;
+				std::wstring pattern = QDir::toNativeSeparators(node->path + "/*").toStdWString();
+				HANDLE find = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+				if (find == INVALID_HANDLE_VALUE) {
+					mFailed(node->path, LastError());
+					node->keep = true;
+					Release(node);
+					return;
+				}
+				do {
+					//! A cancelled listing leaves entries behind, the directory is kept without reporting it.
+					if (mCancelled()) {
+						node->keep = true;
+						break;
+					}
+					QString name = QString::fromWCharArray(data.cFileName);
+					if (name == "." || name == "..")
+						continue;
+					QString path = node->path + "/" + name;
+					if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && !(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+						Push(worker, node, path);
+						continue;
+					}
+					QString error;
+					if (RemoveFile(path, error)) {
+						Removed();
+					} else {
+						mFailed(path, error);
+						node->keep = true;
+					}
+				} while (FindNextFileW(find, &data));
+				FindClose(find);
+				Release(node);
+			}
+#else
+			//! Adds the write permission to the directory holding path, the removal is denied without it.
+			static void AllowRemoval(const QString& path) {
+				QByteArray parent = QFile::encodeName(QFileInfo(path).absolutePath());
+				struct stat st;
+				if (stat(parent.constData(), &st) == 0)
+					chmod(parent.constData(), st.st_mode | S_IWUSR | S_IXUSR);
+			}
+
+			static bool RemoveFile(const QString& path, QString& error) {
+				QByteArray native = QFile::encodeName(path);
+				if (unlink(native.constData()) == 0)
+					return true;
+				if (errno == EACCES) {
+					AllowRemoval(path);
+					if (unlink(native.constData()) == 0)
+						return true;
+				}
+				error = LastError();
+				return false;
+			}
+
+			static bool RemoveDir(RemoveNode* node, QString& error) {
+				if (node->parent == nullptr) {
+					QByteArray native = QFile::encodeName(node->path);
+					if (rmdir(native.constData()) == 0)
+						return true;
+					if (errno == EACCES) {
+						AllowRemoval(node->path);
+						if (rmdir(native.constData()) == 0)
+							return true;
+					}
+					error = LastError();
+					return false;
+				}
+
+				int parentFd = node->parent->fd;
+				if (unlinkat(parentFd, node->name.constData(), AT_REMOVEDIR) == 0)
+					return true;
+				if (errno == EACCES) {
+					struct stat st;
+					if (fstat(parentFd, &st) == 0)
+						fchmod(parentFd, st.st_mode | S_IWUSR | S_IXUSR);
+					if (unlinkat(parentFd, node->name.constData(), AT_REMOVEDIR) == 0)
+						return true;
+				}
+				error = LastError();
+				return false;
+			}
+
+			static void CloseDir(RemoveNode* node) {
+				if (node->fd >= 0) {
+					close(node->fd);
+					node->fd = -1;
+				}
+			}
+
+			static int OpenDir(RemoveNode* node) {
+				const int flags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+				if (node->parent == nullptr) {
+					QByteArray native = QFile::encodeName(node->path);
+					int fd = open(native.constData(), flags);
+					if (fd < 0 && errno == EACCES) {
+						chmod(native.constData(), S_IRWXU);
+						fd = open(native.constData(), flags);
+					}
+					return fd;
+				}
+
+				//! The parent is held open, a directory replaced by a link meanwhile is not followed.
+				int parentFd = node->parent->fd;
+				const char* name = node->name.constData();
+				int fd = openat(parentFd, name, flags);
+				if (fd < 0 && errno == EACCES) {
+					struct stat st;
+					if (fstatat(parentFd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode))
+						fchmodat(parentFd, name, st.st_mode | S_IRWXU, 0);
+					fd = openat(parentFd, name, flags);
+				}
+				return fd;
+			}
+
+			void List(RemoveNode* node, int worker) {
+				int fd = OpenDir(node);
+				DIR* dir = fd < 0 ? nullptr : fdopendir(fd);
+				if (dir == nullptr) {
+					mFailed(node->path, LastError());
+					if (fd >= 0)
+						close(fd);
+					node->keep = true;
+					Release(node);
+					return;
+				}
+				//! The stream owns fd, a duplicate stays open for the subdirectories until the directory is released.
+				node->fd = dup(fd);
+				if (node->fd < 0) {
+					mFailed(node->path, LastError());
+					closedir(dir);
+					node->keep = true;
+					Release(node);
+					return;
+				}
+
+				bool writable = false;
+				while (true) {
+					//! A cancelled listing leaves entries behind, the directory is kept without reporting it.
+					if (mCancelled()) {
+						node->keep = true;
+						break;
+					}
+					struct dirent* entry = readdir(dir);
+					if (entry == nullptr)
+						break;
+					const char* name = entry->d_name;
+					if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+						continue;
+					bool isDir = entry->d_type == DT_DIR;
+					if (entry->d_type == DT_UNKNOWN) {
+						struct stat st;
+						isDir = fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+					}
+					if (isDir) {
+						Push(worker, node, node->path + "/" + QFile::decodeName(name), QByteArray(name));
+						continue;
+					}
+					int r = unlinkat(fd, name, 0);
+					if (r != 0 && errno == EACCES && !writable) {
+						//! Only the directory needs the write permission, the modes of the files do not matter.
+						struct stat st;
+						if (fstat(fd, &st) == 0)
+							fchmod(fd, st.st_mode | S_IWUSR | S_IXUSR);
+						writable = true;
+						r = unlinkat(fd, name, 0);
+					}
+					if (r == 0) {
+						Removed();
+					} else {
+						mFailed(node->path + "/" + QFile::decodeName(name), LastError());
+						node->keep = true;
+					}
+				}
+				closedir(dir);
+				Release(node);
+			}
+#endif
+
+		private:
+			std::vector<std::unique_ptr<Queue>> mQueues;
+			//! Directories queued or being listed, the walk is over when it drops to 0.
+			std::atomic<qint64> mOutstanding{ 0 };
+			//! The workers out of directories wait here for a push or the end of the walk.
+			QMutex mIdleMutex;
+			QWaitCondition mIdle;
+			std::atomic<qint64> mRemovedCount{ 0 };
+			bool mRootRemoved = false;
+			std::function<void(const QString&, const QString&)> mFailed;
+			std::function<void(qint64)> mRemoved;
+			std::function<bool()> mCancelled;
+		};
+
+		bool RemoveTree(const QString& path, int maxParallel,
+			const std::function<void(const QString& path, const QString& error)>& failed,
+			const std::function<void(qint64 removed)>& removed,
+			const std::function<bool()>& cancelled) {
+			int workers = maxParallel > 0 ? maxParallel : QThread::idealThreadCount();
+			TreeRemover remover(qMax(workers, 1), failed, removed, cancelled);
+			return remover.Run(path);
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "FFXCore.h"
+
+#include <QString>
+
+#include <functional>
+
+class QFile;
+
+namespace FFX {
+	//! Thin wrappers of the system calls Qt has no API for, kept in one translation unit so the platform headers stay out of the others.
+	namespace FileSystem {
+		struct FileStat {
+			quint64 device = 0;
+			quint64 inode = 0;
+			//! Apparent size, the length of the target path for symbolic links.
+			qint64 size = 0;
+			//! Bytes allocated on the device, less than the size for sparse and compressed files.
+			qint64 allocated = 0;
+			//! Number of hard links, names beyond the first share the same data.
+			quint32 links = 1;
+			bool dir = false;
+			bool symLink = false;
+			bool hidden = false;
+			//! Last modification in milliseconds since the epoch.
+			qint64 modified = 0;
+		};
+
+		//! Identity and sizes of the file from the metadata alone, the file is not opened for reading. Symbolic links are not followed.
+		FFXCORE_EXPORT bool Stat(const QString& file, FileStat& stat);
+		//! Stat of every entry of dir from its listing, on Windows only the regular files are opened for their link count.
+		FFXCORE_EXPORT bool ListDir(const QString& dir, const std::function<void(const QString& name, const FileStat& stat)>& entry);
+		//! Identity of the file on its volume, (device, inode) on POSIX and (volume serial, file index) on Windows. Symbolic links are not followed.
+		FFXCORE_EXPORT bool FileId(const QString& file, quint64& device, quint64& inode);
+		//! Creates link as another name of target, both must be on the same volume.
+		FFXCORE_EXPORT bool HardLink(const QString& target, const QString& link, QString* error = nullptr);
+		//! Creates link as a copy-on-write clone of target, only on file systems with shared extents such as Btrfs and XFS.
+		FFXCORE_EXPORT bool Reflink(const QString& target, const QString& link, QString* error = nullptr);
+		//! Writes the buffered data of the open file through to the device, so it survives a power loss.
+		FFXCORE_EXPORT bool Sync(QFile& file);
+		//! Reads the whole file from the device rather than the system cache, unbuffered on Windows and after dropping the cached pages
+		//! elsewhere, so a copy just written can be checked. data receives the blocks in order and stops reading when it returns false.
+		FFXCORE_EXPORT bool ReadUncached(const QString& file, const std::function<bool(const char* data, qint64 size)>& data, QString* error = nullptr);
+		//! Copies up to size bytes from the position of in to the position of out, inside the kernel where the system can, so servers and
+		//! copy-on-write file systems copy on their side. Both files must be opened unbuffered. Returns the bytes copied, 0 at the end of in, -1 on errors.
+		FFXCORE_EXPORT qint64 CopyChunk(QFile& in, QFile& out, qint64 size, QByteArray& buffer, QString* error = nullptr);
+		//! Removes path and everything below it on maxParallel threads (0 means the number of CPU cores), entries are removed relative to the
+		//! handles of their directories and the directories bottom-up as soon as they are empty. Permissions are only changed where the removal
+		//! is denied. failed is called for every entry left and removed with the count so far, both from the worker threads.
+		FFXCORE_EXPORT bool RemoveTree(const QString& path, int maxParallel,
+			const std::function<void(const QString& path, const QString& error)>& failed,
+			const std::function<void(qint64 removed)>& removed,
+			const std::function<bool()>& cancelled);
+	}
+}
@@ -22,6 +22,7 @@
 #include <QApplication>
 #include <QMimeData>
 #include <QShortcut>
+#include <QTimer>
 
 namespace FFX {
 	MainWindow* MainWindow::sInstance = nullptr;
@@ -164,6 +165,8 @@ namespace FFX {
 		mFileMainView->Restore(mAppConfig);
 
 		mPluginManager->AutoLoad();
+		//! Asked once the window is up, the plugins may provide the handlers.
+		QTimer::singleShot(0, this, [this]() { mTaskPanel->ResumeUnfinished(mHandlerFactory); });
 	}
 
 	void MainWindow::closeEvent(QCloseEvent* event) {
@@ -2,6 +2,7 @@
 #include "FFXMainWindow.h"
 #include "FFXMainWindow.h"
 #include "FFXTaskPanel.h"
+#include "FFXSevenZip.h"
 
 #include <QPluginLoader>
 #include <QDir>
@@ -149,9 +150,8 @@ namespace FFX {
 	}
 
 	void PluginInstallHandler::UnzipFile(const QFileInfo& zipFile, const QString& outputDir, ProgressPtr progress) {
-		Bit7zLibrary lib{ "7z.dll" };
 		try {
-			BitFileExtractor extractor{ lib, BitFormat::Auto };
+			BitFileExtractor extractor{ SevenZipLibrary::Instance(), BitFormat::Auto };
 			extractor.test(zipFile.absoluteFilePath().toStdString());
 			//! bind progress callback function: prototype is <bool calback(uint64_t size)>
 			extractor.setProgressCallback(std::bind(UnzipProgressCallback, std::placeholders::_1, zipFile, progress));
@@ -0,0 +1,41 @@
+#include "FFXSevenZip.h"
+
+#include <QDir>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QMap>
+
+#include <memory>
+
+#include <bit7z/bit7zlibrary.hpp>
+
+namespace FFX {
+	static QMutex DefaultPathMutex;
+	static QString DefaultLibraryPath = QStringLiteral("7z.dll");
+
+	QString SevenZipLibrary::DefaultPath() {
+		QMutexLocker locker(&DefaultPathMutex);
+		return DefaultLibraryPath;
+	}
+
+	void SevenZipLibrary::SetDefaultPath(const QString& path) {
+		QMutexLocker locker(&DefaultPathMutex);
+		DefaultLibraryPath = path;
+	}
+
+	const bit7z::Bit7zLibrary& SevenZipLibrary::Instance(const QString& path) {
+		static QMutex mutex;
+		static QMap<QString, std::shared_ptr<bit7z::Bit7zLibrary>> libraries;
+
+		QString key = QDir::cleanPath(path);
+		QMutexLocker locker(&mutex);
+		auto it = libraries.find(key);
+		if (it != libraries.end())
+			return *it.value();
+
+		//! Only a successfully loaded library is kept.
+		std::shared_ptr<bit7z::Bit7zLibrary> lib = std::make_shared<bit7z::Bit7zLibrary>(key.toStdString());
+		libraries[key] = lib;
+		return *lib;
+	}
+}
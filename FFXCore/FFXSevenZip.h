@@ -0,0 +1,24 @@
+#pragma once
+#include "FFXCore.h"
+
+#include <QString>
+
+namespace bit7z {
+	class Bit7zLibrary;
+}
+
+namespace FFX {
+	/// <summary>
+	/// Process-wide holder of the 7-Zip shared library. Loading the library resolves a lot of symbols,
+	/// so it is loaded lazily on first use and kept until the process exits, every handler that works
+	/// with archives must get it from here instead of constructing its own Bit7zLibrary.
+	/// </summary>
+	class FFXCORE_EXPORT SevenZipLibrary {
+	public:
+		//! "7z.dll" unless a plugin shipping its own library sets it, used by FFXCore's archive browsing.
+		static QString DefaultPath();
+		static void SetDefaultPath(const QString& path);
+		//! Thread safe, throws bit7z::BitException if the library can not be loaded, the next call retries.
+		static const bit7z::Bit7zLibrary& Instance(const QString& path = DefaultPath());
+	};
+}
@@ -1,4 +1,5 @@
 #include "FFXTask.h"
+#include "FFXTaskJournal.h"
 #include <QDateTime>
 #include <QDebug>
 
@@ -51,6 +52,10 @@ namespace FFX {
 		SetStatus(State::Running);
 		mTimeStart = QDateTime::currentMSecsSinceEpoch();
 		QFileInfoList r = mHandler->Handle(mSourceFiles, ProgressPtr(this));
+		//! Only the journals of the tasks that never got here are left to resume.
+		if (mHandler->Journal() != nullptr) {
+			mHandler->Journal()->Finish();
+		}
 	}
 
 	void Task::Cancel() {
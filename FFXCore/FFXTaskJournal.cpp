@@ -0,0 +1,167 @@
+#include "FFXTaskJournal.h"
+#include "FFXFileSystem.h"
+
+#include <QDir>
+#include <QUuid>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+namespace FFX {
+	//! Records done since the last sync may be lost on a power loss, those files are handled again.
+	static const qint64 JournalSyncInterval = 1000;
+
+	/************************************************************************************************************************
+	 * Class： TaskJournal
+	 *
+	 *
+	/************************************************************************************************************************/
+	QString TaskJournal::JournalDir() {
+		return QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).absoluteFilePath("journal");
+	}
+
+	TaskJournalPtr TaskJournal::Create(FileHandlerPtr handler, const QFileInfoList& files) {
+		QDir().mkpath(JournalDir());
+		TaskJournalPtr journal = std::make_shared<TaskJournal>();
+		journal->mFile.setFileName(QDir(JournalDir()).absoluteFilePath(QUuid::createUuid().toString(QUuid::WithoutBraces) + ".journal"));
+		if (!journal->mFile.open(QIODevice::WriteOnly | QIODevice::Append))
+			return TaskJournalPtr();
+
+		journal->mHandlerName = handler->Name();
+		journal->mCreated = QDateTime::currentDateTime();
+		journal->mFiles = files;
+		QJsonObject args;
+		for (const Argument& arg : handler->ArgMap()) {
+			journal->mArgs[arg.Name()] = arg.Value();
+			args[arg.Name()] = QJsonValue::fromVariant(arg.Value());
+		}
+		QJsonArray inputs;
+		for (const QFileInfo& file : files) {
+			inputs << file.absoluteFilePath();
+		}
+		QJsonObject header;
+		header["handler"] = journal->mHandlerName;
+		header["created"] = journal->mCreated.toMSecsSinceEpoch();
+		header["args"] = args;
+		header["files"] = inputs;
+		journal->mFile.write(QJsonDocument(header).toJson(QJsonDocument::Compact) + '\n');
+		FileSystem::Sync(journal->mFile);
+		return journal;
+	}
+
+	QList<TaskJournalPtr> TaskJournal::Unfinished() {
+		QList<TaskJournalPtr> result;
+		QDir dir(JournalDir());
+		for (const QFileInfo& file : dir.entryInfoList(QStringList() << "*.journal", QDir::Files)) {
+			TaskJournalPtr journal = std::make_shared<TaskJournal>();
+			if (journal->Load(file.absoluteFilePath())) {
+				result << journal;
+			} else {
+				QFile::remove(file.absoluteFilePath());
+			}
+		}
+		std::sort(result.begin(), result.end(), [](const TaskJournalPtr& a, const TaskJournalPtr& b) { return a->Created() < b->Created(); });
+		return result;
+	}
+
+	bool TaskJournal::Load(const QString& path) {
+		QMutexLocker locker(&mMutex);
+		mFile.setFileName(path);
+		if (!mFile.open(QIODevice::ReadOnly))
+			return false;
+		QJsonObject header = QJsonDocument::fromJson(mFile.readLine()).object();
+		mHandlerName = header["handler"].toString();
+		if (mHandlerName.isEmpty())
+			return false;
+		mCreated = QDateTime::fromMSecsSinceEpoch((qint64)header["created"].toDouble());
+		mArgs = header["args"].toObject().toVariantMap();
+		for (const QJsonValue& file : header["files"].toArray()) {
+			mFiles << QFileInfo(file.toString());
+		}
+
+		//! A record torn by the crash is the last line, it does not parse and is dropped.
+		while (!mFile.atEnd()) {
+			QJsonArray record = QJsonDocument::fromJson(mFile.readLine()).array();
+			QString type = record.at(0).toString();
+			if (type == "D") {
+				mDone[record.at(1).toString()] = record.at(2).toString();
+				mPartial.remove(record.at(1).toString());
+			} else if (type == "C") {
+				mPartial[record.at(1).toString()] = qMakePair(record.at(2).toString(), (qint64)record.at(3).toDouble());
+			}
+		}
+		mFile.close();
+		mResumed = true;
+		return mFile.open(QIODevice::WriteOnly | QIODevice::Append);
+	}
+
+	int TaskJournal::DoneCount() {
+		QMutexLocker locker(&mMutex);
+		return mDone.size();
+	}
+
+	bool TaskJournal::IsDone(const QString& source, QString* dest) {
+		QMutexLocker locker(&mMutex);
+		auto it = mDone.find(source);
+		if (it == mDone.end())
+			return false;
+		if (dest != nullptr)
+			*dest = it.value();
+		return true;
+	}
+
+	bool TaskJournal::Partial(const QString& source, QString& dest, qint64& offset) {
+		QMutexLocker locker(&mMutex);
+		auto it = mPartial.find(source);
+		if (it == mPartial.end() || !QFileInfo(it.value().first).isFile())
+			return false;
+		dest = it.value().first;
+		//! The file may have been truncated since, what is left is not trusted then.
+		offset = QFileInfo(dest).size() >= it.value().second ? it.value().second : 0;
+		return true;
+	}
+
+	void TaskJournal::Done(const QString& source, const QString& dest) {
+		QMutexLocker locker(&mMutex);
+		mDone[source] = dest;
+		mPartial.remove(source);
+		Append(QJsonArray{ "D", source, dest }, false);
+	}
+
+	void TaskJournal::Checkpoint(const QString& source, const QString& dest, qint64 offset) {
+		QMutexLocker locker(&mMutex);
+		mPartial[source] = qMakePair(dest, offset);
+		Append(QJsonArray{ "C", source, dest, offset }, true);
+	}
+
+	void TaskJournal::Append(const QJsonArray& record, bool sync) {
+		if (!mFile.isOpen())
+			return;
+		mFile.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n');
+		qint64 now = QDateTime::currentMSecsSinceEpoch();
+		if (sync || now - mLastSync >= JournalSyncInterval) {
+			FileSystem::Sync(mFile);
+			mLastSync = now;
+		} else {
+			mFile.flush();
+		}
+	}
+
+	void TaskJournal::Finish() {
+		QMutexLocker locker(&mMutex);
+		mFile.close();
+		mFile.remove();
+	}
+
+	void TaskJournal::Discard() {
+		QMutexLocker locker(&mMutex);
+		for (auto it = mPartial.begin(); it != mPartial.end(); it++) {
+			QFile::remove(it.value().first);
+		}
+		mFile.close();
+		mFile.remove();
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "FFXFileHandler.h"
+
+#include <QString>
+#include <QFile>
+#include <QHash>
+#include <QDateTime>
+#include <QVariantMap>
+#include <QMutex>
+#include <QJsonArray>
+
+namespace FFX {
+	/// <summary>
+	/// Append-only journal of a resumable task, kept in JournalDir until the task finishes. The first line holds the
+	/// handler, its arguments and the input files, every other line records a file done or a checkpoint of the file
+	/// in progress, so a task interrupted by a crash or a reboot can go on where it stopped.
+	/// </summary>
+	class FFXCORE_EXPORT TaskJournal {
+	public:
+		static QString JournalDir();
+		//! Starts the journal of a new task, returns nullptr if it cannot be written.
+		static std::shared_ptr<TaskJournal> Create(FileHandlerPtr handler, const QFileInfoList& files);
+		//! Journals left behind by the tasks that did not finish, oldest first.
+		static QList<std::shared_ptr<TaskJournal>> Unfinished();
+
+	public:
+		bool Load(const QString& path);
+		QString Path() const { return mFile.fileName(); }
+		QString HandlerName() const { return mHandlerName; }
+		QVariantMap Args() const { return mArgs; }
+		QFileInfoList Files() const { return mFiles; }
+		QDateTime Created() const { return mCreated; }
+		//! The journal was loaded to resume the task, not created for a new one.
+		bool Resumed() const { return mResumed; }
+		int DoneCount();
+
+	public:
+		//! dest is set to where the source went if it is done.
+		bool IsDone(const QString& source, QString* dest = nullptr);
+		//! The source was in progress, dest holds its data up to offset.
+		bool Partial(const QString& source, QString& dest, qint64& offset);
+		void Done(const QString& source, const QString& dest);
+		//! The data of dest up to offset is on the device, the journal is synced as well.
+		void Checkpoint(const QString& source, const QString& dest, qint64 offset);
+		//! The task finished, the journal is removed.
+		void Finish();
+		//! The task is not resumed, the files in progress are removed with the journal.
+		void Discard();
+
+	private:
+		void Append(const QJsonArray& record, bool sync);
+
+	private:
+		QMutex mMutex;
+		QFile mFile;
+		QString mHandlerName;
+		QVariantMap mArgs;
+		QFileInfoList mFiles;
+		QDateTime mCreated;
+		//! Destination of each file done and of each file in progress with its offset, by source path.
+		QHash<QString, QString> mDone;
+		QHash<QString, QPair<QString, qint64>> mPartial;
+		qint64 mLastSync = 0;
+		bool mResumed = false;
+	};
+	typedef std::shared_ptr<TaskJournal> TaskJournalPtr;
+}
@@ -1,4 +1,5 @@
 #include "FFXTaskPanel.h"
+#include "FFXTaskJournal.h"
 #include "FFXString.h"
 
 #include <QGridLayout>
@@ -11,6 +12,7 @@
 #include <QProgressBar>
 #include <QHeaderView>
 #include <QDateTime>
+#include <QMessageBox>
 
 namespace FFX {
 	int TaskIdGenerator::Id() {
@@ -54,6 +56,10 @@ namespace FFX {
 
 	int TaskPanel::Submit(const QFileInfoList& files, FileHandlerPtr handler, bool showInPanel) {
 		int newTaskId = mTaskIdGenerator.Id();
+		//! Resumed tasks come with the journal they left.
+		if (handler->IsResumable() && handler->Journal() == nullptr) {
+			handler->SetJournal(TaskJournal::Create(handler, files));
+		}
 		Task* newTask = new Task(newTaskId, files, handler);
 		connect(newTask, &Task::TaskComplete, this, &TaskPanel::OnTaskComplete);
 		connect(newTask, &Task::TaskProgressChanged, this, &TaskPanel::OnTaskProgressChanged);
@@ -103,6 +109,39 @@ namespace FFX {
 			task->Cancel();
 	}
 
+	void TaskPanel::ResumeUnfinished(HandlerFactory* factory) {
+		QList<TaskJournalPtr> journals = TaskJournal::Unfinished();
+		if (journals.isEmpty())
+			return;
+
+		QStringList tasks;
+		for (const TaskJournalPtr& journal : journals) {
+			FileHandlerPtr handler = factory->Handler(journal->HandlerName());
+			tasks << QObject::tr("%1, started at %2, %3 files done.")
+				.arg(handler == nullptr ? journal->HandlerName() : handler->DisplayName())
+				.arg(journal->Created().toString("yyyy-MM-dd hh:mm:ss"))
+				.arg(journal->DoneCount());
+		}
+		QMessageBox::StandardButton r = QMessageBox::question(this, QObject::tr("Unfinished Tasks"),
+			QObject::tr("These tasks did not finish last time:\n%1\n\nResume them where they stopped? The files in progress are removed otherwise.").arg(tasks.join("\n")),
+			QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+
+		for (const TaskJournalPtr& journal : journals) {
+			FileHandlerPtr prototype = factory->Handler(journal->HandlerName());
+			if (r != QMessageBox::Yes || prototype == nullptr) {
+				journal->Discard();
+				continue;
+			}
+			FileHandlerPtr handler = prototype->Clone();
+			QVariantMap args = journal->Args();
+			for (auto it = args.begin(); it != args.end(); it++) {
+				handler->SetArg(it.key(), it.value());
+			}
+			handler->SetJournal(journal);
+			Submit(journal->Files(), handler);
+		}
+	}
+
 	void TaskPanel::SetupUi() {
 		resize(600, 400);
 
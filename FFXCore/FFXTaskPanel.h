@@ -49,6 +49,8 @@ namespace FFX {
 		int Submit(const QFileInfoList& files, FileHandlerPtr handler, bool showInPanel = true);
 		void Cancel(int taskId);
 		int RunningTaskCount() const;
+		//! Offers to resume the tasks left unfinished by the last run, the handlers are created from the factory.
+		void ResumeUnfinished(HandlerFactory* factory);
 
 	Q_SIGNALS:
 		void TaskSubmit(int taskId);
@@ -0,0 +1,312 @@
+#include "FFXTrash.h"
+
+#include <QObject>
+#include <QDir>
+#include <QFile>
+#include <QUrl>
+#include <QHash>
+#include <QDateTime>
+#include <QStandardPaths>
+
+#if defined(Q_OS_UNIX) && !defined(Q_OS_MACOS)
+#define FFX_FREEDESKTOP_TRASH
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+namespace FFX {
+#ifdef FFX_FREEDESKTOP_TRASH
+	//! The info files of a batch are synced together, before their files are moved.
+	static const int TrashBatchSize = 1024;
+
+	static QString LastError() {
+		return QString::fromLocal8Bit(strerror(errno));
+	}
+
+	struct TrashDir {
+		QString path;
+		//! Paths in the trash info are relative to it, empty for the home trash where they are absolute.
+		QString topDir;
+	};
+
+	static bool MakeTrashDir(const QString& path) {
+		for (const QString& dir : { path, path + "/files", path + "/info" }) {
+			if (mkdir(QFile::encodeName(dir).constData(), 0700) != 0 && errno != EEXIST)
+				return false;
+		}
+		return true;
+	}
+
+	//! The mount point holding the path, the highest directory on the same device.
+	static QString TopDir(const QString& path, dev_t device) {
+		QString dir = QFileInfo(path).absolutePath();
+		while (true) {
+			QString parent = QFileInfo(dir).absolutePath();
+			struct stat st;
+			if (parent == dir || stat(QFile::encodeName(parent).constData(), &st) != 0 || st.st_dev != device)
+				return dir;
+			dir = parent;
+		}
+	}
+
+	//! Trash of the device as the freedesktop trash specification sets it, an empty path if there is none usable.
+	static TrashDir FindTrashDir(const QString& path, dev_t device) {
+		QString home = QDir(QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation)).absoluteFilePath("Trash");
+		QDir().mkpath(QFileInfo(home).absolutePath());
+		struct stat st;
+		if (stat(QFile::encodeName(QFileInfo(home).absolutePath()).constData(), &st) == 0 && st.st_dev == device) {
+			return MakeTrashDir(home) ? TrashDir{ home, QString() } : TrashDir();
+		}
+
+		QString topDir = TopDir(path, device);
+		QString uid = QString::number(getuid());
+		//! $topdir/.Trash set up by the administrator, only if it is a sticky directory and not a link.
+		QString shared = topDir + "/.Trash";
+		if (lstat(QFile::encodeName(shared).constData(), &st) == 0 && S_ISDIR(st.st_mode) && (st.st_mode & S_ISVTX)) {
+			if (MakeTrashDir(shared + "/" + uid))
+				return TrashDir{ shared + "/" + uid, topDir };
+		}
+		QString own = topDir + "/.Trash-" + uid;
+		if (MakeTrashDir(own) && lstat(QFile::encodeName(own).constData(), &st) == 0 && S_ISDIR(st.st_mode) && st.st_uid == getuid())
+			return TrashDir{ own, topDir };
+		return TrashDir();
+	}
+
+	//! Claims a name in the trash by creating its info file exclusively, returns the descriptor of the info file.
+	static int ClaimName(const TrashDir& trash, const QString& fileName, QHash<QString, int>& suffixes, QString& name) {
+		int& suffix = suffixes[fileName];
+		while (true) {
+			name = suffix == 0 ? fileName : QString("%1.%2").arg(fileName).arg(suffix + 1);
+			QByteArray info = QFile::encodeName(trash.path + "/info/" + name + ".trashinfo");
+			int fd = open(info.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+			if (fd >= 0 || errno != EEXIST)
+				return fd;
+			suffix++;
+		}
+	}
+
+	static void TrashBatch(const TrashDir& trash, const QFileInfoList& files,
+		const std::function<void(const QFileInfo&, const QString&, const QString&)>& trashed) {
+		QHash<QString, int> suffixes;
+		QStringList names;
+		QString date = QDateTime::currentDateTime().toString("yyyy-MM-ddThh:mm:ss");
+		for (const QFileInfo& file : files) {
+			QString name;
+			int fd = ClaimName(trash, file.fileName(), suffixes, name);
+			if (fd < 0) {
+				names << QString();
+				continue;
+			}
+			QString path = trash.topDir.isEmpty() ? file.absoluteFilePath() : QDir(trash.topDir).relativeFilePath(file.absoluteFilePath());
+			QByteArray info = "[Trash Info]\nPath=" + QUrl::toPercentEncoding(path, "/") + "\nDeletionDate=" + date.toUtf8() + "\n";
+			bool written = write(fd, info.constData(), info.size()) == info.size();
+			close(fd);
+			names << (written ? name : QString());
+		}
+
+		//! One sync of the info directory for the whole batch, the info must be there before the files move.
+		int dir = open(QFile::encodeName(trash.path + "/info").constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (dir >= 0) {
+			fsync(dir);
+			close(dir);
+		}
+
+		for (int i = 0; i < files.size(); i++) {
+			const QFileInfo& file = files[i];
+			if (names[i].isEmpty()) {
+				trashed(file, QString(), QObject::tr("Cannot write the trash info."));
+				continue;
+			}
+			QString target = trash.path + "/files/" + names[i];
+			if (rename(QFile::encodeName(file.absoluteFilePath()).constData(), QFile::encodeName(target).constData()) != 0) {
+				QString error = LastError();
+				QFile::remove(trash.path + "/info/" + names[i] + ".trashinfo");
+				trashed(file, QString(), error);
+				continue;
+			}
+			trashed(file, target, QString());
+		}
+	}
+
+	/************************************************************************************************************************
+	 * Class： Trash
+	 *
+	 *
+	/************************************************************************************************************************/
+	void Trash::MoveToTrash(const QFileInfoList& files,
+		const std::function<void(const QFileInfo& file, const QString& pathInTrash, const QString& error)>& trashed,
+		const std::function<bool()>& cancelled) {
+		//! Files are grouped by the trash of their device, the trash of a device is looked up once.
+		QHash<dev_t, TrashDir> trashDirs;
+		QHash<QString, QFileInfoList> groups;
+		QStringList order;
+		for (const QFileInfo& file : files) {
+			struct stat st;
+			if (lstat(QFile::encodeName(file.absoluteFilePath()).constData(), &st) != 0) {
+				trashed(file, QString(), LastError());
+				continue;
+			}
+			if (!trashDirs.contains(st.st_dev)) {
+				trashDirs[st.st_dev] = FindTrashDir(file.absoluteFilePath(), st.st_dev);
+			}
+			const TrashDir& trash = trashDirs[st.st_dev];
+			if (trash.path.isEmpty()) {
+				//! No trash on the device, Qt copies the file to the home trash.
+				QString pathInTrash;
+				bool flag = QFile::moveToTrash(file.absoluteFilePath(), &pathInTrash);
+				trashed(file, flag ? pathInTrash : QString(), flag ? QString() : QObject::tr("Cannot move to the trash."));
+				continue;
+			}
+			if (!groups.contains(trash.path)) {
+				order << trash.path;
+			}
+			groups[trash.path] << file;
+		}
+
+		QHash<QString, TrashDir> byPath;
+		for (const TrashDir& trash : trashDirs) {
+			byPath[trash.path] = trash;
+		}
+		for (const QString& path : order) {
+			const QFileInfoList& group = groups[path];
+			for (int i = 0; i < group.size() && !cancelled(); i += TrashBatchSize) {
+				TrashBatch(byPath[path], group.mid(i, TrashBatchSize), trashed);
+			}
+		}
+	}
+
+	//! Trash directory holding the file and the directory the relative paths of its infos start from.
+	static TrashDir TrashDirOf(const QString& pathInTrash) {
+		QDir files = QFileInfo(pathInTrash).absoluteDir();
+		QString path = QFileInfo(files.absolutePath()).absolutePath();
+		QString name = QFileInfo(path).fileName();
+		QString parent = QFileInfo(path).absolutePath();
+		if (name.startsWith(".Trash-"))
+			return TrashDir{ path, parent };
+		if (QFileInfo(parent).fileName() == ".Trash")
+			return TrashDir{ path, QFileInfo(parent).absolutePath() };
+		return TrashDir{ path, QString() };
+	}
+
+	QString Trash::OriginalPath(const QString& pathInTrash) {
+		TrashDir trash = TrashDirOf(pathInTrash);
+		QFile info(trash.path + "/info/" + QFileInfo(pathInTrash).fileName() + ".trashinfo");
+		if (!info.open(QIODevice::ReadOnly))
+			return QString();
+		while (!info.atEnd()) {
+			QByteArray line = info.readLine().trimmed();
+			if (!line.startsWith("Path="))
+				continue;
+			QString path = QString::fromUtf8(QByteArray::fromPercentEncoding(line.mid(5)));
+			if (QDir::isAbsolutePath(path))
+				return path;
+			return trash.topDir.isEmpty() ? QString() : QDir(trash.topDir).absoluteFilePath(path);
+		}
+		return QString();
+	}
+
+	bool Trash::Restore(const QString& pathInTrash, QString& original, QString& error) {
+		original = OriginalPath(pathInTrash);
+		if (original.isEmpty()) {
+			error = QObject::tr("No trash info for %1.").arg(pathInTrash);
+			return false;
+		}
+		QFileInfo target(original);
+		if (target.exists() || target.isSymLink()) {
+			error = QObject::tr("%1 exists.").arg(original);
+			return false;
+		}
+		QDir().mkpath(target.absolutePath());
+		if (rename(QFile::encodeName(pathInTrash).constData(), QFile::encodeName(original).constData()) != 0) {
+			error = LastError();
+			return false;
+		}
+		TrashDir trash = TrashDirOf(pathInTrash);
+		QFile::remove(trash.path + "/info/" + QFileInfo(pathInTrash).fileName() + ".trashinfo");
+		return true;
+	}
+#else
+	/************************************************************************************************************************
+	 * Class： Trash
+	 *
+	 *
+	/************************************************************************************************************************/
+	void Trash::MoveToTrash(const QFileInfoList& files,
+		const std::function<void(const QFileInfo& file, const QString& pathInTrash, const QString& error)>& trashed,
+		const std::function<bool()>& cancelled) {
+		for (const QFileInfo& file : files) {
+			if (cancelled())
+				break;
+			QString pathInTrash;
+			bool flag = QFile::moveToTrash(file.absoluteFilePath(), &pathInTrash);
+			trashed(file, flag ? pathInTrash : QString(), flag ? QString() : QObject::tr("Cannot move to the trash."));
+		}
+	}
+
+#ifdef Q_OS_WIN
+	//! The recycle bin keeps the original path in $I<id> beside the file $R<id>.
+	static QString InfoPath(const QString& pathInTrash) {
+		QFileInfo file(pathInTrash);
+		if (!file.fileName().startsWith("$R"))
+			return QString();
+		return file.absoluteDir().absoluteFilePath("$I" + file.fileName().mid(2));
+	}
+#endif
+
+	QString Trash::OriginalPath(const QString& pathInTrash) {
+#ifdef Q_OS_WIN
+		QFile info(InfoPath(pathInTrash));
+		if (!info.open(QIODevice::ReadOnly))
+			return QString();
+		//! Version, size and deletion time, then the path: 260 characters in version 1, length prefixed in version 2.
+		QByteArray data = info.readAll();
+		if (data.size() < 24)
+			return QString();
+		qint64 version = *reinterpret_cast<const qint64*>(data.constData());
+		const ushort* path = nullptr;
+		int length = 0;
+		if (version == 1 && data.size() >= 24 + 520) {
+			path = reinterpret_cast<const ushort*>(data.constData() + 24);
+			length = 260;
+		} else if (version == 2 && data.size() >= 28) {
+			length = *reinterpret_cast<const qint32*>(data.constData() + 24);
+			if (data.size() < 28 + length * 2)
+				return QString();
+			path = reinterpret_cast<const ushort*>(data.constData() + 28);
+		}
+		if (path == nullptr)
+			return QString();
+		QString original = QString::fromUtf16(path, length);
+		original.truncate(original.indexOf(QChar(0)) < 0 ? original.size() : original.indexOf(QChar(0)));
+		return QDir::fromNativeSeparators(original);
+#else
+		return QString();
+#endif
+	}
+
+	bool Trash::Restore(const QString& pathInTrash, QString& original, QString& error) {
+		original = OriginalPath(pathInTrash);
+		if (original.isEmpty()) {
+			error = QObject::tr("No trash info for %1.").arg(pathInTrash);
+			return false;
+		}
+		QFileInfo target(original);
+		if (target.exists()) {
+			error = QObject::tr("%1 exists.").arg(original);
+			return false;
+		}
+		QDir().mkpath(target.absolutePath());
+		if (!QDir().rename(pathInTrash, original)) {
+			error = QObject::tr("Cannot move %1 back.").arg(pathInTrash);
+			return false;
+		}
+#ifdef Q_OS_WIN
+		QFile::remove(InfoPath(pathInTrash));
+#endif
+		return true;
+	}
+#endif
+}
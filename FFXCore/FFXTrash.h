@@ -0,0 +1,26 @@
+#pragma once
+#include "FFXCore.h"
+
+#include <QString>
+#include <QFileInfo>
+
+#include <functional>
+
+namespace FFX {
+	/// <summary>
+	/// Trash of the system. On freedesktop systems the files go to the trash of their own mount, the home trash or
+	/// $topdir/.Trash-$uid, so they are always renamed and never copied, and the trash info files are written in batches.
+	/// Windows and macOS go through QFile::moveToTrash.
+	/// </summary>
+	class FFXCORE_EXPORT Trash {
+	public:
+		//! trashed is called for each file with its path in the trash, or an empty path and the error. Stops early once cancelled returns true.
+		static void MoveToTrash(const QFileInfoList& files,
+			const std::function<void(const QFileInfo& file, const QString& pathInTrash, const QString& error)>& trashed,
+			const std::function<bool()>& cancelled);
+		//! Where the file in the trash was trashed from, read from its trash info, empty if there is none.
+		static QString OriginalPath(const QString& pathInTrash);
+		//! Moves the file in the trash back to its original path and drops its trash info.
+		static bool Restore(const QString& pathInTrash, QString& original, QString& error);
+	};
+}
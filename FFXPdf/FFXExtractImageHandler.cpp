@@ -1,8 +1,10 @@
 #include "FFXExtractImageHandler.h"
+#include "FFXString.h"
 
 namespace FFX {
-	ExtractImageHandler::ExtractImageHandler(const QString& outputDir) {
+	ExtractImageHandler::ExtractImageHandler(const QString& outputDir, bool dedup) {
 		mArgMap["OutputDir"] = Argument("OutputDir", QObject::tr("Output Dir"), QObject::tr("Storage directory for images"), outputDir, Argument::Dir, true);
+		mArgMap["Deduplicate"] = Argument("Deduplicate", QObject::tr("Deduplicate"), QObject::tr("Skip images whose compressed data has already been extracted, default is true."), dedup, Argument::Bool);
 	}
 
 	std::shared_ptr<FileHandler> ExtractImageHandler::Clone() {
@@ -10,15 +12,19 @@ namespace FFX {
 	}
 
 	void ExtractImageHandler::Cancel() {
-
+		mCancelled = true;
 	}
 
 	QFileInfoList ExtractImageHandler::DoHandle(const QFileInfoList& files, ProgressPtr progress) {
 		int size = files.size();
 		QFileInfoList result;
+		mImageDigests.clear();
+		mDuplicateCount = 0;
+		mDuplicateBytes = 0;
 		for (int i = 0; i < size && !mCancelled; i++) {
 			QFileInfo file = files[i];
 			QString filePath = file.absoluteFilePath();
+			progress->OnProgress((i / (double)size) * 100, QObject::tr("Extracting images from: %1").arg(filePath));
 			pdf_document* doc = NULL;
 			fz_try(mContext) {
 				doc = pdf_open_document(mContext, filePath.toStdString().c_str());
@@ -27,7 +33,11 @@ namespace FFX {
 					pdf_obj* ref = pdf_new_indirect(mContext, doc, o, 0);
 					pdf_obj* type = pdf_dict_get(mContext, ref, PDF_NAME(Subtype));
 					if (pdf_name_eq(mContext, type, PDF_NAME(Image))) {
-						result << SaveImage(doc, ref);
+						QString image = SaveImage(doc, ref, file.completeBaseName());
+						if (!image.isEmpty()) {
+							result << image;
+							progress->OnFileComplete(file, image);
+						}
 					}
 					fz_empty_store(mContext);
 				}
@@ -36,13 +46,56 @@ namespace FFX {
 				pdf_drop_document(mContext, doc);
 			fz_catch(mContext) {
 				fz_report_error(mContext);
+				progress->OnFileComplete(file, file, false, QObject::tr("Extract images from %1 failed.").arg(filePath));
 			}
 		}
+		progress->OnComplete(true, QObject::tr("Finish, %1 images extracted, %2 duplicates skipped (%3 saved).")
+			.arg(result.size()).arg(mDuplicateCount).arg(String::BytesHint(mDuplicateBytes)));
 		return result;
 	}
 
-	QString ExtractImageHandler::SaveImage(pdf_document* doc, pdf_obj* ref) {
+	QByteArray ExtractImageHandler::ColorspaceKey(fz_colorspace* colorspace) {
+		if (colorspace == NULL)
+			return QByteArray("none");
+		QByteArray key = QByteArray(fz_colorspace_name(mContext, colorspace)) + "/" + QByteArray::number(fz_colorspace_n(mContext, colorspace));
+		//! Indexed images with the same index bytes are different images under different palettes.
+		if (fz_colorspace_is_indexed(mContext, colorspace)) {
+			fz_colorspace* base = colorspace->u.indexed.base;
+			int size = (colorspace->u.indexed.high + 1) * fz_colorspace_n(mContext, base);
+			key += "[" + ColorspaceKey(base) + "]" + QByteArray((const char*)colorspace->u.indexed.lookup, size);
+		}
+		return key;
+	}
+
+	QByteArray ExtractImageHandler::ImageDigest(fz_image* image) {
+		fz_compressed_buffer* cbuf = fz_compressed_image_buffer(mContext, image);
+		if (cbuf == NULL || cbuf->buffer == NULL)
+			return QByteArray();
+
+		unsigned char digest[16];
+		fz_md5_buffer(mContext, cbuf->buffer, digest);
+		QByteArray key((const char*)digest, sizeof(digest));
+		//! The same data with different geometry or decode parameters is a different image.
+		key += QByteArray::number(image->w) + "x" + QByteArray::number(image->h) + "x" + QByteArray::number(image->bpc)
+			+ ":" + QByteArray::number(image->n) + ":" + QByteArray::number(cbuf->params.type)
+			+ ":" + ColorspaceKey(image->colorspace);
+		//! The arrays are only read when their flags are set, the rest of them is garbage.
+		if (image->use_decode)
+			key += ":d" + QByteArray((const char*)image->decode, image->n * 2 * sizeof(image->decode[0]));
+		if (image->use_colorkey)
+			key += ":k" + QByteArray((const char*)image->colorkey, image->n * 2 * sizeof(image->colorkey[0]));
+		if (image->mask) {
+			QByteArray maskKey = ImageDigest(image->mask);
+			if (maskKey.isEmpty())
+				return QByteArray();
+			key += maskKey;
+		}
+		return key;
+	}
+
+	QString ExtractImageHandler::SaveImage(pdf_document* doc, pdf_obj* ref, const QString& prefix) {
 		QString outputDir = mArgMap["OutputDir"].Value().toString();
+		bool dedup = mArgMap["Deduplicate"].Value().toBool();
 
 		fz_image* image = NULL;
 		fz_pixmap* pix = NULL;
@@ -50,13 +103,25 @@ namespace FFX {
 		fz_compressed_buffer* cbuf;
 		int type;
 		QString file;
+		QByteArray digest;
+		//! Object numbers repeat across documents, the name of the source PDF keeps the images apart.
+		QString name = QString("%1-image-%2").arg(prefix, QString::number(pdf_to_num(mContext, ref)));
 
 		fz_var(image);
 		fz_var(pix);
 
 		fz_try(mContext) {
+			//! Loading keeps the image compressed, so duplicates are found before any decoding.
 			image = pdf_load_image(mContext, doc, ref);
 			cbuf = fz_compressed_image_buffer(mContext, image);
+			if (dedup) {
+				digest = ImageDigest(image);
+				if (!digest.isEmpty() && mImageDigests.contains(digest)) {
+					mDuplicateCount++;
+					mDuplicateBytes += fz_buffer_storage(mContext, cbuf->buffer, NULL);
+					break;
+				}
+			}
 			//fz_snprintf(buf, sizeof(buf), "image-%04d", pdf_to_num(mContext, ref));
 			type = cbuf == NULL ? FZ_IMAGE_UNKNOWN : cbuf->params.type;
 
@@ -74,7 +139,7 @@ namespace FFX {
 			if (type == FZ_IMAGE_JPEG) {
 				unsigned char* data;
 				size_t len = fz_buffer_storage(mContext, cbuf->buffer, &data);
-				file = QDir(outputDir).absoluteFilePath(QString("image-%1.jpg").arg(pdf_to_num(mContext, ref)));
+				file = QDir(outputDir).absoluteFilePath(name + ".jpg");
 				fz_output* out = fz_new_output_with_path(mContext, file.toStdString().c_str(), 0);
 				fz_write_data(mContext, out, data, len);
 				fz_close_output(mContext, out);
@@ -97,14 +162,17 @@ namespace FFX {
 					pix = rgb;
 				}
 				if (!pix->colorspace || pix->colorspace->type == FZ_COLORSPACE_GRAY || pix->colorspace->type == FZ_COLORSPACE_RGB) {
-					file = QDir(outputDir).absoluteFilePath(QString("image-%1.png").arg(pdf_to_num(mContext, ref)));
+					file = QDir(outputDir).absoluteFilePath(name + ".png");
 					fz_save_pixmap_as_png(mContext, pix, file.toStdString().c_str());
 				} else {
-					file = QDir(outputDir).absoluteFilePath(QString("image-%1.pam").arg(pdf_to_num(mContext, ref)));
+					file = QDir(outputDir).absoluteFilePath(name + ".pam");
 					fz_save_pixmap_as_pam(mContext, pix, file.toStdString().c_str());
 				}
 				fz_drop_pixmap(mContext, rgb);
 			}
+			//! Only a written image counts, a failed write leaves its copies to be extracted.
+			if (!digest.isEmpty())
+				mImageDigests << digest;
 		}
 		fz_always(mContext) {
 			fz_drop_image(mContext, image);
@@ -4,7 +4,7 @@
 namespace FFX {
 	class ExtractImageHandler : public PdfHandler {
 	public:
-		ExtractImageHandler(const QString& ouputDir);
+		ExtractImageHandler(const QString& ouputDir, bool dedup = true);
 
 	public:
 		virtual QString Name() override { return QStringLiteral("ExtractImageHandler"); }
@@ -17,9 +17,15 @@ namespace FFX {
 		virtual QFileInfoList DoHandle(const QFileInfoList& files, ProgressPtr progress) override;
 
 	private:
-		QString SaveImage(pdf_document* doc, pdf_obj* ref);
+		QString SaveImage(pdf_document* doc, pdf_obj* ref, const QString& prefix);
+		//! Digest of the compressed data of the image and its mask, empty if the image is not compressed.
+		QByteArray ImageDigest(fz_image* image);
+		QByteArray ColorspaceKey(fz_colorspace* colorspace);
 
 	private:
 		bool mCancelled = false;
+		QSet<QByteArray> mImageDigests;
+		int mDuplicateCount = 0;
+		qint64 mDuplicateBytes = 0;
 	};
 }
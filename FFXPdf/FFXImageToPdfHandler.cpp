@@ -1,5 +1,8 @@
 #include "FFXImageToPdfHandler.h"
 
+#include <QThread>
+#include <QThreadPool>
+
 namespace FFX {
 
 	ImageToPdfHandler::ImageToPdfHandler(const QString& outPdf, const QSize& size, const QRect& boundary, bool portrait, bool autoRotate, bool stretch) {
@@ -14,7 +17,7 @@ namespace FFX {
 	}
 
 	std::string ImageToPdfHandler::FilterExpression() {
-		return "*.png | *.jpg | *.jpeg | *.gif | *.bmp";
+		return "*.png | *.jpg | *.jpeg | *.gif | *.bmp | *.jp2 | *.jpx";
 	}
 
 	std::shared_ptr<FileHandler> ImageToPdfHandler::Clone() {
@@ -43,21 +46,44 @@ namespace FFX {
 		QString	out = mArgMap["OutPdf"].Value().toString();
 		bool portrait = mArgMap["Portrait"].Value().toBool();
 
+		int size = files.size();
+		int batch = QThread::idealThreadCount() * 2;
+		QVector<fz_image*> images;
+
+		fz_var(doc);
+		fz_var(images);
+
 		fz_try(mContext) {
 			doc = pdf_create_document(mContext);
-			int size = files.size();
 			char name[16];
-			for (int i = 0; i < size && !mCancelled; i++) {
-				QFileInfo file = files[i];
-				double p = (i / (double)size) * 100;
-				progress->OnProgress(p, QObject::tr("Writing image: %1").arg(file.absoluteFilePath()));
-				sprintf(name, "I%d", i + 1);
-				CreateImagePage(doc, file.absoluteFilePath().toStdString().c_str(), name, mediabox, portrait);
+			for (int from = 0; from < size && !mCancelled; from += batch) {
+				images.fill(NULL, (std::min)(batch, size - from));
+				LoadImages(files, from, images);
+				for (int j = 0; j < images.size(); j++) {
+					int i = from + j;
+					QFileInfo file = files[i];
+					fz_image* image = images[j];
+					images[j] = NULL;
+					if (image == NULL) {
+						progress->OnFileComplete(file, file, false, QObject::tr("Cannot load image: %1").arg(file.absoluteFilePath()));
+						continue;
+					}
+					double p = (i / (double)size) * 100;
+					progress->OnProgress(p, QObject::tr("Writing image: %1").arg(file.absoluteFilePath()));
+					sprintf(name, "I%d", i + 1);
+					bool success = !mCancelled && CreateImagePage(doc, image, name, mediabox, portrait);
+					fz_drop_image(mContext, image);
+					if (!success && !mCancelled) {
+						progress->OnFileComplete(file, file, false, QObject::tr("Cannot add image: %1").arg(file.absoluteFilePath()));
+					}
+				}
 			}
 			pdf_save_document(mContext, doc, out.toStdString().c_str(), &opts);
 			progress->OnFileComplete(files[0], out);
 		}
 		fz_always(mContext) {
+			for (fz_image* image : images)
+				fz_drop_image(mContext, image);
 			pdf_drop_document(mContext, doc);
 		}
 		fz_catch(mContext) {
@@ -70,7 +96,28 @@ namespace FFX {
 		return FileInfoList(out);
 	}
 
-	bool ImageToPdfHandler::CreateImagePage(pdf_document* doc, const char* image, const char* imageName, const fz_rect& pageSize, bool portrait) {
+	void ImageToPdfHandler::LoadImages(const QFileInfoList& files, int from, QVector<fz_image*>& images) {
+		QThreadPool workers;
+		for (int j = 0; j < images.size(); j++) {
+			std::string path = files[from + j].absoluteFilePath().toStdString();
+			fz_image** slot = &images[j];
+			workers.start([=]() {
+				fz_context* ctx = fz_clone_context(mContext);
+				if (ctx == NULL)
+					return;
+				fz_try(ctx) {
+					*slot = fz_new_image_from_file(ctx, path.c_str());
+				}
+				fz_catch(ctx) {
+					*slot = NULL;
+				}
+				fz_drop_context(ctx);
+				});
+		}
+		workers.waitForDone();
+	}
+
+	bool ImageToPdfHandler::CreateImagePage(pdf_document* doc, fz_image* image, const char* imageName, const fz_rect& pageSize, bool portrait) {
 		pdf_obj* resources = NULL;
 		fz_buffer* contents = NULL;
 		pdf_obj* page = NULL;
@@ -3,6 +3,7 @@
 
 #include <QRect>
 #include <QSize>
+#include <QVector>
 
 namespace FFX {
 	class ImageToPdfHandler : public PdfHandler {
@@ -22,7 +23,9 @@ namespace FFX {
 		virtual QFileInfoList DoHandle(const QFileInfoList& files, ProgressPtr progress) override;
 
 	private:
-		bool CreateImagePage(pdf_document* doc, const char* image, const char* imageName, const fz_rect& pageSize, bool portrait);
+		bool CreateImagePage(pdf_document* doc, fz_image* image, const char* imageName, const fz_rect& pageSize, bool portrait);
+		//! Load images[i] from files[from + i] on worker threads, only the headers are parsed, the image data stays compressed.
+		void LoadImages(const QFileInfoList& files, int from, QVector<fz_image*>& images);
 		fz_matrix CalcImageMatrix(int width, int height) const;
 
 	private:
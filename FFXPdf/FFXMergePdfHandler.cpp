@@ -143,11 +143,17 @@ namespace FFX {
 			fz_rethrow(ctx);
 	}
 
-	MergePdfHandler::MergePdfHandler(const QString& outPdf, bool compress) {
+	MergePdfHandler::MergePdfHandler(const QString& outPdf, bool compress, int storeLimit, int emptyStoreInterval, int flushInterval) {
 		mArgMap["OutPdf"] = Argument("OutPdf", QObject::tr("Output pdf"), QObject::tr("Output PDF file, absolute path."), outPdf, Argument::SaveFile, true);
 		mArgMap["OutPdf"].AddLimit("Pdf file(*.pdf)");
 
-		mArgMap["Compress"] = Argument("Compress", QObject::tr("Compress"), QObject::tr("Compress the output PDF file, default is false."), outPdf, Argument::Bool);
+		mArgMap["Compress"] = Argument("Compress", QObject::tr("Compress"), QObject::tr("Compress the output PDF file, default is false."), compress, Argument::Bool);
+		mArgMap["StoreLimit"] = Argument("StoreLimit", QObject::tr("Store Limit(MB)"), QObject::tr("Max size of the resource store in MB, 0 means unlimited, default is 0."), storeLimit);
+		mArgMap["StoreLimit"].AddLimit("^(0|[1-9]\\d{0,4})$");
+		mArgMap["EmptyStoreInterval"] = Argument("EmptyStoreInterval", QObject::tr("Empty Store Interval"), QObject::tr("Empty the resource store after every N source files, 0 means never, default is 0."), emptyStoreInterval);
+		mArgMap["EmptyStoreInterval"].AddLimit("^(0|[1-9]\\d*)$");
+		mArgMap["FlushInterval"] = Argument("FlushInterval", QObject::tr("Flush Interval"), QObject::tr("Write the merged pages to the output file after every N source files and release them from memory, 0 means save once at the end, default is 0."), flushInterval);
+		mArgMap["FlushInterval"].AddLimit("^(0|[1-9]\\d*)$");
 	}
 
 	void MergePdfHandler::Cancel() {
@@ -158,6 +164,13 @@ namespace FFX {
 		return FileHandlerPtr(new MergePdfHandler(*this));
 	}
 
+	size_t MergePdfHandler::StoreSize() {
+		int storeLimit = mArgMap["StoreLimit"].IntValue();
+		if (storeLimit <= 0)
+			return FZ_STORE_UNLIMITED;
+		return (size_t)storeLimit << 20;
+	}
+
 	QFileInfoList MergePdfHandler::DoHandle(const QFileInfoList& files, ProgressPtr progress) {
 		if (files.isEmpty()) {
 			progress->OnComplete(true, QObject::tr("Finished, nothing to do"));
@@ -165,12 +178,17 @@ namespace FFX {
 		}
 		QString	out = mArgMap["OutPdf"].Value().toString();
 		bool compress = mArgMap["Compress"].Value().toBool();
+		int emptyStoreInterval = mArgMap["EmptyStoreInterval"].IntValue();
+		int flushInterval = mArgMap["FlushInterval"].IntValue();
+		std::string outPath = out.toStdString();
 
 		pdf_write_options opts = pdf_default_write_options;
 		if (compress) {
 			opts.do_compress = opts.do_compress_images = opts.do_compress_fonts = 1;
 		}
 		pdf_document* doc_des = NULL;
+		mFlushed = false;
+		mTotalMergedPageCount = 0;
 
 		fz_try(mContext) {
 			doc_des = pdf_create_document(mContext);
@@ -180,6 +198,7 @@ namespace FFX {
 			return QFileInfoList();
 		}
 
+		int pending = 0;
 		int size = files.size();
 		for (int i = 0; i < size && !mCancelled; i++) {
 			QFileInfo file = files[i];
@@ -197,20 +216,58 @@ namespace FFX {
 			fz_catch(mContext) {
 				progress->OnFileComplete(file, file, false, QObject::tr("Merge %1 failed.").arg(filePath));
 			}
-		}
+			pending++;
 
-		fz_try(mContext) {
-			pdf_save_document(mContext, doc_des, out.toStdString().c_str(), &opts);
-			progress->OnFileComplete(files[0], out);
+			if (emptyStoreInterval > 0 && (i + 1) % emptyStoreInterval == 0) {
+				fz_empty_store(mContext);
+			}
+
+			if (flushInterval > 0 && pending >= flushInterval && i + 1 < size) {
+				progress->OnProgress(p, QObject::tr("Flushing merged pages to: %1").arg(out));
+				if (!Flush(doc_des, outPath, opts, true)) {
+					pdf_drop_document(mContext, doc_des);
+					progress->OnComplete(false, QObject::tr("Failed: Cannot save output file."));
+					return QFileInfoList();
+				}
+				pending = 0;
+			}
 		}
-		fz_catch(mContext) {
+
+		bool saved = Flush(doc_des, outPath, opts, false);
+		pdf_drop_document(mContext, doc_des);
+		if (!saved) {
 			progress->OnComplete(false, QObject::tr("Failed: Cannot save output file."));
 			return QFileInfoList();
 		}
+		progress->OnFileComplete(files[0], out);
 		progress->OnComplete(true, QObject::tr("Finish, The PDF file is stored in: %1").arg(out));
 		return FileInfoList(out);
 	}
 
+	bool MergePdfHandler::Flush(pdf_document*& doc, const std::string& path, const pdf_write_options& opts, bool reopen) {
+		pdf_write_options o = opts;
+		if (mFlushed) {
+			//! Incremental writing can not be combined with garbage collection.
+			o.do_incremental = 1;
+			o.do_garbage = 0;
+		}
+
+		fz_try(mContext) {
+			pdf_save_document(mContext, doc, path.c_str(), &o);
+			mFlushed = true;
+			if (reopen) {
+				pdf_drop_document(mContext, doc);
+				doc = NULL;
+				fz_empty_store(mContext);
+				doc = pdf_open_document(mContext, path.c_str());
+			}
+		}
+		fz_catch(mContext) {
+			return false;
+		}
+		return true;
+	}
+
 	void MergePdfHandler::Merge(pdf_document* doc_src, pdf_document* doc_des) {
 		int start, end, i, count;
 		pdf_graft_map* graft_map;
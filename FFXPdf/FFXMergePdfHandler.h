@@ -4,7 +4,7 @@
 namespace FFX {
 	class MergePdfHandler : public PdfHandler {
 	public:
-		MergePdfHandler(const QString& outPdf, bool compress = false);
+		MergePdfHandler(const QString& outPdf, bool compress = false, int storeLimit = 0, int emptyStoreInterval = 0, int flushInterval = 0);
 
 	public:
 		virtual QString Name() override { return QStringLiteral("MergePdfHandler"); }
@@ -15,12 +15,19 @@ namespace FFX {
 
 	protected:
 		virtual QFileInfoList DoHandle(const QFileInfoList& files, ProgressPtr progress) override;
+		virtual size_t StoreSize() override;
 
 	private:
 		void Merge(pdf_document* doc_src, pdf_document* doc_des);
+		/// <summary>
+		/// Save the merged document to path, the first flush writes the whole file, the later ones append an incremental section.
+		/// If reopen is true, the document is dropped and reopened from path, so the objects already written are released from memory.
+		/// </summary>
+		bool Flush(pdf_document*& doc, const std::string& path, const pdf_write_options& opts, bool reopen);
 
 	private:
 		bool mCancelled = false;
+		bool mFlushed = false;
 		int mTotalMergedPageCount = 0;
 	};
 }
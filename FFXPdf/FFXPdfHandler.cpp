@@ -2,6 +2,7 @@
 #include "FFXFileFilterExpr.h"
 #include <QFont>
 #include <QFontMetrics>
+#include <QMutex>
 
 namespace FFX {
 	QMap<QString, int> PositionMapping = {
@@ -16,6 +17,20 @@ namespace FFX {
 		{"center bottom", 8}
 	};
 
+	static void LockContext(void* user, int lock) {
+		static_cast<QMutex*>(user)[lock].lock();
+	}
+
+	static void UnlockContext(void* user, int lock) {
+		static_cast<QMutex*>(user)[lock].unlock();
+	}
+
+	PdfContextLocks::PdfContextLocks() {
+		locks.user = mutexes;
+		locks.lock = LockContext;
+		locks.unlock = UnlockContext;
+	}
+
 	PdfHandler::PdfHandler() {
 	}
 
@@ -29,6 +44,10 @@ namespace FFX {
 		return "*.pdf";
 	}
 
+	size_t PdfHandler::StoreSize() {
+		return FZ_STORE_UNLIMITED;
+	}
+
 	QFileInfoList PdfHandler::Filter(const QFileInfoList& files) {
 		if (mFilter == nullptr) {
 			FileFilterExpr expr(FilterExpression(), false);
@@ -63,7 +82,12 @@ namespace FFX {
 	}
 
 	bool PdfHandler::Init(ProgressPtr progress) {
-		mContext = fz_new_context(NULL, NULL, FZ_STORE_UNLIMITED);
+		if (mContext != nullptr) {
+			fz_drop_context(mContext);
+		}
+		//! Every root context has its own locks, shared only with the contexts cloned from it for the worker threads.
+		mLocks = std::make_shared<PdfContextLocks>();
+		mContext = fz_new_context(NULL, &mLocks->locks, StoreSize());
 		if (!mContext) {
 			progress->OnComplete(false, QObject::tr("Context initialise failed."));
 			return false;
@@ -166,26 +190,44 @@ namespace FFX {
 	}
 
 	fz_rect PdfHandler::AddImage(pdf_document* doc, pdf_obj* resources, const char* name, const char* path, int opacity) {
-		fz_image* image;
-		pdf_obj* subres, * ref;
+		fz_image* image = fz_new_image_from_file(mContext, path);
+		fz_rect rect;
+		fz_try(mContext) {
+			rect = AddImage(doc, resources, name, image, opacity);
+		}
+		fz_always(mContext) {
+			fz_drop_image(mContext, image);
+		}
+		fz_catch(mContext) {
+			fz_rethrow(mContext);
+		}
+		return rect;
+	}
 
-		image = fz_new_image_from_file(mContext, path);
+	fz_rect PdfHandler::AddImage(pdf_document* doc, pdf_obj* resources, const char* name, fz_image* image, int opacity) {
+		pdf_obj* subres, * ref;
 		fz_rect rect = { 0, 0, (float)image->w, (float)image->h };
 
 		fz_image* alphaImage = 0;
-		fz_pixmap* pix = fz_get_pixmap_from_image(mContext, image, NULL, NULL, 0, 0);
-		int alpha = fz_pixmap_alpha(mContext, pix);
-		if (alpha == 0) {
-			fz_pixmap* alphaPixmap = fz_new_pixmap_with_bbox(mContext, pix->colorspace, fz_pixmap_bbox(mContext, pix), 0, 1);
-			ClonePixmapAndSetAlpha(mContext, alphaPixmap, pix, opacity);
-			alphaImage = fz_new_image_from_pixmap(mContext, alphaPixmap, 0);
-			fz_drop_pixmap(mContext, alphaPixmap);
+		fz_compressed_buffer* cbuf = fz_compressed_image_buffer(mContext, image);
+		int type = cbuf == NULL ? FZ_IMAGE_UNKNOWN : cbuf->params.type;
+		if (opacity == 255 && (type == FZ_IMAGE_JPEG || type == FZ_IMAGE_JPX || type == FZ_IMAGE_FAX)) {
+			//! pdf_add_image writes the compressed data directly, no decoding needed.
+			alphaImage = fz_keep_image(mContext, image);
 		} else {
-			SetAlpha(mContext, pix, opacity);
-			alphaImage = fz_new_image_from_pixmap(mContext, pix, 0);
+			fz_pixmap* pix = fz_get_pixmap_from_image(mContext, image, NULL, NULL, 0, 0);
+			int alpha = fz_pixmap_alpha(mContext, pix);
+			if (alpha == 0) {
+				fz_pixmap* alphaPixmap = fz_new_pixmap_with_bbox(mContext, pix->colorspace, fz_pixmap_bbox(mContext, pix), 0, 1);
+				ClonePixmapAndSetAlpha(mContext, alphaPixmap, pix, opacity);
+				alphaImage = fz_new_image_from_pixmap(mContext, alphaPixmap, 0);
+				fz_drop_pixmap(mContext, alphaPixmap);
+			} else {
+				SetAlpha(mContext, pix, opacity);
+				alphaImage = fz_new_image_from_pixmap(mContext, pix, 0);
+			}
+			fz_drop_pixmap(mContext, pix);
 		}
-		fz_drop_image(mContext, image);
-		fz_drop_pixmap(mContext, pix);
 		subres = pdf_dict_get(mContext, resources, PDF_NAME(XObject));
 		if (!subres) {
 			subres = pdf_new_dict(mContext, doc, 10);
@@ -6,9 +6,19 @@
 #include "mupdf/fitz.h"
 #include "mupdf/pdf.h"
 
+#include <QMutex>
+#include <memory>
+
 namespace FFX {
 	extern QMap<QString, int> PositionMapping;
 
+	//! Lock functions of a mupdf context and the mutexes they lock.
+	struct PdfContextLocks {
+		PdfContextLocks();
+		fz_locks_context locks;
+		QMutex mutexes[FZ_LOCK_MAX];
+	};
+
 	class PdfHandler : public FileHandler {
 	public:
 		PdfHandler();
@@ -20,6 +30,8 @@ namespace FFX {
 
 	public:
 		fz_rect AddImage(pdf_document* doc, pdf_obj* resources, const char* name, const char* path, int opacity = 255);
+		//! JPEG/JPX/CCITT data is embedded as is when the opacity is not changed, other images are decoded and re-encoded.
+		fz_rect AddImage(pdf_document* doc, pdf_obj* resources, const char* name, fz_image* image, int opacity = 255);
 		fz_rect MakeTjStr(const QString& content, QString& tjstr, const char* ansifont, const char* cjkfont, int fontsize);
 		void AddCjkFont(pdf_document* doc, pdf_obj* resources, const char* name, const char* lang, const char* wm, const char* style);
 		void AddFont(pdf_document* doc, pdf_obj* resources, const char* name, const char* path, const char* encname);
@@ -28,10 +40,14 @@ namespace FFX {
 	protected:
 		bool Init(ProgressPtr progress);
 		virtual std::string FilterExpression();
+		//! Max size of the resource store of the context, FZ_STORE_UNLIMITED by default.
+		virtual size_t StoreSize();
 		virtual QFileInfoList DoHandle(const QFileInfoList& files, ProgressPtr progress) = 0;
 
 	protected:
 		fz_context* mContext = nullptr;
+		//! Outlives the context, which is dropped in the destructor body.
+		std::shared_ptr<PdfContextLocks> mLocks;
 		FileFilterPtr mFilter;
 	};
 	
@@ -11,12 +11,17 @@
 #include "FFXPdfToImageHandler.h"
 #include "FFXHandlerSettingDialog.h"
 #include "FFXAddWatermarkToPdfHandler.h"
+#include "FFXPdfThumbnail.h"
+#include "FFXPdfTextIndexHandler.h"
+#include "FFXFileQuickView.h"
 
 #include <QMenu>
 #include <QAction>
 #include <QVector4D>
 #include <QTranslator>
 #include <QCoreApplication>
+#include <QStandardPaths>
+#include <QDir>
 #include <QDebug>
 
 namespace FFX {
@@ -34,6 +39,10 @@ namespace FFX {
 	PdfPlugin::~PdfPlugin()	{}
 
 	void PdfPlugin::SetupUi() {
+		QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+		QDir().mkpath(cacheDir);
+		mThumbnailService = new PdfThumbnailService(cacheDir, this);
+
 		mPdfMenu = new QMenu(QObject::tr("&PDF"));
 		mImageToPdfAction = new QAction(QObject::tr("Images to PDF"));
 		mImageToPdfActionOnClipboardPanel = new QAction(QObject::tr("Images to PDF"));
@@ -47,6 +56,8 @@ namespace FFX {
 		mExtractImageActionOnClipboardPanel = new QAction(QObject::tr("Extract Images"));
 		mPdfToImageAction = new QAction(QObject::tr("Pdf to Images"));
 		mPdfToImageActionOnClipboardPanel = new QAction(QObject::tr("Pdf to Images"));
+		mTextIndexAction = new QAction(QObject::tr("Build Text Index"));
+		mTextIndexActionOnClipboardPanel = new QAction(QObject::tr("Build Text Index"));
 
 		connect(mImageToPdfAction, &QAction::triggered, this, &PdfPlugin::OnImageToPdfAction);
 		connect(mImageToPdfActionOnClipboardPanel, &QAction::triggered, this, []() {
@@ -76,6 +87,11 @@ namespace FFX {
 		connect(mPdfToImageAction, &QAction::triggered, this, &PdfPlugin::OnPdfToImageAction);
 		connect(mPdfToImageActionOnClipboardPanel, &QAction::triggered, this, &PdfPlugin::OnPdfToImageActionOnClipboardPanel);
 
+		connect(mTextIndexAction, &QAction::triggered, this, &PdfPlugin::OnTextIndexAction);
+		connect(mTextIndexActionOnClipboardPanel, &QAction::triggered, this, []() {
+			HandlerSettingDialog dialog(std::make_shared<PdfTextIndexHandler>(), false);
+			dialog.exec(); });
+
 		mPdfMenu->addAction(mImageToPdfAction);
 		mPdfMenu->addAction(mMergePdfAction);
 		QMenu* watermarkMenu = new QMenu(QObject::tr("Add Watermark"));
@@ -84,6 +100,7 @@ namespace FFX {
 		mPdfMenu->addAction(watermarkMenu->menuAction());
 		mPdfMenu->addAction(mExtractImageAction);
 		mPdfMenu->addAction(mPdfToImageAction);
+		mPdfMenu->addAction(mTextIndexAction);
 
 		mPdfMenuInClipboard = App()->ClipboardPanelPtr()->Header()->AddMenuAction("PDF");
 		mPdfMenuInClipboard->addAction(mImageToPdfActionOnClipboardPanel);
@@ -94,16 +111,19 @@ namespace FFX {
 		mPdfMenuInClipboard->addAction(watermarkMenuOnClipboardPanel->menuAction());
 		mPdfMenuInClipboard->addAction(mExtractImageActionOnClipboardPanel);
 		mPdfMenuInClipboard->addAction(mPdfToImageActionOnClipboardPanel);
+		mPdfMenuInClipboard->addAction(mTextIndexActionOnClipboardPanel);
 	}
 
 	void PdfPlugin::Install() {
 		App()->AddMenu(mPdfMenu);
 		App()->FileMainViewPtr()->AddContextMenu(mPdfMenu);
+		App()->FileMainViewPtr()->FileQuickViewPtr()->PreviewPanelPtr()->AddProvider(mThumbnailService);
 	}
 
 	void PdfPlugin::Uninstall() {
 		App()->RemoveMenu(mPdfMenu);
 		App()->ClipboardPanelPtr()->Header()->RemoveMenu(mPdfMenuInClipboard);
+		App()->FileMainViewPtr()->FileQuickViewPtr()->PreviewPanelPtr()->RemoveProvider(mThumbnailService);
 	}
 
 	void PdfPlugin::OnImageToPdfAction() {
@@ -150,5 +170,9 @@ namespace FFX {
 		HandlerSettingDialog dialog(std::make_shared<PdfToImageHandler>("E:/新文件夹"), false);
 		dialog.exec();
 	}
-}
 
+	void PdfPlugin::OnTextIndexAction() {
+		HandlerSettingDialog dialog(std::make_shared<PdfTextIndexHandler>());
+		dialog.exec();
+	}
+}
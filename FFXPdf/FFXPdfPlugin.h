@@ -6,6 +6,8 @@ class QAction;
 class QTranslator;
 
 namespace FFX {
+	class PdfThumbnailService;
+
 	class PdfPlugin : public QObject, public Plugin	{
 		Q_OBJECT
 		Q_PLUGIN_METADATA(IID FFX_Plugin_IID)
@@ -31,9 +33,11 @@ namespace FFX {
 		void OnExtractImageAction();
 		void OnPdfToImageAction();
 		void OnPdfToImageActionOnClipboardPanel();
+		void OnTextIndexAction();
 
 	private:
 		QTranslator* mTranslator;
+		PdfThumbnailService* mThumbnailService;
 		QMenu* mPdfMenu;
 		QMenu* mPdfMenuInClipboard;
 		QAction* mImageToPdfAction;
@@ -48,6 +52,8 @@ namespace FFX {
 		QAction* mExtractImageActionOnClipboardPanel;
 		QAction* mPdfToImageAction;
 		QAction* mPdfToImageActionOnClipboardPanel;
+		QAction* mTextIndexAction;
+		QAction* mTextIndexActionOnClipboardPanel;
 	};
 
 }
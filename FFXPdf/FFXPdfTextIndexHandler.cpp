@@ -0,0 +1,184 @@
+#include "FFXPdfTextIndexHandler.h"
+#include "FFXContentIndex.h"
+
+#include <QDirIterator>
+#include <QThread>
+#include <QThreadPool>
+#include <QDateTime>
+#include <QVector>
+
+namespace FFX {
+	//! Root of the index covering dir: searching uses the nearest index above a file, a new index next to a single file
+	//! would hide the tree index above it from the other files of the directory.
+	static QString IndexRoot(const QString& dir) {
+		QDir d(dir);
+		do {
+			if (d.exists(ContentIndex::IndexFileName()))
+				return d.absolutePath();
+		} while (d.cdUp());
+		return dir;
+	}
+
+	PdfTextIndexHandler::PdfTextIndexHandler(bool rebuild) {
+		mArgMap["Rebuild"] = Argument("Rebuild", QObject::tr("Rebuild"), QObject::tr("Ignore the existing index and extract all files again, default is false."), rebuild, Argument::Bool);
+	}
+
+	std::shared_ptr<FileHandler> PdfTextIndexHandler::Clone() {
+		return FileHandlerPtr(new PdfTextIndexHandler(*this));
+	}
+
+	void PdfTextIndexHandler::Cancel() {
+		mCancelled = true;
+	}
+
+	QFileInfoList PdfTextIndexHandler::Filter(const QFileInfoList& files) {
+		QFileInfoList filesTodo;
+		for (const QFileInfo& file : files) {
+			if (file.isDir() || file.suffix().compare("pdf", Qt::CaseInsensitive) == 0) {
+				filesTodo << file;
+			}
+		}
+		return filesTodo;
+	}
+
+	QFileInfoList PdfTextIndexHandler::DoHandle(const QFileInfoList& files, ProgressPtr progress) {
+		bool rebuild = mArgMap["Rebuild"].Value().toBool();
+
+		//! Index root -> pdf files, whether the root is indexed as a whole tree.
+		QMap<QString, QFileInfoList> roots;
+		QSet<QString> treeRoots;
+		for (const QFileInfo& file : files) {
+			if (file.isDir()) {
+				QString root = file.absoluteFilePath();
+				treeRoots << root;
+				QDirIterator it(root, QStringList() << "*.pdf", QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+				while (it.hasNext() && !mCancelled) {
+					it.next();
+					roots[root] << it.fileInfo();
+				}
+				roots[root];
+			} else {
+				roots[IndexRoot(file.absolutePath())] << file;
+			}
+		}
+
+		int total = 0;
+		for (const QFileInfoList& pdfs : roots)
+			total += pdfs.size();
+
+		QFileInfoList result;
+		int handled = 0;
+		int extracted = 0;
+		int batch = QThread::idealThreadCount() * 2;
+		for (auto it = roots.begin(); it != roots.end() && !mCancelled; it++) {
+			QString indexFile = QDir(it.key()).absoluteFilePath(ContentIndex::IndexFileName());
+			ContentIndex index(it.key());
+			if (!rebuild) {
+				index.Load(indexFile);
+			}
+
+			//! Drop the documents which no longer exist in the tree.
+			if (treeRoots.contains(it.key())) {
+				for (const QString& doc : index.Documents()) {
+					if (!QFileInfo::exists(doc))
+						index.Remove(doc);
+				}
+			}
+
+			QFileInfoList todo;
+			for (const QFileInfo& pdf : it.value()) {
+				if (!index.IsUpToDate(pdf.absoluteFilePath(), pdf.lastModified().toMSecsSinceEpoch()))
+					todo << pdf;
+				else
+					handled++;
+			}
+
+			for (int from = 0; from < todo.size() && !mCancelled; from += batch) {
+				int count = (std::min)(batch, todo.size() - from);
+				QVector<QStringList> terms(count);
+				QVector<bool> success(count, false);
+				QThreadPool workers;
+				for (int j = 0; j < count; j++) {
+					QString pdf = todo[from + j].absoluteFilePath();
+					QStringList* termSlot = &terms[j];
+					bool* successSlot = &success[j];
+					workers.start([=]() {
+						if (mCancelled)
+							return;
+						*successSlot = ExtractTerms(pdf, *termSlot);
+						});
+				}
+				workers.waitForDone();
+
+				for (int j = 0; j < count; j++) {
+					const QFileInfo& pdf = todo[from + j];
+					handled++;
+					progress->OnProgress(handled * 100.0 / total, QObject::tr("Indexing: %1").arg(pdf.absoluteFilePath()));
+					if (!success[j]) {
+						progress->OnFileComplete(pdf, pdf, false, QObject::tr("Cannot extract text from %1.").arg(pdf.absoluteFilePath()));
+						continue;
+					}
+					index.Update(pdf.absoluteFilePath(), pdf.lastModified().toMSecsSinceEpoch(), terms[j]);
+					extracted++;
+				}
+			}
+
+			if (index.Save(indexFile)) {
+				result << QFileInfo(indexFile);
+				progress->OnFileComplete(QFileInfo(it.key()), QFileInfo(indexFile));
+			} else {
+				progress->OnFileComplete(QFileInfo(it.key()), QFileInfo(indexFile), false, QObject::tr("Cannot write index file %1.").arg(indexFile));
+			}
+		}
+
+		progress->OnComplete(true, QObject::tr("Finish, %1 files indexed, %2 files extracted.").arg(handled).arg(extracted));
+		return result;
+	}
+
+	bool PdfTextIndexHandler::ExtractTerms(const QString& pdf, QStringList& terms) {
+		fz_context* ctx = fz_clone_context(mContext);
+		if (ctx == NULL)
+			return false;
+
+		bool success = true;
+		pdf_document* doc = NULL;
+		fz_page* page = NULL;
+		fz_stext_page* text = NULL;
+		fz_buffer* buf = NULL;
+		fz_var(doc);
+		fz_var(page);
+		fz_var(text);
+		fz_var(buf);
+		fz_try(ctx) {
+			QString content;
+			doc = pdf_open_document(ctx, pdf.toStdString().c_str());
+			int count = pdf_count_pages(ctx, doc);
+			for (int i = 0; i < count && !mCancelled; i++) {
+				page = fz_load_page(ctx, (fz_document*)doc, i);
+				text = fz_new_stext_page_from_page(ctx, page, NULL);
+				buf = fz_new_buffer_from_stext_page(ctx, text);
+				content += QString::fromUtf8(fz_string_from_buffer(ctx, buf));
+				content += '\n';
+				fz_drop_buffer(ctx, buf);
+				buf = NULL;
+				fz_drop_stext_page(ctx, text);
+				text = NULL;
+				fz_drop_page(ctx, page);
+				page = NULL;
+			}
+			terms = ContentIndex::Tokenize(content);
+		}
+		fz_always(ctx) {
+			fz_drop_buffer(ctx, buf);
+			fz_drop_stext_page(ctx, text);
+			fz_drop_page(ctx, page);
+			pdf_drop_document(ctx, doc);
+		}
+		fz_catch(ctx) {
+			terms.clear();
+			success = false;
+		}
+		fz_drop_context(ctx);
+		return success;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "FFXPdfHandler.h"
+
+namespace FFX {
+	/// <summary>
+	/// Extracts the text of PDF files in parallel and writes a content index, which is used by the
+	/// "content:" terms of file search. A directory argument is indexed as a whole tree with the index
+	/// in its root, PDF file arguments are indexed in their parent directory. Only the files modified
+	/// since the last run are extracted again.
+	/// </summary>
+	class PdfTextIndexHandler : public PdfHandler {
+	public:
+		PdfTextIndexHandler(bool rebuild = false);
+
+	public:
+		virtual QFileInfoList Filter(const QFileInfoList& files) override;
+		virtual QString Name() override { return QStringLiteral("PdfTextIndexHandler"); }
+		virtual std::shared_ptr<FileHandler> Clone() override;
+		virtual void Cancel() override;
+		virtual QString DisplayName() override { return QObject::tr("Build Text Index"); }
+		virtual QString Description() override { return QObject::tr("Extract the text of PDF files to make their content searchable."); }
+
+	protected:
+		virtual QFileInfoList DoHandle(const QFileInfoList& files, ProgressPtr progress) override;
+
+	private:
+		//! Terms of the text of all pages of the pdf, extracted with a clone of the context.
+		bool ExtractTerms(const QString& pdf, QStringList& terms);
+
+	private:
+		bool mCancelled = false;
+	};
+}
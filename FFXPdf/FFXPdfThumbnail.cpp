@@ -0,0 +1,242 @@
+#include "FFXPdfThumbnail.h"
+
+#include <QFile>
+#include <QDir>
+#include <QBuffer>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <QMutexLocker>
+#include <QtEndian>
+
+namespace FFX {
+	static const QByteArray PackMagic("FFXTPK01");
+	static const int PackKeySize = 20;
+
+	/************************************************************************************************************************
+	 * Class： ThumbnailPack
+	 *
+	 *
+	/************************************************************************************************************************/
+	ThumbnailPack::ThumbnailPack(const QString& packFile, qint64 maxSize)
+		: mPackFile(packFile)
+		, mMaxSize(maxSize) {
+		Load();
+	}
+
+	QByteArray ThumbnailPack::Key(const QFileInfo& file, int page, const QSize& size) {
+		QCryptographicHash hash(QCryptographicHash::Sha1);
+		hash.addData(file.absoluteFilePath().toUtf8());
+		hash.addData(QByteArray::number(file.lastModified().toMSecsSinceEpoch()));
+		hash.addData(QByteArray::number(file.size()));
+		hash.addData(QByteArray::number(page));
+		hash.addData(QByteArray::number(size.width()) + "x" + QByteArray::number(size.height()));
+		return hash.result();
+	}
+
+	void ThumbnailPack::Load() {
+		QMutexLocker locker(&mMutex);
+		mIndex.clear();
+		mPackSize = 0;
+
+		QFile pack(mPackFile);
+		if (!pack.exists()) {
+			return;
+		}
+		if (!pack.open(QIODevice::ReadOnly) || pack.read(PackMagic.size()) != PackMagic) {
+			pack.close();
+			pack.remove();
+			return;
+		}
+
+		qint64 pos = PackMagic.size();
+		qint64 total = pack.size();
+		while (pos + PackKeySize + 4 <= total) {
+			QByteArray key = pack.read(PackKeySize);
+			QByteArray len = pack.read(4);
+			quint32 length = qFromLittleEndian<quint32>(len.constData());
+			qint64 offset = pos + PackKeySize + 4;
+			if (offset + length > total)
+				break;
+			mIndex[key] = qMakePair(offset, length);
+			pos = offset + length;
+			pack.seek(pos);
+		}
+		pack.close();
+
+		//! Drop the tail of a record that was not completely written.
+		if (pos < total) {
+			pack.resize(pos);
+		}
+		mPackSize = pos;
+	}
+
+	void ThumbnailPack::Reset() {
+		mIndex.clear();
+		mPackSize = 0;
+		QFile::remove(mPackFile);
+	}
+
+	bool ThumbnailPack::Get(const QByteArray& key, QImage& image) {
+		QMutexLocker locker(&mMutex);
+		auto it = mIndex.find(key);
+		if (it == mIndex.end())
+			return false;
+
+		QFile pack(mPackFile);
+		if (!pack.open(QIODevice::ReadOnly) || !pack.seek(it.value().first))
+			return false;
+		QByteArray data = pack.read(it.value().second);
+		return image.loadFromData(data, "PNG");
+	}
+
+	void ThumbnailPack::Put(const QByteArray& key, const QImage& image) {
+		QByteArray data;
+		QBuffer buffer(&data);
+		buffer.open(QIODevice::WriteOnly);
+		if (!image.save(&buffer, "PNG"))
+			return;
+
+		QMutexLocker locker(&mMutex);
+		if (mIndex.contains(key))
+			return;
+		if (mPackSize + data.size() > mMaxSize) {
+			Reset();
+		}
+
+		QFile pack(mPackFile);
+		if (!pack.open(QIODevice::WriteOnly | QIODevice::Append))
+			return;
+		if (pack.size() == 0) {
+			pack.write(PackMagic);
+		}
+		char len[4];
+		qToLittleEndian<quint32>(data.size(), len);
+		qint64 offset = pack.size() + PackKeySize + 4;
+		pack.write(key);
+		pack.write(len, 4);
+		pack.write(data);
+		pack.close();
+
+		mIndex[key] = qMakePair(offset, (quint32)data.size());
+		mPackSize = offset + data.size();
+	}
+
+	/************************************************************************************************************************
+	 * Class： PdfThumbnailService
+	 *
+	 *
+	/************************************************************************************************************************/
+	static void LockThumbnailContext(void* user, int lock) {
+		static_cast<QMutex*>(user)[lock].lock();
+	}
+
+	static void UnlockThumbnailContext(void* user, int lock) {
+		static_cast<QMutex*>(user)[lock].unlock();
+	}
+
+	PdfThumbnailService::PdfThumbnailService(const QString& cacheDir, QObject* parent)
+		: FilePreviewProvider(parent)
+		, mPack(QDir(cacheDir).absoluteFilePath("pdf-thumbnails.pack")) {
+		mLocks.user = mLockMutexes;
+		mLocks.lock = LockThumbnailContext;
+		mLocks.unlock = UnlockThumbnailContext;
+		mContext = fz_new_context(NULL, &mLocks, 64 << 20);
+		//! Leave the global pool to the task panel.
+		mWorkers.setMaxThreadCount(2);
+	}
+
+	PdfThumbnailService::~PdfThumbnailService() {
+		mWorkers.clear();
+		mWorkers.waitForDone();
+		if (mContext != nullptr) {
+			fz_drop_context(mContext);
+		}
+	}
+
+	bool PdfThumbnailService::Accept(const QFileInfo& file) {
+		return file.suffix().compare("pdf", Qt::CaseInsensitive) == 0;
+	}
+
+	void PdfThumbnailService::Request(const QFileInfo& file, const QSize& size) {
+		if (mContext == nullptr)
+			return;
+
+		QByteArray key = ThumbnailPack::Key(file, 0, size);
+		{
+			QMutexLocker locker(&mPendingMutex);
+			if (mPending.contains(key))
+				return;
+			mPending << key;
+		}
+
+		mWorkers.start([=]() {
+			QImage image = Thumbnail(file, 0, size);
+			{
+				QMutexLocker locker(&mPendingMutex);
+				mPending.remove(key);
+			}
+			if (!image.isNull()) {
+				emit PreviewReady(file.absoluteFilePath(), image);
+			}
+			});
+	}
+
+	QImage PdfThumbnailService::Thumbnail(const QFileInfo& file, int page, const QSize& size) {
+		QImage image;
+		QByteArray key = ThumbnailPack::Key(file, page, size);
+		if (mPack.Get(key, image))
+			return image;
+
+		image = Render(file, page, size);
+		if (!image.isNull()) {
+			mPack.Put(key, image);
+		}
+		return image;
+	}
+
+	QImage PdfThumbnailService::Render(const QFileInfo& file, int page, const QSize& size) {
+		QImage image;
+		fz_context* ctx = fz_clone_context(mContext);
+		if (ctx == nullptr)
+			return image;
+
+		pdf_document* doc = NULL;
+		fz_page* pg = NULL;
+		fz_display_list* list = NULL;
+		fz_pixmap* pix = NULL;
+		fz_var(doc);
+		fz_var(pg);
+		fz_var(list);
+		fz_var(pix);
+		fz_try(ctx) {
+			doc = pdf_open_document(ctx, file.absoluteFilePath().toStdString().c_str());
+			pg = fz_load_page(ctx, (fz_document*)doc, page);
+			list = fz_new_display_list_from_page(ctx, pg);
+			//! The page is no longer needed once it is recorded in the display list.
+			fz_drop_page(ctx, pg);
+			pg = NULL;
+
+			fz_rect bounds = fz_bound_display_list(ctx, list);
+			float w = bounds.x1 - bounds.x0;
+			float h = bounds.y1 - bounds.y0;
+			float scale = 1.0f;
+			if (w > 0 && h > 0) {
+				scale = qMin(size.width() / w, size.height() / h);
+			}
+			pix = fz_new_pixmap_from_display_list(ctx, list, fz_scale(scale, scale), fz_device_rgb(ctx), 0);
+			image = QImage(fz_pixmap_samples(ctx, pix), fz_pixmap_width(ctx, pix), fz_pixmap_height(ctx, pix),
+				fz_pixmap_stride(ctx, pix), QImage::Format_RGB888).copy();
+		}
+		fz_always(ctx) {
+			fz_drop_pixmap(ctx, pix);
+			fz_drop_display_list(ctx, list);
+			fz_drop_page(ctx, pg);
+			pdf_drop_document(ctx, doc);
+		}
+		fz_catch(ctx) {
+			image = QImage();
+		}
+		fz_drop_context(ctx);
+		return image;
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "FFXFileQuickView.h"
+
+//! Mupdf library
+#include "mupdf/fitz.h"
+#include "mupdf/pdf.h"
+
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QThreadPool>
+
+namespace FFX {
+	/// <summary>
+	/// An append-only pack file of PNG encoded thumbnails.
+	/// Layout: 8 bytes magic, then records of [20 bytes key][4 bytes length][PNG data].
+	/// The index is rebuilt by scanning the records when the pack is opened, the pack is
+	/// dropped and restarted once it grows beyond the max size.
+	/// </summary>
+	class ThumbnailPack {
+	public:
+		ThumbnailPack(const QString& packFile, qint64 maxSize = 256 << 20);
+
+	public:
+		//! The key changes whenever the file is modified, so stale thumbnails are never served.
+		static QByteArray Key(const QFileInfo& file, int page, const QSize& size);
+
+	public:
+		bool Get(const QByteArray& key, QImage& image);
+		void Put(const QByteArray& key, const QImage& image);
+
+	private:
+		void Load();
+		void Reset();
+
+	private:
+		QString mPackFile;
+		qint64 mMaxSize;
+		qint64 mPackSize = 0;
+		QHash<QByteArray, QPair<qint64, quint32>> mIndex;
+		QMutex mMutex;
+	};
+
+	/// <summary>
+	/// Renders page thumbnails of PDF files on a worker pool through display lists, every worker
+	/// clones the shared context so the resource store is shared between them. Rendered thumbnails
+	/// are kept in a ThumbnailPack keyed by file path, mtime, page and size.
+	/// </summary>
+	class PdfThumbnailService : public FilePreviewProvider {
+		Q_OBJECT
+	public:
+		PdfThumbnailService(const QString& cacheDir, QObject* parent = nullptr);
+		~PdfThumbnailService();
+
+	public:
+		virtual bool Accept(const QFileInfo& file) override;
+		virtual void Request(const QFileInfo& file, const QSize& size) override;
+
+	public:
+		//! Synchronous version, returns the cached thumbnail or renders it.
+		QImage Thumbnail(const QFileInfo& file, int page, const QSize& size);
+
+	private:
+		QImage Render(const QFileInfo& file, int page, const QSize& size);
+
+	private:
+		fz_context* mContext = nullptr;
+		fz_locks_context mLocks;
+		QMutex mLockMutexes[FZ_LOCK_MAX];
+		ThumbnailPack mPack;
+		QThreadPool mWorkers;
+		QMutex mPendingMutex;
+		QSet<QByteArray> mPending;
+	};
+}
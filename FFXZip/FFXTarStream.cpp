@@ -0,0 +1,383 @@
+#include "FFXTarStream.h"
+
+#include <QObject>
+#include <QDir>
+#include <QFile>
+#include <QDateTime>
+#include <QMutexLocker>
+
+#include <cstring>
+#include <algorithm>
+
+namespace FFX {
+	static const int TarBlockSize = 512;
+	static const qint64 MaxHeaderDataSize = 1 << 20;
+
+	static qint64 TarNumber(const char* field, int size) {
+		//! GNU base-256 encoding for values that do not fit in octal.
+		if ((unsigned char)field[0] & 0x80) {
+			qint64 value = (unsigned char)field[0] & 0x7f;
+			for (int i = 1; i < size; i++)
+				value = (value << 8) | (unsigned char)field[i];
+			return value;
+		}
+		qint64 value = 0;
+		int i = 0;
+		while (i < size && (field[i] == ' ' || field[i] == '\0'))
+			i++;
+		for (; i < size && field[i] >= '0' && field[i] <= '7'; i++)
+			value = value * 8 + (field[i] - '0');
+		return value;
+	}
+
+	static QString TarString(const char* field, int size) {
+		return QString::fromUtf8(field, (int)strnlen(field, size));
+	}
+
+	static qint64 Padding(qint64 size) {
+		return (TarBlockSize - size % TarBlockSize) % TarBlockSize;
+	}
+
+	/************************************************************************************************************************
+	 * Class： BytePipe
+	 *
+	 *
+	/************************************************************************************************************************/
+	BytePipe::BytePipe(int capacity)
+		: mCapacity(capacity) {}
+
+	bool BytePipe::Write(const char* data, int size) {
+		QMutexLocker locker(&mMutex);
+		while (size > 0) {
+			while (mBuffer.size() >= mCapacity && !mAborted)
+				mNotFull.wait(&mMutex);
+			if (mAborted)
+				return false;
+			int n = qMin(size, mCapacity - mBuffer.size());
+			mBuffer.append(data, n);
+			data += n;
+			size -= n;
+			mNotEmpty.wakeAll();
+		}
+		return true;
+	}
+
+	int BytePipe::Read(char* data, int size) {
+		QMutexLocker locker(&mMutex);
+		int read = 0;
+		while (read < size) {
+			while (mBuffer.isEmpty() && !mClosed && !mAborted)
+				mNotEmpty.wait(&mMutex);
+			if (mBuffer.isEmpty() || mAborted)
+				break;
+			int n = qMin(size - read, mBuffer.size());
+			memcpy(data + read, mBuffer.constData(), n);
+			mBuffer.remove(0, n);
+			read += n;
+			mNotFull.wakeAll();
+		}
+		return read;
+	}
+
+	void BytePipe::Close(bool failed, const QString& error) {
+		QMutexLocker locker(&mMutex);
+		mClosed = true;
+		mFailed = failed;
+		mError = error;
+		mNotEmpty.wakeAll();
+	}
+
+	void BytePipe::Abort() {
+		QMutexLocker locker(&mMutex);
+		mAborted = true;
+		mNotFull.wakeAll();
+		mNotEmpty.wakeAll();
+	}
+
+	bool BytePipe::IsFailed() {
+		QMutexLocker locker(&mMutex);
+		return mFailed;
+	}
+
+	QString BytePipe::Error() {
+		QMutexLocker locker(&mMutex);
+		return mError;
+	}
+
+	/************************************************************************************************************************
+	 * Class： BytePipeStreamBuf
+	 *
+	 *
+	/************************************************************************************************************************/
+	BytePipeStreamBuf::BytePipeStreamBuf(BytePipe& pipe)
+		: mPipe(pipe) {
+		setp(mBuffer, mBuffer + sizeof(mBuffer));
+	}
+
+	BytePipeStreamBuf::~BytePipeStreamBuf() {
+		FlushBuffer();
+	}
+
+	bool BytePipeStreamBuf::FlushBuffer() {
+		int size = (int)(pptr() - pbase());
+		if (size > 0 && !mPipe.Write(pbase(), size))
+			return false;
+		setp(mBuffer, mBuffer + sizeof(mBuffer));
+		return true;
+	}
+
+	BytePipeStreamBuf::int_type BytePipeStreamBuf::overflow(int_type ch) {
+		if (!FlushBuffer())
+			return traits_type::eof();
+		if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+			*pptr() = traits_type::to_char_type(ch);
+			pbump(1);
+		}
+		return traits_type::not_eof(ch);
+	}
+
+	std::streamsize BytePipeStreamBuf::xsputn(const char* s, std::streamsize n) {
+		//! Large writes of the decoder go to the pipe directly.
+		if (n >= (std::streamsize)sizeof(mBuffer)) {
+			if (!FlushBuffer() || !mPipe.Write(s, (int)n))
+				return 0;
+			return n;
+		}
+		return std::streambuf::xsputn(s, n);
+	}
+
+	int BytePipeStreamBuf::sync() {
+		return FlushBuffer() ? 0 : -1;
+	}
+
+	/************************************************************************************************************************
+	 * Class： TarStreamReader
+	 *
+	 *
+	/************************************************************************************************************************/
+	TarStreamReader::TarStreamReader(BytePipe& pipe)
+		: mPipe(pipe) {}
+
+	bool TarStreamReader::ReadBlock(char* block) {
+		return mPipe.Read(block, TarBlockSize) == TarBlockSize;
+	}
+
+	bool TarStreamReader::ReadData(qint64 size, QByteArray& data) {
+		if (size > MaxHeaderDataSize) {
+			mError = QObject::tr("Invalid tar header.");
+			return false;
+		}
+		data.resize((int)size);
+		if (mPipe.Read(data.data(), (int)size) != size) {
+			mError = QObject::tr("Unexpected end of tar stream.");
+			return false;
+		}
+		return Skip(Padding(size));
+	}
+
+	bool TarStreamReader::Skip(qint64 size) {
+		char buffer[TarBlockSize * 16];
+		while (size > 0) {
+			int n = (int)qMin<qint64>(size, sizeof(buffer));
+			if (mPipe.Read(buffer, n) != n) {
+				mError = QObject::tr("Unexpected end of tar stream.");
+				return false;
+			}
+			size -= n;
+		}
+		return true;
+	}
+
+	QString TarStreamReader::SafePath(const QString& outputDir, const QString& name) {
+		QString path = QDir::fromNativeSeparators(name);
+		if (path.startsWith('/') || QDir::isAbsolutePath(path))
+			return QString();
+		QString clean = QDir::cleanPath(path);
+		if (clean == ".." || clean.startsWith("../") || clean.isEmpty() || clean == ".")
+			return QString();
+		return QDir(outputDir).absoluteFilePath(clean);
+	}
+
+	bool TarStreamReader::IsInside(const QString& dir) {
+		//! The directories not created yet are resolved from the deepest existing one, a dangling link is never followed.
+		QFileInfo info(dir);
+		while (!info.exists()) {
+			if (info.isSymLink())
+				return false;
+			QFileInfo parent(info.absolutePath());
+			if (parent.absoluteFilePath() == info.absoluteFilePath())
+				return false;
+			info = parent;
+		}
+		QString real = info.canonicalFilePath();
+		return !real.isEmpty() && (real == mRoot || real.startsWith(mRoot + "/"));
+	}
+
+	bool TarStreamReader::WriteFile(const QString& path, qint64 size, qint64 mtime, int mode) {
+		QString dir = QFileInfo(path).absolutePath();
+		if (!IsInside(dir)) {
+			mError = QObject::tr("Unsafe path in tar stream: %1.").arg(path);
+			return false;
+		}
+		QDir().mkpath(dir);
+		//! A link left at the path by an earlier entry is replaced, not written through.
+		if (QFileInfo(path).isSymLink()) {
+			QFile::remove(path);
+		}
+		QFile file(path);
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+			mError = QObject::tr("Cannot write %1.").arg(path);
+			return false;
+		}
+		char buffer[64 << 10];
+		qint64 remain = size;
+		while (remain > 0) {
+			int n = (int)qMin<qint64>(remain, sizeof(buffer));
+			if (mPipe.Read(buffer, n) != n) {
+				mError = QObject::tr("Unexpected end of tar stream.");
+				return false;
+			}
+			if (file.write(buffer, n) != n) {
+				mError = QObject::tr("Cannot write %1.").arg(path);
+				return false;
+			}
+			remain -= n;
+		}
+		if (mode & 0100) {
+			file.setPermissions(file.permissions() | QFileDevice::ExeOwner | QFileDevice::ExeUser);
+		}
+		file.setFileTime(QDateTime::fromSecsSinceEpoch(mtime), QFileDevice::FileModificationTime);
+		file.close();
+		return Skip(Padding(size));
+	}
+
+	bool TarStreamReader::ExtractTo(const QString& outputDir) {
+		char block[TarBlockSize];
+		QString longName;
+		QString longLink;
+		qint64 paxSize = -1;
+		QDir().mkpath(outputDir);
+		mRoot = QFileInfo(outputDir).canonicalFilePath();
+		if (mRoot.isEmpty()) {
+			mError = QObject::tr("Cannot write %1.").arg(outputDir);
+			return false;
+		}
+
+		while (true) {
+			if (!ReadBlock(block)) {
+				mError = QObject::tr("Unexpected end of tar stream.");
+				return false;
+			}
+			//! The archive ends with zero blocks.
+			if (std::all_of(block, block + TarBlockSize, [](char c) { return c == 0; }))
+				break;
+
+			QString name = TarString(block, 100);
+			//! Only POSIX ustar has the prefix field, GNU tar stores times there.
+			if (memcmp(block + 257, "ustar\0", 6) == 0) {
+				QString prefix = TarString(block + 345, 155);
+				if (!prefix.isEmpty())
+					name = prefix + "/" + name;
+			}
+			qint64 size = TarNumber(block + 124, 12);
+			qint64 mtime = TarNumber(block + 136, 12);
+			int mode = (int)TarNumber(block + 100, 8);
+			char type = block[156];
+
+			if (type == 'L' || type == 'K' || type == 'x') {
+				QByteArray data;
+				if (!ReadData(size, data))
+					return false;
+				if (type == 'L') {
+					longName = QString::fromUtf8(data.constData(), (int)strnlen(data.constData(), data.size()));
+				} else if (type == 'K') {
+					longLink = QString::fromUtf8(data.constData(), (int)strnlen(data.constData(), data.size()));
+				} else {
+					//! pax records: "<length> <key>=<value>\n"
+					for (const QByteArray& record : data.split('\n')) {
+						int space = record.indexOf(' ');
+						int equal = record.indexOf('=');
+						if (space < 0 || equal < space)
+							continue;
+						QByteArray key = record.mid(space + 1, equal - space - 1);
+						QByteArray value = record.mid(equal + 1);
+						if (key == "path")
+							longName = QString::fromUtf8(value);
+						else if (key == "linkpath")
+							longLink = QString::fromUtf8(value);
+						else if (key == "size")
+							paxSize = value.toLongLong();
+					}
+				}
+				continue;
+			}
+			if (type == 'g') {
+				if (!Skip(size + Padding(size)))
+					return false;
+				continue;
+			}
+
+			if (!longName.isEmpty())
+				name = longName;
+			if (paxSize >= 0)
+				size = paxSize;
+			QString link = longLink.isEmpty() ? TarString(block + 157, 100) : longLink;
+			longName.clear();
+			longLink.clear();
+			paxSize = -1;
+
+			QString path = SafePath(outputDir, name);
+			if (path.isEmpty()) {
+				mError = QObject::tr("Unsafe path in tar stream: %1.").arg(name);
+				return false;
+			}
+
+			if (type == '5') {
+				if (!IsInside(path)) {
+					mError = QObject::tr("Unsafe path in tar stream: %1.").arg(name);
+					return false;
+				}
+				QDir().mkpath(path);
+				if (!Skip(size + Padding(size)))
+					return false;
+			} else if (type == '0' || type == '\0' || type == '7') {
+				if (!WriteFile(path, size, mtime, mode))
+					return false;
+			} else if (type == '1') {
+				//! Hard links are restored as copies of the target extracted before.
+				QString target = SafePath(outputDir, link);
+				if (target.isEmpty() || !IsInside(target) || !IsInside(QFileInfo(path).absolutePath())) {
+					mError = QObject::tr("Unsafe link in tar stream: %1.").arg(name);
+					return false;
+				}
+				QFile::remove(path);
+				if (!QFile::copy(target, path)) {
+					mError = QObject::tr("Cannot create link %1.").arg(name);
+					return false;
+				}
+				if (!Skip(size + Padding(size)))
+					return false;
+			} else if (type == '2') {
+				//! Only links staying inside the output directory are created, later entries could be written through the others.
+				QString relative = QDir(outputDir).relativeFilePath(QFileInfo(path).absolutePath());
+				if (!QDir::isAbsolutePath(link) && !SafePath(outputDir, relative + "/" + link).isEmpty() && IsInside(QFileInfo(path).absolutePath())) {
+					QDir().mkpath(QFileInfo(path).absolutePath());
+					QFile::remove(path);
+					QFile::link(link, path);
+				}
+				if (!Skip(size + Padding(size)))
+					return false;
+			} else {
+				//! Devices and fifos are not extracted.
+				if (!Skip(size + Padding(size)))
+					return false;
+			}
+		}
+
+		//! Read the rest of the stream, the outer format checks its CRC at the end.
+		char rest[TarBlockSize * 16];
+		while (mPipe.Read(rest, sizeof(rest)) > 0) {
+		}
+		return true;
+	}
+}
\ No newline at end of file
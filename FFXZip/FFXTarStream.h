@@ -0,0 +1,89 @@
+#pragma once
+#include <QString>
+#include <QFileInfo>
+#include <QByteArray>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <streambuf>
+#include <functional>
+
+namespace FFX {
+	/// <summary>
+	/// A bounded in-memory pipe between a writer and a reader thread. The writer blocks while the pipe is full,
+	/// the reader blocks while it is empty, either side can abort the other one.
+	/// </summary>
+	class BytePipe {
+	public:
+		BytePipe(int capacity = 8 << 20);
+
+	public:
+		//! Returns false if the reader aborted.
+		bool Write(const char* data, int size);
+		//! Returns the number of bytes read, less than size only at the end of the stream.
+		int Read(char* data, int size);
+		//! End of stream, failed is set if the writer did not complete.
+		void Close(bool failed = false, const QString& error = QString());
+		void Abort();
+		bool IsFailed();
+		QString Error();
+
+	private:
+		QMutex mMutex;
+		QWaitCondition mNotEmpty;
+		QWaitCondition mNotFull;
+		QByteArray mBuffer;
+		int mCapacity;
+		bool mClosed = false;
+		bool mAborted = false;
+		bool mFailed = false;
+		QString mError;
+	};
+
+	//! std::streambuf writing into a BytePipe, so bit7z can extract an item straight into the pipe.
+	class BytePipeStreamBuf : public std::streambuf {
+	public:
+		BytePipeStreamBuf(BytePipe& pipe);
+		~BytePipeStreamBuf();
+
+	protected:
+		virtual int_type overflow(int_type ch) override;
+		virtual std::streamsize xsputn(const char* s, std::streamsize n) override;
+		virtual int sync() override;
+
+	private:
+		bool FlushBuffer();
+
+	private:
+		BytePipe& mPipe;
+		char mBuffer[64 << 10];
+	};
+
+	/// <summary>
+	/// Extracts a tar stream (ustar with GNU long names and pax path/size records) read from a BytePipe.
+	/// Entries with absolute paths or ".." components are rejected, nothing is written through a link leading out of the output directory.
+	/// </summary>
+	class TarStreamReader {
+	public:
+		TarStreamReader(BytePipe& pipe);
+
+	public:
+		bool ExtractTo(const QString& outputDir);
+		QString Error() const { return mError; }
+
+	private:
+		bool ReadBlock(char* block);
+		bool ReadData(qint64 size, QByteArray& data);
+		bool WriteFile(const QString& path, qint64 size, qint64 mtime, int mode);
+		bool Skip(qint64 size);
+		QString SafePath(const QString& outputDir, const QString& name);
+		//! The directory resolved through the links created so far is inside the output directory.
+		bool IsInside(const QString& dir);
+
+	private:
+		BytePipe& mPipe;
+		QString mError;
+		//! Canonical output directory.
+		QString mRoot;
+	};
+}
\ No newline at end of file
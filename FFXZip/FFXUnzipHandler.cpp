@@ -2,8 +2,27 @@
 #include "FFXFileFilterExpr.h"
 #include "FFXFile.h"
 #include "FFXZip.h"
+#include "FFXSevenZip.h"
+#include "FFXArchive.h"
+#include "FFXTarStream.h"
 
 #include <QCoreApplication>
+#include <QTemporaryDir>
+#include <QStorageInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QDirIterator>
+#include <QCryptographicHash>
+#include <QSet>
+
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <ostream>
+#include <stdexcept>
 
 #include <bit7z/bitarchivereader.hpp>
 #include <bit7z/bitfilecompressor.hpp>
@@ -12,20 +31,268 @@
 using namespace bit7z;
 
 namespace FFX {
-	bool UnzipProgressCallback(uint64_t size, const QFileInfo& file, ProgressPtr p)
-	{
-		uint64_t totalSize = FileSize(file);
-		double process = ((1.0 * size) / totalSize);
-		p->OnProgress((int)(process * 100), QObject::tr("Unzip:%1").arg(file.absoluteFilePath()));
+	//! Uncompressed size of the archive read from its headers, the compressed size is used if the headers cannot be read.
+	static uint64_t UncompressedSize(const QFileInfo& zipFile) {
+		try {
+			BitArchiveReader reader{ SevenZipLibrary::Instance(SevenZipPath()), zipFile.absoluteFilePath().toStdString(), BitFormat::Auto };
+			uint64_t size = reader.size();
+			if (size > 0)
+				return size;
+		} catch (const bit7z::BitException&) {
+		}
+		return qMax<uint64_t>(FileSize(zipFile), 1);
+	}
+
+	static QFileInfoList DirEntries(const QString& dir) {
+		return QDir(dir).entryInfoList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+	}
+
+	//! Whether the tree under source can be merged into dest without replacing a directory by a file or the other way round.
+	static bool CanMerge(const QString& source, const QString& dest, QString& conflict) {
+		for (const QFileInfo& item : DirEntries(source)) {
+			QFileInfo destItem(QDir(dest).absoluteFilePath(item.fileName()));
+			if (!destItem.exists() && !destItem.isSymLink())
+				continue;
+			bool sourceDir = item.isDir() && !item.isSymLink();
+			bool destDir = destItem.isDir() && !destItem.isSymLink();
+			if (sourceDir != destDir) {
+				conflict = destItem.absoluteFilePath();
+				return false;
+			}
+			if (sourceDir && !CanMerge(item.absoluteFilePath(), destItem.absoluteFilePath(), conflict))
+				return false;
+		}
 		return true;
 	}
 
-	UnzipHandler::UnzipHandler(const QString& outputDir, bool mkdir) {
+	//! Moves the tree under source into dest, new directories are renamed whole and existing files are overwritten.
+	static bool MergeInto(const QString& source, const QString& dest, QString& error) {
+		QDir().mkpath(dest);
+		for (const QFileInfo& item : DirEntries(source)) {
+			QString destPath = QDir(dest).absoluteFilePath(item.fileName());
+			QFileInfo destItem(destPath);
+			bool exists = destItem.exists() || destItem.isSymLink();
+			if (exists && item.isDir() && !item.isSymLink()) {
+				if (!MergeInto(item.absoluteFilePath(), destPath, error))
+					return false;
+				continue;
+			}
+			if (exists && !QFile::remove(destPath)) {
+				error = QObject::tr("Cannot overwrite %1.").arg(destPath);
+				return false;
+			}
+			if (!QDir().rename(item.absoluteFilePath(), destPath)) {
+				error = QObject::tr("Cannot move %1 to %2.").arg(item.fileName()).arg(dest);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//! The device holding outputDir, or the nearest existing parent as outputDir may not be created yet.
+	static QString OutputDevice(const QString& outputDir) {
+		QFileInfo dir(outputDir);
+		while (!dir.exists() && !dir.isRoot()) {
+			QFileInfo parent(dir.absolutePath());
+			if (parent.absoluteFilePath() == dir.absoluteFilePath())
+				break;
+			dir = parent;
+		}
+		QStorageInfo storage(dir.absoluteFilePath());
+		return storage.isValid() ? QString::fromLocal8Bit(storage.device()) : dir.absoluteFilePath();
+	}
+
+	//! Selects the file entries whose names pass the filter, returns their uncompressed size, error is set if the archive cannot be read.
+	static uint64_t SelectEntries(const QFileInfo& zipFile, FileFilterPtr filter, QStringList& entries, std::vector<uint32_t>& indices, QString& error) {
+		ArchiveIndexPtr index = ArchiveIndex::Open(zipFile.absoluteFilePath(), &error);
+		if (index == nullptr) {
+			if (error.isEmpty()) {
+				error = QObject::tr("Cannot read the archive.");
+			}
+			return 1;
+		}
+
+		uint64_t size = 0;
+		for (const ArchiveEntry& entry : index->Entries()) {
+			if (entry.dir || entry.index < 0)
+				continue;
+			if (filter != nullptr && !filter->Accept(QFileInfo(entry.path)))
+				continue;
+			entries << entry.path;
+			indices.push_back((uint32_t)entry.index);
+			size += entry.size;
+		}
+		return qMax<uint64_t>(size, 1);
+	}
+
+	//! Tarballs compressed as a whole, the tar inside is extracted while the outer stream is decompressed.
+	static bool IsCompressedTar(const QFileInfo& zipFile) {
+		static const QStringList suffixes = { ".tar.gz", ".tgz", ".tar.bz2", ".tbz2", ".tar.xz", ".txz", ".tar.zst", ".tzst" };
+		QString fileName = zipFile.fileName();
+		for (const QString& suffix : suffixes) {
+			if (fileName.endsWith(suffix, Qt::CaseInsensitive))
+				return true;
+		}
+		return false;
+	}
+
+	//! The outer decompressor writes into a pipe on its own thread, the tar entries are written out as they arrive, the tar itself never touches the disk.
+	static void ExtractCompressedTar(const QFileInfo& zipFile, const QString& outputDir, const std::function<bool(uint64_t)>& callback) {
+		BytePipe pipe;
+		std::thread decompressor([&]() {
+			try {
+				BytePipeStreamBuf buffer(pipe);
+				std::ostream stream(&buffer);
+				BitFileExtractor extractor{ SevenZipLibrary::Instance(SevenZipPath()), BitFormat::Auto };
+				extractor.setProgressCallback(callback);
+				extractor.extract(zipFile.absoluteFilePath().toStdString(), stream, 0);
+				stream.flush();
+				pipe.Close(stream.fail(), stream.fail() ? QObject::tr("Tar stream aborted.") : QString());
+			} catch (const std::exception& ex) {
+				pipe.Close(true, QString::fromLocal8Bit(ex.what()));
+			}
+			});
+
+		TarStreamReader reader(pipe);
+		bool success = reader.ExtractTo(outputDir);
+		if (!success) {
+			pipe.Abort();
+		}
+		decompressor.join();
+		//! The reader aborting fails the decompressor as well, its own error is the cause.
+		if (!success)
+			throw std::runtime_error(reader.Error().toStdString());
+		if (pipe.IsFailed())
+			throw std::runtime_error(pipe.Error().toStdString());
+	}
+
+	static void ExtractArchive(const QFileInfo& zipFile, const QString& outputDir, const std::vector<uint32_t>& indices, const std::function<bool(uint64_t)>& callback) {
+		if (indices.empty() && IsCompressedTar(zipFile)) {
+			ExtractCompressedTar(zipFile, outputDir, callback);
+			return;
+		}
+		if (indices.empty()) {
+			BitFileExtractor extractor{ SevenZipLibrary::Instance(SevenZipPath()), BitFormat::Auto };
+			extractor.setProgressCallback(callback);
+			extractor.extract(zipFile.absoluteFilePath().toStdString(), outputDir.toStdString());
+			return;
+		}
+		//! 7-Zip skips the solid blocks without any requested item, a block holding one is only decoded up to its last requested item.
+		BitArchiveReader reader{ SevenZipLibrary::Instance(SevenZipPath()), zipFile.absoluteFilePath().toStdString(), BitFormat::Auto };
+		reader.setProgressCallback(callback);
+		reader.extractTo(outputDir.toStdString(), indices);
+	}
+
+	//! Identifies an archive by its size and the blocks at both ends, an archive containing itself or one of its ancestors is not extracted again.
+	static QByteArray Fingerprint(const QFileInfo& zipFile) {
+		static const qint64 BlockSize = 64 << 10;
+		QCryptographicHash hash(QCryptographicHash::Sha1);
+		hash.addData(QByteArray::number(zipFile.size()));
+		QFile file(zipFile.absoluteFilePath());
+		if (file.open(QIODevice::ReadOnly)) {
+			hash.addData(file.read(BlockSize));
+			if (file.size() > BlockSize && file.seek(qMax(BlockSize, file.size() - BlockSize)))
+				hash.addData(file.read(BlockSize));
+		}
+		return hash.result();
+	}
+
+	//! Nested archives are extracted beside themselves into a new folder, folders already claimed by other nested archives are skipped too.
+	static QString NestedOutputDir(const QFileInfo& zipFile, const QSet<QString>& claimed) {
+		QDir dir = zipFile.absoluteDir();
+		QString baseName = File(zipFile).BaseName();
+		QString name = baseName;
+		for (int i = 1; dir.exists(name) || claimed.contains(dir.absoluteFilePath(name)); i++) {
+			name = QString("%1 (%2)").arg(baseName).arg(i);
+		}
+		return dir.absoluteFilePath(name);
+	}
+
+	//! An archive to extract, the archives found in its output are queued as jobs of the same selected archive.
+	struct UnzipJob {
+		QFileInfo file;
+		QString outputDir;
+		QString device;
+		QStringList entries;
+		std::vector<uint32_t> indices;
+		uint64_t total = 1;
+		uint64_t done = 0;
+		//! Bytes reported by the extractor, not bounded by the declared size.
+		uint64_t extracted = 0;
+		int root = 0;
+		int depth = 0;
+		//! Fingerprints of the archive and the archives it was extracted from.
+		QList<QByteArray> lineage;
+		QFileInfoList outputs;
+		//! Why the entries could not be selected.
+		QString error;
+	};
+
+	//! Reports the files of the sink to the task, the task itself is completed by UnzipHandler.
+	class SinkProgress : public Progress {
+	public:
+		SinkProgress(ProgressPtr progress)
+			: mProgress(progress) {}
+
+	public:
+		virtual void OnProgress(double percent, const QString& msg = QString()) {}
+		virtual void OnFileComplete(const QFileInfo& input, const QFileInfo& output, bool success = true, const QString& msg = QString()) {
+			mProgress->OnFileComplete(input, output, success, msg);
+		}
+		virtual void OnComplete(bool success = true, const QString& msg = QString()) {}
+
+	private:
+		ProgressPtr mProgress;
+	};
+
+	//! Serializes the reports of the workers with the dispatcher, the task progress is not thread safe.
+	class LockedProgress : public Progress {
+	public:
+		LockedProgress(ProgressPtr progress, QMutex& mutex)
+			: mProgress(progress)
+			, mMutex(mutex) {}
+
+	public:
+		virtual void OnProgress(double percent, const QString& msg = QString()) {
+			QMutexLocker locker(&mMutex);
+			mProgress->OnProgress(percent, msg);
+		}
+		virtual void OnFileComplete(const QFileInfo& input, const QFileInfo& output, bool success = true, const QString& msg = QString()) {
+			QMutexLocker locker(&mMutex);
+			mProgress->OnFileComplete(input, output, success, !success && !mFailure.isEmpty() ? mFailure : msg);
+		}
+		virtual void OnComplete(bool success = true, const QString& msg = QString()) {
+			QMutexLocker locker(&mMutex);
+			mProgress->OnComplete(success, msg);
+		}
+
+	public:
+		//! A failure is reported with this message, the caller holds the mutex.
+		void SetFailure(const QString& msg) { mFailure = msg; }
+
+	private:
+		ProgressPtr mProgress;
+		QMutex& mMutex;
+		QString mFailure;
+	};
+
+	UnzipHandler::UnzipHandler(const QString& outputDir, bool mkdir, bool safeExtract, int maxParallel, int maxPerDevice, const QString& entryFilter, int maxDepth, int maxRatio, const QString& sink) {
 		mArgMap["OutputDir"] = Argument("OutputDir", QObject::tr("OutputDir"), QObject::tr("Extract files to this directory, default to the current directory of the compressed file."), outputDir);
 		mArgMap["MkDir"] = Argument("MkDir", QObject::tr("MkDir"), QObject::tr("Create a folder with the compressed file name in the output directory"), mkdir);
+		mArgMap["SafeExtract"] = Argument("SafeExtract", QObject::tr("Safe Extract"), QObject::tr("Extract to a temporary directory first, CRCs are checked while extracting and the files are moved to the output directory only if the archive is intact, default is true."), safeExtract, Argument::Bool);
+		mArgMap["MaxParallel"] = Argument("MaxParallel", QObject::tr("Max Parallel"), QObject::tr("Max number of archives extracted at the same time, 0 means the number of CPU cores, default is 0."), maxParallel);
+		mArgMap["MaxParallel"].AddLimit("^(0|[1-9]\\d{0,2})$");
+		mArgMap["MaxPerDevice"] = Argument("MaxPerDevice", QObject::tr("Max Per Device"), QObject::tr("Max number of archives extracted to the same output device at the same time, 0 means no limit, default is 2."), maxPerDevice);
+		mArgMap["MaxPerDevice"].AddLimit("^(0|[1-9]\\d{0,2})$");
+		mArgMap["EntryFilter"] = Argument("EntryFilter", QObject::tr("Entry Filter"), QObject::tr("Only extract the entries whose names match this filter expression, for example *.log, empty means all entries."), entryFilter);
+		mArgMap["MaxDepth"] = Argument("MaxDepth", QObject::tr("Max Depth"), QObject::tr("Extract the archives found in the extracted files too, up to this many levels, only without entry filter and with MkDir set, 0 means only the selected archives, default is 0."), maxDepth);
+		mArgMap["MaxDepth"].AddLimit("^(0|[1-9]\\d?)$");
+		mArgMap["MaxRatio"] = Argument("MaxRatio", QObject::tr("Max Expansion Ratio"), QObject::tr("Stop extracting the nested archives of a selected archive once everything extracted from it would exceed this many times its size, 0 means no limit, default is 100."), maxRatio);
+		mArgMap["MaxRatio"].AddLimit("^(0|[1-9]\\d{0,5})$");
+		mArgMap["Sink"] = Argument("Sink", QObject::tr("Sink"), QObject::tr("Name of the handler the matching entries are handed to instead of being written to the output directory, for example FileCopyHandler, empty means none."), sink);
 
 		FileFilterPtr fileOnlyFilter = std::make_shared<OnlyFileFilter>();
-		FileFilterExpr expr("*.zip|*.rar|*.gz|*.7z|*.ffx", false);
+		FileFilterExpr expr("*.zip|*.rar|*.gz|*.7z|*.ffx|*.tar|*.tgz|*.bz2|*.tbz2|*.xz|*.txz|*.zst|*.tzst", false);
 		FileFilterPtr wildcardFilter = expr.Filter();
 		mFileFilter = std::make_shared<AndFileFilter>(fileOnlyFilter, wildcardFilter);
 	}
@@ -41,16 +308,188 @@ namespace FFX {
 	}
 
 	QFileInfoList UnzipHandler::Handle(const QFileInfoList& files, ProgressPtr progress) {
-		QFileInfoList result;
+		mCancelled = false;
 		QFileInfoList zipFiles = Filter(files);
 		int size = zipFiles.size();
+		bool safeExtract = mArgMap["SafeExtract"].BoolValue();
+		int maxParallel = mArgMap["MaxParallel"].IntValue();
+		if (maxParallel <= 0) {
+			maxParallel = QThread::idealThreadCount();
+		}
+		int maxPerDevice = mArgMap["MaxPerDevice"].IntValue();
+		if (maxPerDevice <= 0) {
+			maxPerDevice = maxParallel;
+		}
+
+		QString entryFilterExpr = mArgMap["EntryFilter"].StringValue().trimmed();
+		FileFilterPtr entryFilter;
+		if (!entryFilterExpr.isEmpty()) {
+			entryFilter = FileFilterExpr(entryFilterExpr.toStdString(), false).Filter();
+		}
+		QString sinkName = mArgMap["Sink"].StringValue().trimmed();
+		FileHandlerPtr sink;
+		if (!sinkName.isEmpty()) {
+			sink = mHandlerFactory != nullptr ? mHandlerFactory->Handler(sinkName) : FileHandlerPtr();
+			if (sink == nullptr || sink->Name() == Name()) {
+				progress->OnComplete(false, QObject::tr("Unknown sink handler %1.").arg(sinkName));
+				return QFileInfoList();
+			}
+		}
+		bool selective = entryFilter != nullptr || sink != nullptr;
+
+		//! Nested archives are only looked for in folders holding nothing but the output of one archive.
+		int maxDepth = selective || !mArgMap["MkDir"].BoolValue() ? 0 : mArgMap["MaxDepth"].IntValue();
+		uint64_t maxRatio = maxDepth > 0 ? (uint64_t)mArgMap["MaxRatio"].IntValue() : 0;
+
+		//! Archives are weighted by their uncompressed size in the overall progress, only the selected entries count when filtering.
+		//! The jobs are kept in a deque so the workers can hold on to them while nested jobs are appended.
+		std::deque<UnzipJob> jobs;
+		QList<UnzipJob*> pending;
+		QVector<uint64_t> packed(size);
+		QVector<uint64_t> expanded(size);
+		//! Bytes actually extracted from each selected archive, the sizes declared in the headers may lie.
+		QVector<uint64_t> actual(size);
+		QSet<QString> claimed;
+		uint64_t total = 0;
 		for (int i = 0; i < size; i++) {
-			const QFileInfo& file = zipFiles[i];
-			QString outputDir = MakeOutputDir(file);
-			UnzipFile(file, outputDir, progress);
-			result << outputDir;
+			jobs.emplace_back();
+			UnzipJob& job = jobs.back();
+			job.file = zipFiles[i];
+			job.outputDir = MakeOutputDir(zipFiles[i]);
+			job.device = OutputDevice(job.outputDir);
+			job.total = selective ? SelectEntries(zipFiles[i], entryFilter, job.entries, job.indices, job.error) : UncompressedSize(zipFiles[i]);
+			job.root = i;
+			packed[i] = qMax<uint64_t>(FileSize(zipFiles[i]), 1);
+			expanded[i] = job.total;
+			if (maxRatio > 0 && job.total > maxRatio * packed[i]) {
+				progress->OnFileComplete(job.file, job.outputDir, false, QObject::tr("Skipped, it would expand to more than %1 times its size.").arg(maxRatio));
+				continue;
+			}
+			if (maxDepth > 0) {
+				job.lineage << Fingerprint(job.file);
+			}
+			total += job.total;
+			pending << &job;
 		}
-		progress->OnComplete(true, "Finish.");
+
+		QMutex mutex;
+		QWaitCondition finished;
+		QMap<QString, int> running;
+		int active = 0;
+		uint64_t extracted = 0;
+		QThreadPool workers;
+		workers.setMaxThreadCount(maxParallel);
+
+		QMutexLocker locker(&mutex);
+		while (!mCancelled && (!pending.isEmpty() || active > 0)) {
+			//! Pick the first archive whose output device is not saturated, wait for a running one to finish otherwise.
+			//! A running job may also queue the nested archives it found.
+			auto it = pending.end();
+			if (active < maxParallel) {
+				it = std::find_if(pending.begin(), pending.end(), [&](UnzipJob* job) { return running.value(job->device) < maxPerDevice; });
+			}
+			if (it == pending.end()) {
+				finished.wait(&mutex);
+				continue;
+			}
+			UnzipJob* job = *it;
+			pending.erase(it);
+			running[job->device]++;
+			active++;
+
+			workers.start([&, job]() {
+				const QFileInfo& file = job->file;
+				//! Everything reported from here without the lock goes through it.
+				LockedProgress lockedProgress(progress, mutex);
+				ProgressPtr reporter = &lockedProgress;
+				auto callback = [&, job](uint64_t bytes) {
+					QMutexLocker l(&mutex);
+					if (bytes > job->extracted) {
+						actual[job->root] += bytes - job->extracted;
+						job->extracted = bytes;
+					}
+					if (maxRatio > 0 && actual[job->root] > maxRatio * packed[job->root]) {
+						lockedProgress.SetFailure(QObject::tr("Stopped, the files extracted from %1 exceeded %2 times its size.").arg(zipFiles[job->root].fileName()).arg(maxRatio));
+						return false;
+					}
+					bytes = qMin(bytes, job->total);
+					extracted += bytes - qMin(job->done, bytes);
+					job->done = qMax(job->done, bytes);
+					progress->OnProgress(100.0 * extracted / total, QObject::tr("Unzip:%1").arg(file.absoluteFilePath()));
+					return !mCancelled;
+				};
+				QFileInfoList output;
+				if (!selective) {
+					if (safeExtract ? SafeUnzipFile(file, job->outputDir, reporter, callback) : UnzipFile(file, job->outputDir, reporter, callback))
+						output << job->outputDir;
+				} else if (!job->error.isEmpty()) {
+					reporter->OnFileComplete(file, job->outputDir, false, job->error);
+				} else if (job->indices.empty()) {
+					reporter->OnFileComplete(file, job->outputDir, false, QObject::tr("No entry matches %1.").arg(entryFilterExpr));
+				} else if (sink != nullptr) {
+					UnzipToSink(sink, file, job->entries, job->indices, reporter, callback, output);
+				} else {
+					if (safeExtract ? SafeUnzipFile(file, job->outputDir, reporter, callback, job->indices) : UnzipFile(file, job->outputDir, reporter, callback, job->indices))
+						output << job->outputDir;
+				}
+
+				//! The headers of the nested archives are read before taking the lock, the other workers keep reporting meanwhile.
+				std::vector<UnzipJob> nested;
+				if (!output.isEmpty() && job->depth < maxDepth) {
+					QDirIterator fit(job->outputDir, QDir::Files | QDir::Hidden | QDir::System, QDirIterator::Subdirectories);
+					while (fit.hasNext() && !mCancelled) {
+						QFileInfo nestedFile(fit.next());
+						if (!mFileFilter->Accept(nestedFile))
+							continue;
+						QByteArray fingerprint = Fingerprint(nestedFile);
+						if (job->lineage.contains(fingerprint)) {
+							reporter->OnFileComplete(nestedFile, QFileInfo(), false, QObject::tr("Skipped, the archive contains itself."));
+							continue;
+						}
+						UnzipJob child;
+						child.file = nestedFile;
+						child.device = job->device;
+						child.total = UncompressedSize(nestedFile);
+						child.root = job->root;
+						child.depth = job->depth + 1;
+						child.lineage = job->lineage;
+						child.lineage << fingerprint;
+						nested.push_back(child);
+					}
+				}
+
+				QMutexLocker l(&mutex);
+				job->outputs = output;
+				extracted += job->total - job->done;
+				job->done = job->total;
+				for (UnzipJob& child : nested) {
+					//! Everything extracted from a selected archive counts against its ratio, a zip bomb is stopped at the level where it blows up.
+					if (maxRatio > 0 && expanded[child.root] + child.total > maxRatio * packed[child.root]) {
+						progress->OnFileComplete(child.file, QFileInfo(), false, QObject::tr("Skipped, the files extracted from %1 would exceed %2 times its size.").arg(zipFiles[child.root].fileName()).arg(maxRatio));
+						continue;
+					}
+					child.outputDir = NestedOutputDir(child.file, claimed);
+					claimed << child.outputDir;
+					expanded[child.root] += child.total;
+					total += child.total;
+					jobs.push_back(child);
+					pending << &jobs.back();
+				}
+				progress->OnProgress(100.0 * extracted / total, QObject::tr("Unzip:%1").arg(file.absoluteFilePath()));
+				running[job->device]--;
+				active--;
+				finished.wakeAll();
+				});
+		}
+		locker.unlock();
+		workers.waitForDone();
+
+		//! The folders of the nested archives are inside the output of the selected ones.
+		QFileInfoList result;
+		for (int i = 0; i < size; i++) {
+			result << jobs[i].outputs;
+		}
+		progress->OnComplete(!mCancelled, mCancelled ? QObject::tr("Cancelled.") : "Finish.");
 		return result;
 	}
 
@@ -70,36 +509,109 @@ namespace FFX {
 		File file(zipFile);
 		QString fileName = file.BaseName();
 		QDir d(outputDir);
-		d.mkdir(fileName);
 		return d.absoluteFilePath(fileName);
 	}
 
-	void UnzipHandler::UnzipFile(const QFileInfo& zipFile, const QString& outputDir, ProgressPtr progress) {
-		QString appDir = PluginDir();
-		Bit7zLibrary lib{ QDir(appDir).absoluteFilePath("7z.dll").toStdString() };
+	bool UnzipHandler::UnzipFile(const QFileInfo& zipFile, const QString& outputDir, ProgressPtr progress, const std::function<bool(uint64_t)>& callback, const std::vector<uint32_t>& indices) {
 		try {
-			BitFileExtractor extractor{ lib, BitFormat::Auto };
-			extractor.test(zipFile.absoluteFilePath().toStdString());
-			//! bind progress callback function: prototype is <bool calback(uint64_t size)>
-			extractor.setProgressCallback(std::bind(UnzipProgressCallback, std::placeholders::_1, zipFile, progress));
+			//! A compressed tar is checked while it is streamed, testing it first would decompress it twice.
+			if (indices.empty() && !IsCompressedTar(zipFile)) {
+				BitFileExtractor extractor{ SevenZipLibrary::Instance(SevenZipPath()), BitFormat::Auto };
+				extractor.test(zipFile.absoluteFilePath().toStdString());
+			}
 
-			extractor.extract(zipFile.absoluteFilePath().toStdString(), outputDir.toStdString());
+			QDir().mkpath(outputDir);
+			ExtractArchive(zipFile, outputDir, indices, callback);
 			progress->OnFileComplete(zipFile, outputDir);
-			/*
-			//! if the zip file is gzip or bzip, will try to unzip tar.
-			if (fileName.endsWith(QString(".tar.gz"), Qt::CaseInsensitive) || fileName.endsWith(QString(".tar.bz2"), Qt::CaseInsensitive))
-			{
-				QDir t(outputDir.absoluteFilePath(fileBaseName));
-				QString tarFile = t.absoluteFilePath(QString("%1.tar").arg(fileBaseName));
-				if (QFile::exists(tarFile))
-				{
-					extractor.extract(tarFile.toStdString(), outputDir.absoluteFilePath(fileBaseName).toStdString());
-					QFile::remove(tarFile);
-				}
-			}
-			*/
-		} catch (const bit7z::BitException& ex) {
+		} catch (const std::exception& ex) {
 			progress->OnFileComplete(zipFile, outputDir, false, ex.what());
+			return false;
 		}
+		return true;
+	}
+
+	bool UnzipHandler::SafeUnzipFile(const QFileInfo& zipFile, const QString& outputDir, ProgressPtr progress, const std::function<bool(uint64_t)>& callback, const std::vector<uint32_t>& indices) {
+		QFileInfo target(outputDir);
+		//! Keep the temporary directory on the same volume as the output, so the files are renamed instead of copied.
+		QDir tempParent = target.exists() ? QDir(outputDir) : target.dir();
+		tempParent.mkpath(".");
+		QTemporaryDir tempDir(tempParent.absoluteFilePath(QString(".%1-XXXXXX").arg(target.fileName())));
+		if (!tempDir.isValid()) {
+			progress->OnFileComplete(zipFile, outputDir, false, QObject::tr("Cannot create temporary directory in %1.").arg(tempParent.absolutePath()));
+			return false;
+		}
+
+		try {
+			//! 7-Zip checks the CRC of every item while extracting, a damaged archive throws here.
+			ExtractArchive(zipFile, tempDir.path(), indices, callback);
+		} catch (const std::exception& ex) {
+			progress->OnFileComplete(zipFile, outputDir, false, ex.what());
+			return false;
+		}
+
+		//! The whole directory is renamed at once if possible, otherwise the items are moved into the existing directory one by one.
+		if (!target.exists() && QDir().rename(tempDir.path(), outputDir)) {
+			tempDir.setAutoRemove(false);
+			progress->OnFileComplete(zipFile, outputDir);
+			return true;
+		}
+
+		//! The extracted tree is merged into the existing one like 7-Zip extracts: directories are merged and only files are overwritten.
+		//! An entry whose type differs from the one in the way is refused before anything is moved.
+		QString conflict;
+		if (!CanMerge(tempDir.path(), outputDir, conflict)) {
+			progress->OnFileComplete(zipFile, outputDir, false, QObject::tr("Cannot replace %1 by an entry of another type.").arg(conflict));
+			return false;
+		}
+		QString error;
+		if (!MergeInto(tempDir.path(), outputDir, error)) {
+			progress->OnFileComplete(zipFile, outputDir, false, error);
+			return false;
+		}
+		progress->OnFileComplete(zipFile, outputDir);
+		return true;
+	}
+
+	bool UnzipHandler::UnzipToSink(FileHandlerPtr sink, const QFileInfo& zipFile, const QStringList& entries, const std::vector<uint32_t>& indices, ProgressPtr progress, const std::function<bool(uint64_t)>& callback, QFileInfoList& outputs) {
+		//! The entries of one archive are extracted in a single pass and live on disk only while the sink handles them.
+		QTemporaryDir tempDir(QDir(QDir::tempPath()).absoluteFilePath("ffx-unzip-XXXXXX"));
+		if (!tempDir.isValid()) {
+			progress->OnFileComplete(zipFile, QFileInfo(), false, QObject::tr("Cannot create temporary directory in %1.").arg(QDir::tempPath()));
+			return false;
+		}
+
+		try {
+			ExtractArchive(zipFile, tempDir.path(), indices, callback);
+		} catch (const std::exception& ex) {
+			progress->OnFileComplete(zipFile, QFileInfo(), false, ex.what());
+			return false;
+		}
+
+		QFileInfoList files;
+		QDir dir(tempDir.path());
+		for (const QString& entry : entries) {
+			files << QFileInfo(dir.absoluteFilePath(entry));
+		}
+		SinkProgress sinkProgress(progress);
+		QFileInfoList sinkOutputs = sink->Clone()->Handle(files, &sinkProgress);
+
+		//! The temporary directory is removed on return, outputs the sink left inside it would dangle.
+		QString tempRoot = QDir(tempDir.path()).canonicalPath() + "/";
+		QString tempPath = QDir(tempDir.path()).absolutePath() + "/";
+		int left = 0;
+		for (const QFileInfo& output : sinkOutputs) {
+			QString path = output.exists() ? output.canonicalFilePath() : output.absoluteFilePath();
+			if (path.startsWith(tempRoot) || path.startsWith(tempPath)) {
+				left++;
+				continue;
+			}
+			outputs << output;
+		}
+		if (left > 0) {
+			progress->OnFileComplete(zipFile, QFileInfo(), false, QObject::tr("%1 did not move %2 entries out of the temporary directory.").arg(sink->DisplayName()).arg(left));
+			return false;
+		}
+		progress->OnFileComplete(zipFile, QFileInfo(), true, QObject::tr("%1 entries handled by %2.").arg(entries.size()).arg(sink->DisplayName()));
+		return true;
 	}
 }
\ No newline at end of file
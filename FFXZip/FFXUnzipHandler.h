@@ -1,10 +1,17 @@
 #pragma once
 #include "FFXFileHandler.h"
 
+#include <functional>
+#include <vector>
+
 namespace FFX {
 	class UnzipHandler : public FileHandler {
 	public:
-		UnzipHandler(const QString& outputDir = "", bool mkdir = true);
+		UnzipHandler(const QString& outputDir = "", bool mkdir = true, bool safeExtract = true, int maxParallel = 0, int maxPerDevice = 2, const QString& entryFilter = "", int maxDepth = 0, int maxRatio = 100, const QString& sink = "");
+
+	public:
+		//! The handler named by the Sink argument is looked up here.
+		void SetHandlerFactory(HandlerFactory* factory) { mHandlerFactory = factory; }
 
 	public:
 		virtual QFileInfoList Filter(const QFileInfoList& files) override;
@@ -13,12 +20,20 @@ namespace FFX {
 		virtual QString Name() { return QStringLiteral("UnzipHandler"); }
 		virtual QString DisplayName() { return QObject::tr("UnzipHandler"); }
 		virtual QString Description() { return QObject::tr("Unzip file."); }
+		virtual void Cancel() { mCancelled = true; }
 
 	private:
 		QString MakeOutputDir(const QFileInfo& zipFile);
-		void UnzipFile(const QFileInfo& zipFile, const QString& outputDir, ProgressPtr progress);
+		//! The callback receives the uncompressed bytes extracted so far, extraction stops when it returns false.
+		//! Only the items in indices are extracted, all items if it is empty.
+		bool UnzipFile(const QFileInfo& zipFile, const QString& outputDir, ProgressPtr progress, const std::function<bool(uint64_t)>& callback, const std::vector<uint32_t>& indices = {});
+		//! Extract into a temporary directory beside outputDir and move the result in place only if the whole archive passed the CRC checks.
+		bool SafeUnzipFile(const QFileInfo& zipFile, const QString& outputDir, ProgressPtr progress, const std::function<bool(uint64_t)>& callback, const std::vector<uint32_t>& indices = {});
+		bool UnzipToSink(FileHandlerPtr sink, const QFileInfo& zipFile, const QStringList& entries, const std::vector<uint32_t>& indices, ProgressPtr progress, const std::function<bool(uint64_t)>& callback, QFileInfoList& outputs);
 
 	private:
 		FileFilterPtr mFileFilter;
+		HandlerFactory* mHandlerFactory = nullptr;
+		bool mCancelled = false;
 	};
 }
\ No newline at end of file
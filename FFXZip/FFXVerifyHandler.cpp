@@ -0,0 +1,183 @@
+#include "FFXVerifyHandler.h"
+#include "FFXZip.h"
+#include "FFXSevenZip.h"
+#include "FFXArchive.h"
+#include "FFXFile.h"
+#include "FFXString.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <bit7z/bitfileextractor.hpp>
+using namespace bit7z;
+
+namespace FFX {
+	//! Result of one archive, written to the summary file.
+	struct VerifyResult {
+		QString path;
+		qint64 size = 0;
+		bool passed = false;
+		qint64 msecs = 0;
+		QString error;
+	};
+
+	static bool WriteSummary(const QString& summaryFile, const QVector<VerifyResult>& results, bool cancelled) {
+		QJsonArray archives;
+		int passed = 0;
+		for (const VerifyResult& result : results) {
+			if (result.path.isEmpty())
+				continue;
+			QJsonObject archive;
+			archive["path"] = result.path;
+			archive["size"] = result.size;
+			archive["passed"] = result.passed;
+			archive["msecs"] = result.msecs;
+			archive["bytesPerSecond"] = result.msecs > 0 ? (double)result.size * 1000 / result.msecs : 0.0;
+			if (!result.passed)
+				archive["error"] = result.error;
+			archives << archive;
+			passed += result.passed ? 1 : 0;
+		}
+		QJsonObject summary;
+		summary["time"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+		summary["cancelled"] = cancelled;
+		summary["total"] = archives.size();
+		summary["passed"] = passed;
+		summary["failed"] = archives.size() - passed;
+		summary["archives"] = archives;
+
+		QDir().mkpath(QFileInfo(summaryFile).absolutePath());
+		QSaveFile file(summaryFile);
+		if (!file.open(QIODevice::WriteOnly))
+			return false;
+		file.write(QJsonDocument(summary).toJson());
+		return file.commit();
+	}
+
+	VerifyHandler::VerifyHandler(int maxParallel, const QString& summaryFile) {
+		mArgMap["MaxParallel"] = Argument("MaxParallel", QObject::tr("Max Parallel"), QObject::tr("Max number of archives tested at the same time, 0 means the number of CPU cores, default is 0."), maxParallel);
+		mArgMap["MaxParallel"].AddLimit("^(0|[1-9]\\d{0,2})$");
+		mArgMap["SummaryFile"] = Argument("SummaryFile", QObject::tr("Summary File"), QObject::tr("Write the result of every archive to this JSON file, empty means no summary."), summaryFile, Argument::SaveFile);
+		mArgMap["SummaryFile"].AddLimit("Summary(*.json)");
+	}
+
+	QFileInfoList VerifyHandler::Filter(const QFileInfoList& files) {
+		QFileInfoList filesTodo;
+		for (const QFileInfo& file : files) {
+			if (file.isDir()) {
+				QDirIterator fit(file.absoluteFilePath(), QDir::Files | QDir::Hidden | QDir::System, QDirIterator::Subdirectories);
+				while (fit.hasNext()) {
+					QFileInfo f(fit.next());
+					if (ArchiveIndex::IsArchive(f))
+						filesTodo << f;
+				}
+			} else if (ArchiveIndex::IsArchive(file)) {
+				filesTodo << file;
+			}
+		}
+		return filesTodo;
+	}
+
+	QFileInfoList VerifyHandler::Handle(const QFileInfoList& files, ProgressPtr progress) {
+		mCancelled = false;
+		QFileInfoList archives = Filter(files);
+		int size = archives.size();
+		int maxParallel = mArgMap["MaxParallel"].IntValue();
+		if (maxParallel <= 0) {
+			maxParallel = QThread::idealThreadCount();
+		}
+
+		//! 7-Zip reads every archive once from end to end, so the archives are weighted by their size on disk.
+		QVector<qint64> sizes(size);
+		QVector<double> fractions(size, 0);
+		QVector<VerifyResult> results(size);
+		qint64 total = 0;
+		for (int i = 0; i < size; i++) {
+			sizes[i] = qMax<qint64>(FileSize(archives[i]), 1);
+			total += sizes[i];
+		}
+
+		QMutex mutex;
+		double verified = 0;
+		QThreadPool workers;
+		workers.setMaxThreadCount(maxParallel);
+		for (int i = 0; i < size; i++) {
+			workers.start([&, i]() {
+				const QFileInfo& archive = archives[i];
+				if (mCancelled)
+					return;
+
+				uint64_t itemTotal = 0;
+				QElapsedTimer timer;
+				timer.start();
+				VerifyResult result;
+				result.path = archive.absoluteFilePath();
+				result.size = sizes[i];
+				try {
+					BitFileExtractor extractor{ SevenZipLibrary::Instance(SevenZipPath()), BitFormat::Auto };
+					extractor.setTotalCallback([&](uint64_t t) { itemTotal = t; });
+					extractor.setProgressCallback([&](uint64_t bytes) {
+						double fraction = itemTotal > 0 ? qMin(1.0, (double)bytes / itemTotal) : 0;
+						QMutexLocker locker(&mutex);
+						verified += (fraction - fractions[i]) * sizes[i];
+						fractions[i] = fraction;
+						progress->OnProgress(100.0 * verified / total, QObject::tr("Verify:%1").arg(archive.absoluteFilePath()));
+						return !mCancelled;
+						});
+					extractor.test(archive.absoluteFilePath().toStdString());
+					result.passed = true;
+				} catch (const std::exception& ex) {
+					result.error = QString::fromLocal8Bit(ex.what());
+				}
+				result.msecs = timer.elapsed();
+
+				QString msg = result.passed
+					? QObject::tr("Passed, %1 in %2 (%3/s).").arg(String::BytesHint(result.size)).arg(String::TimeHint(result.msecs))
+						.arg(String::BytesHint(result.size * 1000 / qMax<qint64>(result.msecs, 1)))
+					: result.error;
+				QMutexLocker locker(&mutex);
+				progress->OnFileComplete(archive, archive, result.passed, msg);
+				results[i] = result;
+				verified += (1.0 - fractions[i]) * sizes[i];
+				fractions[i] = 1.0;
+				progress->OnProgress(100.0 * verified / total, QObject::tr("Verify:%1").arg(archive.absoluteFilePath()));
+				});
+		}
+		workers.waitForDone();
+
+		QFileInfoList result;
+		int failed = 0;
+		for (int i = 0; i < size; i++) {
+			if (results[i].passed)
+				result << archives[i];
+			else if (!results[i].path.isEmpty())
+				failed++;
+		}
+
+		QString summaryFile = mArgMap["SummaryFile"].StringValue();
+		if (!summaryFile.isEmpty() && !WriteSummary(summaryFile, results, mCancelled)) {
+			progress->OnComplete(false, QObject::tr("Cannot write summary to %1.").arg(summaryFile));
+			return result;
+		}
+		if (mCancelled) {
+			progress->OnComplete(false, QObject::tr("Cancelled."));
+		} else {
+			progress->OnComplete(failed == 0, QObject::tr("%1 passed, %2 failed.").arg(result.size()).arg(failed));
+		}
+		return result;
+	}
+
+	std::shared_ptr<FileHandler> VerifyHandler::Clone() {
+		return FileHandlerPtr(new VerifyHandler(*this));
+	}
+}
\ No newline at end of file
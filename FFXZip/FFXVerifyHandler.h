@@ -0,0 +1,27 @@
+#pragma once
+#include "FFXFileHandler.h"
+
+namespace FFX {
+	/// <summary>
+	/// Tests archives with 7-Zip without writing anything, the CRC of every item is checked while it is
+	/// decoded in memory. Several archives are tested at the same time, directories are searched for archives.
+	/// </summary>
+	class VerifyHandler : public FileHandler {
+	public:
+		VerifyHandler(int maxParallel = 0, const QString& summaryFile = "");
+
+	public:
+		//! Archives in the input and below the input directories.
+		virtual QFileInfoList Filter(const QFileInfoList& files) override;
+		//! Returns the archives that passed.
+		virtual QFileInfoList Handle(const QFileInfoList& files, ProgressPtr progress = G_DebugProgress) override;
+		virtual std::shared_ptr<FileHandler> Clone() override;
+		virtual QString Name() { return QStringLiteral("VerifyHandler"); }
+		virtual QString DisplayName() { return QObject::tr("VerifyHandler"); }
+		virtual QString Description() { return QObject::tr("Verify archives without extracting them."); }
+		virtual void Cancel() { mCancelled = true; }
+
+	private:
+		bool mCancelled = false;
+	};
+}
\ No newline at end of file
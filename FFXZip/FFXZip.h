@@ -19,3 +19,8 @@ inline QString PluginDir() {
 	QString pluginPath = QDir(QCoreApplication::applicationDirPath()).absoluteFilePath("ffxplugins");
 	return QDir(pluginPath).absoluteFilePath(PLUGIN_NAME);
 }
+
+//! The 7-Zip library shipped with the plugin.
+inline QString SevenZipPath() {
+	return QDir(PluginDir()).absoluteFilePath("7z.dll");
+}
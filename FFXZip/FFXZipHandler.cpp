@@ -0,0 +1,153 @@
+#include "FFXZipHandler.h"
+#include "FFXZip.h"
+#include "FFXSevenZip.h"
+
+#include <QDir>
+#include <QFile>
+#include <QThread>
+
+#include <bit7z/bitfilecompressor.hpp>
+using namespace bit7z;
+
+namespace FFX {
+	static const BitInOutFormat& CompressionFormat(const QString& format) {
+		if (format == "zip")
+			return BitFormat::Zip;
+		if (format == "tar")
+			return BitFormat::Tar;
+		return BitFormat::SevenZip;
+	}
+
+	static BitCompressionLevel CompressionLevel(const QString& level) {
+		if (level == "None")
+			return BitCompressionLevel::None;
+		if (level == "Fastest")
+			return BitCompressionLevel::Fastest;
+		if (level == "Fast")
+			return BitCompressionLevel::Fast;
+		if (level == "Max")
+			return BitCompressionLevel::Max;
+		if (level == "Ultra")
+			return BitCompressionLevel::Ultra;
+		return BitCompressionLevel::Normal;
+	}
+
+	ZipHandler::ZipHandler(const QString& outputFile, const QString& format, const QString& level,
+		const QString& method, bool solid, int dictionarySize, int threads) {
+		mArgMap["OutputFile"] = Argument("OutputFile", QObject::tr("Output File"), QObject::tr("The archive to create, default to an archive beside the first file."), outputFile, Argument::SaveFile);
+		mArgMap["OutputFile"].AddLimit("Archive(*.7z *.zip *.tar)");
+		mArgMap["Format"] = Argument("Format", QObject::tr("Format"), QObject::tr("Format of the archive."), format, Argument::Option);
+		mArgMap["Format"].AddLimit("7z").AddLimit("zip").AddLimit("tar");
+		mArgMap["Level"] = Argument("Level", QObject::tr("Level"), QObject::tr("Compression level, ignored by tar."), level, Argument::Option);
+		mArgMap["Level"].AddLimit("None").AddLimit("Fastest").AddLimit("Fast").AddLimit("Normal").AddLimit("Max").AddLimit("Ultra");
+		mArgMap["Method"] = Argument("Method", QObject::tr("Method"), QObject::tr("Compression method, LZMA2 and LZMA are only valid for 7z, Default is LZMA2 for 7z and Deflate for zip."), method, Argument::Option);
+		mArgMap["Method"].AddLimit("Default").AddLimit("LZMA2").AddLimit("LZMA").AddLimit("BZip2").AddLimit("Deflate").AddLimit("PPMd").AddLimit("Copy");
+		mArgMap["Solid"] = Argument("Solid", QObject::tr("Solid"), QObject::tr("Compress the files as one continuous stream, only for 7z, default is true."), solid, Argument::Bool);
+		mArgMap["DictionarySize"] = Argument("DictionarySize", QObject::tr("Dictionary Size(MB)"), QObject::tr("Dictionary size in MB, 0 means the default of the level, default is 0."), dictionarySize);
+		mArgMap["DictionarySize"].AddLimit("^(0|[1-9]\\d{0,3})$");
+		mArgMap["Threads"] = Argument("Threads", QObject::tr("Threads"), QObject::tr("Number of compression threads, 0 means the number of CPU cores, default is 0."), threads);
+		mArgMap["Threads"].AddLimit("^(0|[1-9]\\d{0,2})$");
+	}
+
+	QFileInfoList ZipHandler::Handle(const QFileInfoList& files, ProgressPtr progress) {
+		mCancelled = false;
+		QFileInfoList result;
+		std::vector<std::string> inputs;
+		QFileInfoList inputFiles;
+		for (const QFileInfo& file : files) {
+			if (file.exists()) {
+				inputs.push_back(QDir::toNativeSeparators(file.absoluteFilePath()).toStdString());
+				inputFiles << file;
+			}
+		}
+		if (inputs.empty()) {
+			progress->OnComplete(false, QObject::tr("Nothing to compress."));
+			return result;
+		}
+
+		QString format = mArgMap["Format"].StringValue();
+		QString method = mArgMap["Method"].StringValue();
+		QString outputFile = mArgMap["OutputFile"].StringValue();
+		if (outputFile.isEmpty()) {
+			outputFile = MakeOutputFile(inputFiles, format);
+		}
+		int threads = mArgMap["Threads"].IntValue();
+		if (threads <= 0) {
+			threads = QThread::idealThreadCount();
+		}
+
+		//! Write to a partial file first so a cancelled or failed run never leaves a truncated archive behind.
+		QString partFile = outputFile + ".part";
+		QFile::remove(partFile);
+		uint64_t total = 0;
+		try {
+			BitFileCompressor compressor{ SevenZipLibrary::Instance(SevenZipPath()), CompressionFormat(format) };
+			if (format != "tar") {
+				compressor.setCompressionLevel(CompressionLevel(mArgMap["Level"].StringValue()));
+			}
+			if (method == "LZMA2") {
+				compressor.setCompressionMethod(BitCompressionMethod::Lzma2);
+			} else if (method == "LZMA") {
+				compressor.setCompressionMethod(BitCompressionMethod::Lzma);
+			} else if (method == "BZip2") {
+				compressor.setCompressionMethod(BitCompressionMethod::BZip2);
+			} else if (method == "Deflate") {
+				compressor.setCompressionMethod(BitCompressionMethod::Deflate);
+			} else if (method == "PPMd") {
+				compressor.setCompressionMethod(BitCompressionMethod::Ppmd);
+			} else if (method == "Copy") {
+				compressor.setCompressionMethod(BitCompressionMethod::Copy);
+			}
+			int dictionarySize = mArgMap["DictionarySize"].IntValue();
+			if (dictionarySize > 0) {
+				compressor.setDictionarySize((uint32_t)dictionarySize << 20);
+			}
+			if (format == "7z") {
+				compressor.setSolidMode(mArgMap["Solid"].BoolValue());
+			}
+			compressor.setThreadsCount(threads);
+			compressor.setTotalCallback([&](uint64_t size) { total = size; });
+			compressor.setProgressCallback([&](uint64_t size) {
+				if (total > 0) {
+					progress->OnProgress(100.0 * size / total, QObject::tr("Compress:%1").arg(outputFile));
+				}
+				return !mCancelled;
+				});
+			compressor.compress(inputs, partFile.toStdString());
+		} catch (const bit7z::BitException& ex) {
+			QFile::remove(partFile);
+			progress->OnComplete(false, mCancelled ? QObject::tr("Cancelled.") : QString(ex.what()));
+			return result;
+		}
+
+		QFile::remove(outputFile);
+		if (!QFile::rename(partFile, outputFile)) {
+			progress->OnComplete(false, QObject::tr("Cannot write %1.").arg(outputFile));
+			return result;
+		}
+		for (const QFileInfo& file : inputFiles) {
+			progress->OnFileComplete(file, QFileInfo(outputFile));
+		}
+		result << QFileInfo(outputFile);
+		progress->OnComplete(true, "Finish.");
+		return result;
+	}
+
+	std::shared_ptr<FileHandler> ZipHandler::Clone() {
+		return FileHandlerPtr(new ZipHandler(*this));
+	}
+
+	QString ZipHandler::MakeOutputFile(const QFileInfoList& files, const QString& suffix) {
+		const QFileInfo& first = files.first();
+		QDir dir = first.absoluteDir();
+		QString baseName = files.size() == 1 ? (first.isDir() ? first.fileName() : first.completeBaseName()) : dir.dirName();
+		if (baseName.isEmpty()) {
+			baseName = QStringLiteral("archive");
+		}
+		QString fileName = QString("%1.%2").arg(baseName).arg(suffix);
+		for (int i = 1; dir.exists(fileName); i++) {
+			fileName = QString("%1 (%2).%3").arg(baseName).arg(i).arg(suffix);
+		}
+		return dir.absoluteFilePath(fileName);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+#include "FFXFileHandler.h"
+
+namespace FFX {
+	/// <summary>
+	/// Compresses the input files and directories into one archive with 7-Zip. LZMA2, BZip2 and Deflate
+	/// compress on several threads, the thread count is passed to 7-Zip as is.
+	/// </summary>
+	class ZipHandler : public FileHandler {
+	public:
+		ZipHandler(const QString& outputFile = "", const QString& format = "7z", const QString& level = "Normal",
+			const QString& method = "Default", bool solid = true, int dictionarySize = 0, int threads = 0);
+
+	public:
+		virtual QFileInfoList Handle(const QFileInfoList& files, ProgressPtr progress = G_DebugProgress) override;
+		virtual std::shared_ptr<FileHandler> Clone() override;
+		virtual QString Name() { return QStringLiteral("ZipHandler"); }
+		virtual QString DisplayName() { return QObject::tr("ZipHandler"); }
+		virtual QString Description() { return QObject::tr("Compress files into an archive."); }
+		virtual void Cancel() { mCancelled = true; }
+
+	private:
+		//! Beside the first input, named after it or after its directory when there are several inputs.
+		QString MakeOutputFile(const QFileInfoList& files, const QString& suffix);
+
+	private:
+		bool mCancelled = false;
+	};
+}
\ No newline at end of file
@@ -2,7 +2,12 @@
 #include "FFXApplication.h"
 #include "FFXFileListView.h"
 #include "FFXUnzipHandler.h"
+#include "FFXZipHandler.h"
+#include "FFXVerifyHandler.h"
+#include "FFXHandlerSettingDialog.h"
 #include "FFXTaskPanel.h"
+#include "FFXSevenZip.h"
+#include "FFXZip.h"
 
 #include <QMenu>
 #include <QCoreApplication>
@@ -11,9 +16,15 @@ namespace FFX {
 	ZipPlugin::ZipPlugin(QObject* parent) : QObject(parent) {
 		mMenu = new QMenu(QObject::tr("&Zip"));
 		mUnzipAction = new QAction(QObject::tr("Unzip files"));
+		mZipAction = new QAction(QObject::tr("Compress files"));
+		mVerifyAction = new QAction(QObject::tr("Verify archives"));
 		mMenu->addAction(mUnzipAction);
+		mMenu->addAction(mZipAction);
+		mMenu->addAction(mVerifyAction);
 
 		connect(mUnzipAction, &QAction::triggered, this, &ZipPlugin::OnUnzipAction);
+		connect(mZipAction, &QAction::triggered, this, &ZipPlugin::OnZipAction);
+		connect(mVerifyAction, &QAction::triggered, this, &ZipPlugin::OnVerifyAction);
 	}
 
 	ZipPlugin::~ZipPlugin() {
@@ -21,8 +32,14 @@ namespace FFX {
 	}
 
 	void ZipPlugin::Install() {
+		//! Archive browsing in the file view uses the same library as the handlers.
+		SevenZipLibrary::SetDefaultPath(SevenZipPath());
 		App()->AddMenu(mMenu);
-		App()->HandlerFactoryPtr()->Append(std::make_shared<UnzipHandler>());
+		std::shared_ptr<UnzipHandler> unzipHandler = std::make_shared<UnzipHandler>();
+		unzipHandler->SetHandlerFactory(App()->HandlerFactoryPtr());
+		App()->HandlerFactoryPtr()->Append(unzipHandler);
+		App()->HandlerFactoryPtr()->Append(std::make_shared<ZipHandler>());
+		App()->HandlerFactoryPtr()->Append(std::make_shared<VerifyHandler>());
 	}
 
 	void ZipPlugin::Uninstall() {
@@ -32,6 +49,18 @@ namespace FFX {
 	void ZipPlugin::OnUnzipAction() {
 		FileMainView* fmv = App()->FileMainViewPtr();
 		QStringList files = fmv->SelectedFiles();
-		App()->TaskPanelPtr()->Submit(FileInfoList(files), std::make_shared<UnzipHandler>());
+		std::shared_ptr<UnzipHandler> handler = std::make_shared<UnzipHandler>();
+		handler->SetHandlerFactory(App()->HandlerFactoryPtr());
+		App()->TaskPanelPtr()->Submit(FileInfoList(files), handler);
+	}
+
+	void ZipPlugin::OnZipAction() {
+		HandlerSettingDialog dialog(std::make_shared<ZipHandler>());
+		dialog.exec();
+	}
+
+	void ZipPlugin::OnVerifyAction() {
+		HandlerSettingDialog dialog(std::make_shared<VerifyHandler>());
+		dialog.exec();
 	}
 }
\ No newline at end of file
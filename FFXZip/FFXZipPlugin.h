@@ -21,10 +21,14 @@ namespace FFX {
 
 	private slots:
 		void OnUnzipAction();
+		void OnZipAction();
+		void OnVerifyAction();
 
 	private:
 		QMenu* mMenu;
 		QAction* mUnzipAction;
+		QAction* mZipAction;
+		QAction* mVerifyAction;
 	};
 
 }